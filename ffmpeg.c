@@ -468,6 +468,7 @@ static void ffmpeg_cleanup(int ret)
     for (i = 0; i < nb_filtergraphs; i++) {
         FilterGraph *fg = filtergraphs[i];
         avfilter_graph_free(&fg->graph);
+        av_buffer_unref(&fg->frame_pools);
         for (j = 0; j < fg->nb_inputs; j++) {
             av_freep(&fg->inputs[j]->name);
             av_freep(&fg->inputs[j]);
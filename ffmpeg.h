@@ -248,6 +248,7 @@ typedef struct FilterGraph {
 
     AVFilterGraph *graph;
     int reconfiguration;
+    AVBufferRef   *frame_pools; ///< kept across reconfigurations of the graph
 
     InputFilter   **inputs;
     int          nb_inputs;
@@ -542,6 +543,7 @@ extern int abort_on_flags;
 extern int print_stats;
 extern int qp_hist;
 extern int stdin_interaction;
+extern int filter_hugepages;
 extern int frame_bits_per_raw_sample;
 extern AVIOContext *progress_avio;
 extern float max_error_rate;
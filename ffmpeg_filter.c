@@ -986,6 +986,19 @@ int configure_filtergraph(FilterGraph *fg)
     avfilter_graph_free(&fg->graph);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    fg->graph->hugepages = filter_hugepages;
+
+    /* reuse the frames allocated for the graph being replaced */
+    if (fg->frame_pools) {
+        av_buffer_unref(&fg->graph->frame_pools);
+        fg->graph->frame_pools = av_buffer_ref(fg->frame_pools);
+        if (!fg->graph->frame_pools)
+            return AVERROR(ENOMEM);
+    } else if (fg->graph->frame_pools) {
+        fg->frame_pools = av_buffer_ref(fg->graph->frame_pools);
+        if (!fg->frame_pools)
+            return AVERROR(ENOMEM);
+    }
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -117,6 +117,7 @@ int abort_on_flags    = 0;
 int print_stats       = -1;
 int qp_hist           = 0;
 int stdin_interaction = 1;
+int filter_hugepages  = 0;
 int frame_bits_per_raw_sample = 0;
 float max_error_rate  = 2.0/3;
 
@@ -3328,6 +3329,8 @@ const OptionDef options[] = {
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_script", HAS_ARG | OPT_EXPERT,                 { .func_arg = opt_filter_complex_script },
         "read complex filtergraph description from a file", "filename" },
+    { "filter_hugepages", OPT_BOOL | OPT_EXPERT,                     { &filter_hugepages },
+        "allocate filtered video frames from huge pages" },
     { "stats",          OPT_BOOL,                                    { &print_stats },
         "print progress report during encoding", },
     { "attach",         HAS_ARG | OPT_PERFILE | OPT_EXPERT |
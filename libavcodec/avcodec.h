@@ -921,6 +921,11 @@ typedef struct RcOverride{
  * Discard cropping information from SPS.
  */
 #define AV_CODEC_FLAG2_IGNORE_CROP    (1 << 16)
+/**
+ * Back the frames allocated by avcodec_default_get_buffer2() with huge pages,
+ * see av_buffer_alloc_hugepages().
+ */
+#define AV_CODEC_FLAG2_HUGEPAGES      (1 << 17)
 
 /**
  * Show all frames before the first keyframe
@@ -98,11 +98,15 @@ typedef struct FlacFrame {
     uint8_t crc8;
     int ch_mode;
     int verbatim_only;
+    uint32_t frame_number;
+    int max_framesize;      ///< coded size above which the frame is coded verbatim
+    int64_t pts;
+    uint8_t *buf;           ///< coded frame
+    int size;               ///< size of the coded frame or a negative error code
 } FlacFrame;
 
 typedef struct FlacEncodeContext {
     AVClass *class;
-    PutBitContext pb;
     int channels;
     int samplerate;
     int sr_code[2];
@@ -114,10 +118,15 @@ typedef struct FlacEncodeContext {
     uint32_t frame_count;
     uint64_t sample_count;
     uint8_t md5sum[16];
-    FlacFrame frame;
+    FlacFrame *frames;      ///< frames encoded together, one per thread
+    int nb_frames;
+    int nb_queued;          ///< frames waiting to be encoded
+    int next_out;           ///< first coded frame not yet returned
+    int nb_out;             ///< number of coded frames not yet returned
+    int last_blocksize;
     CompressionOptions options;
     AVCodecContext *avctx;
-    LPCContext lpc_ctx;
+    LPCContext *lpc_ctx;    ///< one per thread
     struct AVMD5 *md5ctx;
     uint8_t *md5_buffer;
     unsigned int md5_buffer_size;
@@ -454,8 +463,25 @@ FF_ENABLE_DEPRECATION_WARNINGS
         }
     }
 
-    ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
-                      s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+    /* With slice threading, one frame per thread is buffered and the
+       frames are then encoded concurrently. Frame numbers and the MD5 sum
+       are assigned in input order, so the output does not depend on the
+       thread count. */
+    s->nb_frames = avctx->active_thread_type & FF_THREAD_SLICE ?
+                   FFMAX(avctx->thread_count, 1) : 1;
+    s->frames  = av_mallocz_array(s->nb_frames, sizeof(*s->frames));
+    s->lpc_ctx = av_mallocz_array(s->nb_frames, sizeof(*s->lpc_ctx));
+    if (!s->frames || !s->lpc_ctx)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_frames; i++) {
+        s->frames[i].buf = av_malloc(s->max_framesize);
+        if (!s->frames[i].buf)
+            return AVERROR(ENOMEM);
+        ret = ff_lpc_init(&s->lpc_ctx[i], avctx->frame_size,
+                          s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+        if (ret < 0)
+            return ret;
+    }
 
     ff_bswapdsp_init(&s->bdsp);
     ff_flacdsp_init(&s->flac_dsp, avctx->sample_fmt, channels,
@@ -467,12 +493,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
 }
 
 
-static void init_frame(FlacEncodeContext *s, int nb_samples)
+static void init_frame(FlacEncodeContext *s, FlacFrame *frame, int nb_samples)
 {
     int i, ch;
-    FlacFrame *frame;
-
-    frame = &s->frame;
 
     for (i = 0; i < 16; i++) {
         if (nb_samples == ff_flac_blocksize_table[i]) {
@@ -512,16 +535,15 @@ static void init_frame(FlacEncodeContext *s, int nb_samples)
 /**
  * Copy channel-interleaved input samples into separate subframes.
  */
-static void copy_samples(FlacEncodeContext *s, const void *samples)
+static void copy_samples(FlacEncodeContext *s, FlacFrame *frame,
+                         const void *samples)
 {
     int i, j, ch;
-    FlacFrame *frame;
     int shift = av_get_bytes_per_sample(s->avctx->sample_fmt) * 8 -
                 s->avctx->bits_per_raw_sample;
 
 #define COPY_SAMPLES(bits) do {                                     \
     const int ## bits ## _t *samples0 = samples;                    \
-    frame = &s->frame;                                              \
     for (i = 0, j = 0; i < frame->blocksize; i++)                   \
         for (ch = 0; ch < s->channels; ch++, j++)                   \
             frame->subframes[ch].samples[i] = samples0[j] >> shift; \
@@ -548,8 +570,8 @@ static uint64_t rice_count_exact(const int32_t *res, int n, int k)
 }
 
 
-static uint64_t subframe_count_exact(FlacEncodeContext *s, FlacSubframe *sub,
-                                     int pred_order)
+static uint64_t subframe_count_exact(FlacEncodeContext *s, FlacFrame *frame,
+                                     FlacSubframe *sub, int pred_order)
 {
     int p, porder, psize;
     int i, part_end;
@@ -565,7 +587,7 @@ static uint64_t subframe_count_exact(FlacEncodeContext *s, FlacSubframe *sub,
     if (sub->type == FLAC_SUBFRAME_CONSTANT) {
         count += sub->obits;
     } else if (sub->type == FLAC_SUBFRAME_VERBATIM) {
-        count += s->frame.blocksize * sub->obits;
+        count += frame->blocksize * sub->obits;
     } else {
         /* warm-up samples */
         count += pred_order * sub->obits;
@@ -579,7 +601,7 @@ static uint64_t subframe_count_exact(FlacEncodeContext *s, FlacSubframe *sub,
 
         /* partition order */
         porder = sub->rc.porder;
-        psize  = s->frame.blocksize >> porder;
+        psize  = frame->blocksize >> porder;
         count += 4;
 
         /* residual */
@@ -590,7 +612,7 @@ static uint64_t subframe_count_exact(FlacEncodeContext *s, FlacSubframe *sub,
             count += sub->rc.coding_mode;
             count += rice_count_exact(&sub->residual[i], part_end - i, k);
             i = part_end;
-            part_end = FFMIN(s->frame.blocksize, part_end + psize);
+            part_end = FFMIN(frame->blocksize, part_end + psize);
         }
     }
 
@@ -751,19 +773,19 @@ static int get_max_p_order(int max_porder, int n, int order)
 }
 
 
-static uint64_t find_subframe_rice_params(FlacEncodeContext *s,
+static uint64_t find_subframe_rice_params(FlacEncodeContext *s, FlacFrame *frame,
                                           FlacSubframe *sub, int pred_order)
 {
     int pmin = get_max_p_order(s->options.min_partition_order,
-                               s->frame.blocksize, pred_order);
+                               frame->blocksize, pred_order);
     int pmax = get_max_p_order(s->options.max_partition_order,
-                               s->frame.blocksize, pred_order);
+                               frame->blocksize, pred_order);
 
     uint64_t bits = 8 + pred_order * sub->obits + 2 + sub->rc.coding_mode;
     if (sub->type == FLAC_SUBFRAME_LPC)
         bits += 4 + 5 + pred_order * s->options.lpc_coeff_precision;
     bits += calc_rice_params(&sub->rc, sub->rc_udata, sub->rc_sums, pmin, pmax, sub->residual,
-                             s->frame.blocksize, pred_order, s->options.exact_rice_parameters);
+                             frame->blocksize, pred_order, s->options.exact_rice_parameters);
     return bits;
 }
 
@@ -819,17 +841,16 @@ static void encode_residual_fixed(int32_t *res, const int32_t *smp, int n,
 }
 
 
-static int encode_residual_ch(FlacEncodeContext *s, int ch)
+static int encode_residual_ch(FlacEncodeContext *s, FlacFrame *frame,
+                              LPCContext *lpc_ctx, int ch)
 {
     int i, n;
     int min_order, max_order, opt_order, omethod;
-    FlacFrame *frame;
     FlacSubframe *sub;
     int32_t coefs[MAX_LPC_ORDER][MAX_LPC_ORDER];
     int shift[MAX_LPC_ORDER];
     int32_t *res, *smp;
 
-    frame = &s->frame;
     sub   = &frame->subframes[ch];
     res   = sub->residual;
     smp   = sub->samples;
@@ -842,14 +863,14 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
     if (i == n) {
         sub->type = sub->type_code = FLAC_SUBFRAME_CONSTANT;
         res[0] = smp[0];
-        return subframe_count_exact(s, sub, 0);
+        return subframe_count_exact(s, frame, sub, 0);
     }
 
     /* VERBATIM */
     if (frame->verbatim_only || n < 5) {
         sub->type = sub->type_code = FLAC_SUBFRAME_VERBATIM;
         memcpy(res, smp, n * sizeof(int32_t));
-        return subframe_count_exact(s, sub, 0);
+        return subframe_count_exact(s, frame, sub, 0);
     }
 
     min_order  = s->options.min_prediction_order;
@@ -867,7 +888,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
         bits[0]   = UINT32_MAX;
         for (i = min_order; i <= max_order; i++) {
             encode_residual_fixed(res, smp, n, i);
-            bits[i] = find_subframe_rice_params(s, sub, i);
+            bits[i] = find_subframe_rice_params(s, frame, sub, i);
             if (bits[i] < bits[opt_order])
                 opt_order = i;
         }
@@ -875,14 +896,14 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
         sub->type_code = sub->type | sub->order;
         if (sub->order != max_order) {
             encode_residual_fixed(res, smp, n, sub->order);
-            find_subframe_rice_params(s, sub, sub->order);
+            find_subframe_rice_params(s, frame, sub, sub->order);
         }
-        return subframe_count_exact(s, sub, sub->order);
+        return subframe_count_exact(s, frame, sub, sub->order);
     }
 
     /* LPC */
     sub->type = FLAC_SUBFRAME_LPC;
-    opt_order = ff_lpc_calc_coefs(&s->lpc_ctx, smp, n, min_order, max_order,
+    opt_order = ff_lpc_calc_coefs(lpc_ctx, smp, n, min_order, max_order,
                                   s->options.lpc_coeff_precision, coefs, shift, s->options.lpc_type,
                                   s->options.lpc_passes, omethod,
                                   MIN_LPC_SHIFT, MAX_LPC_SHIFT, 0);
@@ -909,7 +930,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
                 s->flac_dsp.lpc32_encode(res, smp, n, order+1, coefs[order],
                                          shift[order]);
             }
-            bits[i] = find_subframe_rice_params(s, sub, order+1);
+            bits[i] = find_subframe_rice_params(s, frame, sub, order+1);
             if (bits[i] < bits[opt_index]) {
                 opt_index = i;
                 opt_order = order;
@@ -927,7 +948,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
             } else {
                 s->flac_dsp.lpc32_encode(res, smp, n, i+1, coefs[i], shift[i]);
             }
-            bits[i] = find_subframe_rice_params(s, sub, i+1);
+            bits[i] = find_subframe_rice_params(s, frame, sub, i+1);
             if (bits[i] < bits[opt_order])
                 opt_order = i;
         }
@@ -949,7 +970,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
                 } else {
                     s->flac_dsp.lpc16_encode(res, smp, n, i+1, coefs[i], shift[i]);
                 }
-                bits[i] = find_subframe_rice_params(s, sub, i+1);
+                bits[i] = find_subframe_rice_params(s, frame, sub, i+1);
                 if (bits[i] < bits[opt_order])
                     opt_order = i;
             }
@@ -990,7 +1011,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
                 } else {
                     s->flac_dsp.lpc32_encode(res, smp, n, opt_order, lpc_try, shift[opt_order-1]);
                 }
-                score = find_subframe_rice_params(s, sub, opt_order);
+                score = find_subframe_rice_params(s, frame, sub, opt_order);
                 if (score < best_score) {
                     best_score = score;
                     memcpy(coefs[opt_order-1], lpc_try, sizeof(*coefs));
@@ -1012,13 +1033,13 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
         s->flac_dsp.lpc32_encode(res, smp, n, sub->order, sub->coefs, sub->shift);
     }
 
-    find_subframe_rice_params(s, sub, sub->order);
+    find_subframe_rice_params(s, frame, sub, sub->order);
 
-    return subframe_count_exact(s, sub, sub->order);
+    return subframe_count_exact(s, frame, sub, sub->order);
 }
 
 
-static int count_frame_header(FlacEncodeContext *s)
+static int count_frame_header(FlacEncodeContext *s, FlacFrame *frame)
 {
     uint8_t av_unused tmp;
     int count;
@@ -1036,12 +1057,12 @@ static int count_frame_header(FlacEncodeContext *s)
     count = 32;
 
     /* coded frame number */
-    PUT_UTF8(s->frame_count, tmp, count += 8;)
+    PUT_UTF8(frame->frame_number, tmp, count += 8;)
 
     /* explicit block size */
-    if (s->frame.bs_code[0] == 6)
+    if (frame->bs_code[0] == 6)
         count += 8;
-    else if (s->frame.bs_code[0] == 7)
+    else if (frame->bs_code[0] == 7)
         count += 16;
 
     /* explicit sample rate */
@@ -1054,15 +1075,16 @@ static int count_frame_header(FlacEncodeContext *s)
 }
 
 
-static int encode_frame(FlacEncodeContext *s)
+static int encode_frame(FlacEncodeContext *s, FlacFrame *frame,
+                        LPCContext *lpc_ctx)
 {
     int ch;
     uint64_t count;
 
-    count = count_frame_header(s);
+    count = count_frame_header(s, frame);
 
     for (ch = 0; ch < s->channels; ch++)
-        count += encode_residual_ch(s, ch);
+        count += encode_residual_ch(s, frame, lpc_ctx, ch);
 
     count += (8 - (count & 7)) & 7; // byte alignment
     count += 16;                    // CRC-16
@@ -1074,15 +1096,15 @@ static int encode_frame(FlacEncodeContext *s)
 }
 
 
-static void remove_wasted_bits(FlacEncodeContext *s)
+static void remove_wasted_bits(FlacEncodeContext *s, FlacFrame *frame)
 {
     int ch, i;
 
     for (ch = 0; ch < s->channels; ch++) {
-        FlacSubframe *sub = &s->frame.subframes[ch];
+        FlacSubframe *sub = &frame->subframes[ch];
         int32_t v         = 0;
 
-        for (i = 0; i < s->frame.blocksize; i++) {
+        for (i = 0; i < frame->blocksize; i++) {
             v |= sub->samples[i];
             if (v & 1)
                 break;
@@ -1091,7 +1113,7 @@ static void remove_wasted_bits(FlacEncodeContext *s)
         if (v && !(v & 1)) {
             v = ff_ctz(v);
 
-            for (i = 0; i < s->frame.blocksize; i++)
+            for (i = 0; i < frame->blocksize; i++)
                 sub->samples[i] >>= v;
 
             sub->wasted = v;
@@ -1150,13 +1172,11 @@ static int estimate_stereo_mode(const int32_t *left_ch, const int32_t *right_ch,
 /**
  * Perform stereo channel decorrelation.
  */
-static void channel_decorrelation(FlacEncodeContext *s)
+static void channel_decorrelation(FlacEncodeContext *s, FlacFrame *frame)
 {
-    FlacFrame *frame;
     int32_t *left, *right;
     int i, n;
 
-    frame = &s->frame;
     n     = frame->blocksize;
     left  = frame->subframes[0].samples;
     right = frame->subframes[1].samples;
@@ -1202,96 +1222,95 @@ static void write_utf8(PutBitContext *pb, uint32_t val)
 }
 
 
-static void write_frame_header(FlacEncodeContext *s)
+static void write_frame_header(FlacEncodeContext *s, FlacFrame *frame,
+                               PutBitContext *pb)
 {
-    FlacFrame *frame;
     int crc;
 
-    frame = &s->frame;
-
-    put_bits(&s->pb, 16, 0xFFF8);
-    put_bits(&s->pb, 4, frame->bs_code[0]);
-    put_bits(&s->pb, 4, s->sr_code[0]);
+    put_bits(pb, 16, 0xFFF8);
+    put_bits(pb, 4, frame->bs_code[0]);
+    put_bits(pb, 4, s->sr_code[0]);
 
     if (frame->ch_mode == FLAC_CHMODE_INDEPENDENT)
-        put_bits(&s->pb, 4, s->channels-1);
+        put_bits(pb, 4, s->channels-1);
     else
-        put_bits(&s->pb, 4, frame->ch_mode + FLAC_MAX_CHANNELS - 1);
+        put_bits(pb, 4, frame->ch_mode + FLAC_MAX_CHANNELS - 1);
 
-    put_bits(&s->pb, 3, s->bps_code);
-    put_bits(&s->pb, 1, 0);
-    write_utf8(&s->pb, s->frame_count);
+    put_bits(pb, 3, s->bps_code);
+    put_bits(pb, 1, 0);
+    write_utf8(pb, frame->frame_number);
 
     if (frame->bs_code[0] == 6)
-        put_bits(&s->pb, 8, frame->bs_code[1]);
+        put_bits(pb, 8, frame->bs_code[1]);
     else if (frame->bs_code[0] == 7)
-        put_bits(&s->pb, 16, frame->bs_code[1]);
+        put_bits(pb, 16, frame->bs_code[1]);
 
     if (s->sr_code[0] == 12)
-        put_bits(&s->pb, 8, s->sr_code[1]);
+        put_bits(pb, 8, s->sr_code[1]);
     else if (s->sr_code[0] > 12)
-        put_bits(&s->pb, 16, s->sr_code[1]);
+        put_bits(pb, 16, s->sr_code[1]);
 
-    flush_put_bits(&s->pb);
-    crc = av_crc(av_crc_get_table(AV_CRC_8_ATM), 0, s->pb.buf,
-                 put_bits_count(&s->pb) >> 3);
-    put_bits(&s->pb, 8, crc);
+    flush_put_bits(pb);
+    crc = av_crc(av_crc_get_table(AV_CRC_8_ATM), 0, pb->buf,
+                 put_bits_count(pb) >> 3);
+    put_bits(pb, 8, crc);
 }
 
 
-static void write_subframes(FlacEncodeContext *s)
+static void write_subframes(FlacEncodeContext *s, FlacFrame *frame,
+                            PutBitContext *pb)
 {
     int ch;
 
     for (ch = 0; ch < s->channels; ch++) {
-        FlacSubframe *sub = &s->frame.subframes[ch];
+        FlacSubframe *sub = &frame->subframes[ch];
         int i, p, porder, psize;
         int32_t *part_end;
         int32_t *res       =  sub->residual;
-        int32_t *frame_end = &sub->residual[s->frame.blocksize];
+        int32_t *frame_end = &sub->residual[frame->blocksize];
 
         /* subframe header */
-        put_bits(&s->pb, 1, 0);
-        put_bits(&s->pb, 6, sub->type_code);
-        put_bits(&s->pb, 1, !!sub->wasted);
+        put_bits(pb, 1, 0);
+        put_bits(pb, 6, sub->type_code);
+        put_bits(pb, 1, !!sub->wasted);
         if (sub->wasted)
-            put_bits(&s->pb, sub->wasted, 1);
+            put_bits(pb, sub->wasted, 1);
 
         /* subframe */
         if (sub->type == FLAC_SUBFRAME_CONSTANT) {
-            put_sbits(&s->pb, sub->obits, res[0]);
+            put_sbits(pb, sub->obits, res[0]);
         } else if (sub->type == FLAC_SUBFRAME_VERBATIM) {
             while (res < frame_end)
-                put_sbits(&s->pb, sub->obits, *res++);
+                put_sbits(pb, sub->obits, *res++);
         } else {
             /* warm-up samples */
             for (i = 0; i < sub->order; i++)
-                put_sbits(&s->pb, sub->obits, *res++);
+                put_sbits(pb, sub->obits, *res++);
 
             /* LPC coefficients */
             if (sub->type == FLAC_SUBFRAME_LPC) {
                 int cbits = s->options.lpc_coeff_precision;
-                put_bits( &s->pb, 4, cbits-1);
-                put_sbits(&s->pb, 5, sub->shift);
+                put_bits( pb, 4, cbits-1);
+                put_sbits(pb, 5, sub->shift);
                 for (i = 0; i < sub->order; i++)
-                    put_sbits(&s->pb, cbits, sub->coefs[i]);
+                    put_sbits(pb, cbits, sub->coefs[i]);
             }
 
             /* rice-encoded block */
-            put_bits(&s->pb, 2, sub->rc.coding_mode - 4);
+            put_bits(pb, 2, sub->rc.coding_mode - 4);
 
             /* partition order */
             porder  = sub->rc.porder;
-            psize   = s->frame.blocksize >> porder;
-            put_bits(&s->pb, 4, porder);
+            psize   = frame->blocksize >> porder;
+            put_bits(pb, 4, porder);
 
             /* residual */
             part_end  = &sub->residual[psize];
             for (p = 0; p < 1 << porder; p++) {
                 int k = sub->rc.params[p];
-                put_bits(&s->pb, sub->rc.coding_mode, k);
+                put_bits(pb, sub->rc.coding_mode, k);
                 while (res < part_end)
-                    set_sr_golomb_flac(&s->pb, *res++, k, INT32_MAX, 0);
+                    set_sr_golomb_flac(pb, *res++, k, INT32_MAX, 0);
                 part_end = FFMIN(frame_end, part_end + psize);
             }
         }
@@ -1299,31 +1318,34 @@ static void write_subframes(FlacEncodeContext *s)
 }
 
 
-static void write_frame_footer(FlacEncodeContext *s)
+static void write_frame_footer(PutBitContext *pb)
 {
     int crc;
-    flush_put_bits(&s->pb);
-    crc = av_bswap16(av_crc(av_crc_get_table(AV_CRC_16_ANSI), 0, s->pb.buf,
-                            put_bits_count(&s->pb)>>3));
-    put_bits(&s->pb, 16, crc);
-    flush_put_bits(&s->pb);
+    flush_put_bits(pb);
+    crc = av_bswap16(av_crc(av_crc_get_table(AV_CRC_16_ANSI), 0, pb->buf,
+                            put_bits_count(pb)>>3));
+    put_bits(pb, 16, crc);
+    flush_put_bits(pb);
 }
 
 
-static int write_frame(FlacEncodeContext *s, AVPacket *avpkt)
+static int write_frame(FlacEncodeContext *s, FlacFrame *frame, int size)
 {
-    init_put_bits(&s->pb, avpkt->data, avpkt->size);
-    write_frame_header(s);
-    write_subframes(s);
-    write_frame_footer(s);
-    return put_bits_count(&s->pb) >> 3;
+    PutBitContext pb;
+
+    init_put_bits(&pb, frame->buf, size);
+    write_frame_header(s, frame, &pb);
+    write_subframes(s, frame, &pb);
+    write_frame_footer(&pb);
+    return put_bits_count(&pb) >> 3;
 }
 
 
-static int update_md5_sum(FlacEncodeContext *s, const void *samples)
+static int update_md5_sum(FlacEncodeContext *s, int nb_samples,
+                          const void *samples)
 {
     const uint8_t *buf;
-    int buf_size = s->frame.blocksize * s->channels *
+    int buf_size = nb_samples * s->channels *
                    ((s->avctx->bits_per_raw_sample + 7) / 8);
 
     if (s->avctx->bits_per_raw_sample > 16 || HAVE_BIGENDIAN) {
@@ -1344,7 +1366,7 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
         const int32_t *samples0 = samples;
         uint8_t *tmp            = s->md5_buffer;
 
-        for (i = 0; i < s->frame.blocksize * s->channels; i++) {
+        for (i = 0; i < nb_samples * s->channels; i++) {
             int32_t v = samples0[i] >> 8;
             AV_WL24(tmp + 3*i, v);
         }
@@ -1356,14 +1378,113 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
 }
 
 
+static int encode_frame_thread(AVCodecContext *avctx, void *arg,
+                               int jobnr, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacFrame *frame     = &s->frames[jobnr];
+    LPCContext *lpc_ctx  = &s->lpc_ctx[threadnr];
+    int frame_bytes;
+
+    channel_decorrelation(s, frame);
+
+    remove_wasted_bits(s, frame);
+
+    frame_bytes = encode_frame(s, frame, lpc_ctx);
+
+    /* Fall back on verbatim mode if the compressed frame is larger than it
+       would be if encoded uncompressed. */
+    if (frame_bytes < 0 || frame_bytes > frame->max_framesize) {
+        frame->verbatim_only = 1;
+        frame_bytes = encode_frame(s, frame, lpc_ctx);
+        if (frame_bytes < 0) {
+            av_log(avctx, AV_LOG_ERROR, "Bad frame count\n");
+            return frame->size = frame_bytes;
+        }
+    }
+    if (frame_bytes > frame->max_framesize) {
+        av_log(avctx, AV_LOG_ERROR,
+               "Verbatim frame of %d bytes exceeds the maximum frame size %d\n",
+               frame_bytes, frame->max_framesize);
+        return frame->size = AVERROR_BUG;
+    }
+
+    frame->size = write_frame(s, frame, frame_bytes);
+    return 0;
+}
+
+
 static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                              const AVFrame *frame, int *got_packet_ptr)
 {
     FlacEncodeContext *s;
-    int frame_bytes, out_bytes, ret;
+    FlacFrame *f;
+    int ret;
 
     s = avctx->priv_data;
 
+    if (frame) {
+        /* change max_framesize for small final frame */
+        if (frame->nb_samples < s->last_blocksize) {
+            s->max_framesize = ff_flac_get_max_frame_size(frame->nb_samples,
+                                                          s->channels,
+                                                          avctx->bits_per_raw_sample);
+        }
+        s->last_blocksize = frame->nb_samples;
+
+        f = &s->frames[s->nb_queued++];
+
+        init_frame(s, f, frame->nb_samples);
+
+        copy_samples(s, f, frame->data[0]);
+
+        f->frame_number  = s->frame_count++;
+        f->max_framesize = s->max_framesize;
+        f->pts           = frame->pts;
+
+        s->sample_count += frame->nb_samples;
+        if ((ret = update_md5_sum(s, frame->nb_samples, frame->data[0])) < 0) {
+            av_log(avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
+            return ret;
+        }
+    }
+
+    /* Encode the queued frames once there is one for every thread, or when
+       flushing. The frames of the previous batch have all been returned by
+       then, since one is returned for each frame queued. */
+    if (s->nb_queued == s->nb_frames || !frame && s->nb_queued && !s->nb_out) {
+        avctx->execute2(avctx, encode_frame_thread, NULL, NULL, s->nb_queued);
+        s->next_out  = 0;
+        s->nb_out    = s->nb_queued;
+        s->nb_queued = 0;
+    }
+
+    if (s->nb_out) {
+        f = &s->frames[s->next_out++];
+        s->nb_out--;
+
+        /* the error has been logged by the job */
+        if (f->size < 0)
+            return f->size;
+
+        if ((ret = ff_alloc_packet2(avctx, avpkt, f->size, 0)) < 0)
+            return ret;
+        memcpy(avpkt->data, f->buf, f->size);
+
+        if (f->size > s->max_encoded_framesize)
+            s->max_encoded_framesize = f->size;
+        if (f->size < s->min_framesize)
+            s->min_framesize = f->size;
+
+        avpkt->pts      = f->pts;
+        avpkt->duration = ff_samples_to_time_base(avctx, f->blocksize);
+
+        s->next_pts = avpkt->pts + avpkt->duration;
+
+        *got_packet_ptr = 1;
+        return 0;
+    }
+
     /* when the last block is reached, update the header in extradata */
     if (!frame) {
         s->max_framesize = s->max_encoded_framesize;
@@ -1388,61 +1509,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
             *got_packet_ptr = 1;
             s->flushed = 1;
         }
-
-        return 0;
-    }
-
-    /* change max_framesize for small final frame */
-    if (frame->nb_samples < s->frame.blocksize) {
-        s->max_framesize = ff_flac_get_max_frame_size(frame->nb_samples,
-                                                      s->channels,
-                                                      avctx->bits_per_raw_sample);
-    }
-
-    init_frame(s, frame->nb_samples);
-
-    copy_samples(s, frame->data[0]);
-
-    channel_decorrelation(s);
-
-    remove_wasted_bits(s);
-
-    frame_bytes = encode_frame(s);
-
-    /* Fall back on verbatim mode if the compressed frame is larger than it
-       would be if encoded uncompressed. */
-    if (frame_bytes < 0 || frame_bytes > s->max_framesize) {
-        s->frame.verbatim_only = 1;
-        frame_bytes = encode_frame(s);
-        if (frame_bytes < 0) {
-            av_log(avctx, AV_LOG_ERROR, "Bad frame count\n");
-            return frame_bytes;
-        }
     }
 
-    if ((ret = ff_alloc_packet2(avctx, avpkt, frame_bytes, 0)) < 0)
-        return ret;
-
-    out_bytes = write_frame(s, avpkt);
-
-    s->frame_count++;
-    s->sample_count += frame->nb_samples;
-    if ((ret = update_md5_sum(s, frame->data[0])) < 0) {
-        av_log(avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
-        return ret;
-    }
-    if (out_bytes > s->max_encoded_framesize)
-        s->max_encoded_framesize = out_bytes;
-    if (out_bytes < s->min_framesize)
-        s->min_framesize = out_bytes;
-
-    avpkt->pts      = frame->pts;
-    avpkt->duration = ff_samples_to_time_base(avctx, frame->nb_samples);
-    avpkt->size     = out_bytes;
-
-    s->next_pts = avpkt->pts + avpkt->duration;
-
-    *got_packet_ptr = 1;
     return 0;
 }
 
@@ -1451,9 +1519,17 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
 {
     if (avctx->priv_data) {
         FlacEncodeContext *s = avctx->priv_data;
+        int i;
         av_freep(&s->md5ctx);
         av_freep(&s->md5_buffer);
-        ff_lpc_end(&s->lpc_ctx);
+        if (s->frames)
+            for (i = 0; i < s->nb_frames; i++)
+                av_freep(&s->frames[i].buf);
+        av_freep(&s->frames);
+        if (s->lpc_ctx)
+            for (i = 0; i < s->nb_frames; i++)
+                ff_lpc_end(&s->lpc_ctx[i]);
+        av_freep(&s->lpc_ctx);
     }
     av_freep(&avctx->extradata);
     avctx->extradata_size = 0;
@@ -1508,7 +1584,8 @@ AVCodec ff_flac_encoder = {
     .init           = flac_encode_init,
     .encode2        = flac_encode_frame,
     .close          = flac_encode_close,
-    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY | AV_CODEC_CAP_LOSSLESS,
+    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY | AV_CODEC_CAP_LOSSLESS |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_S16,
                                                      AV_SAMPLE_FMT_S32,
                                                      AV_SAMPLE_FMT_NONE },
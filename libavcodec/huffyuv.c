@@ -68,6 +68,50 @@ av_cold int ff_huffyuv_alloc_temp(HYuvContext *s)
     return 0;
 }
 
+int ff_huffyuv_alloc_slice_contexts(HYuvContext *s, int nb_slices)
+{
+    int i, ret;
+
+    for (i = s->nb_slices; i < nb_slices; i++) {
+        HYuvContext *fs = av_malloc(sizeof(*fs));
+        if (!fs)
+            return AVERROR(ENOMEM);
+
+        memcpy(fs, s, sizeof(*fs));
+        memset(fs->temp,      0, sizeof(fs->temp));
+        memset(fs->temp16,    0, sizeof(fs->temp16));
+        memset(fs->slice_ctx, 0, sizeof(fs->slice_ctx));
+        fs->nb_slices             = 0;
+        fs->bitstream_buffer      = NULL;
+        fs->bitstream_buffer_size = 0;
+
+        s->slice_ctx[i] = fs;
+        s->nb_slices    = i + 1;
+
+        if ((ret = ff_huffyuv_alloc_temp(fs)) < 0)
+            return ret;
+    }
+    return 0;
+}
+
+int ff_huffyuv_max_slices(const HYuvContext *s)
+{
+    int units = s->height >> (s->chroma_v_shift + s->interlaced);
+
+    return av_clip(units, 1, MAX_SLICES);
+}
+
+void ff_huffyuv_slice_bounds(const HYuvContext *s, int nb_slices, int idx,
+                             int *start, int *end)
+{
+    int shift = s->chroma_v_shift + s->interlaced;
+    int units = s->height >> shift;
+
+    *start = (units * idx / nb_slices) << shift;
+    *end   = idx == nb_slices - 1 ? s->height
+                                  : (units * (idx + 1) / nb_slices) << shift;
+}
+
 av_cold void ff_huffyuv_common_init(AVCodecContext *avctx)
 {
     HYuvContext *s = avctx->priv_data;
@@ -92,4 +136,11 @@ av_cold void ff_huffyuv_common_end(HYuvContext *s)
         av_freep(&s->temp[i]);
         s->temp16[i] = NULL;
     }
+
+    for (i = 0; i < s->nb_slices; i++) {
+        if (s->slice_ctx[i])
+            ff_huffyuv_common_end(s->slice_ctx[i]);
+        av_freep(&s->slice_ctx[i]);
+    }
+    s->nb_slices = 0;
 }
@@ -44,6 +44,7 @@
 #define MAX_BITS 16
 #define MAX_N (1<<MAX_BITS)
 #define MAX_VLC_N 16384
+#define MAX_SLICES 64
 
 typedef enum Predictor {
     LEFT = 0,
@@ -90,6 +91,10 @@ typedef struct HYuvContext {
     HuffYUVEncDSPContext hencdsp;
     LLVidDSPContext llviddsp;
     int non_determ; // non-deterministic, multi-threaded encoder allowed
+    int nb_slices;                          ///< number of allocated slice contexts
+    struct HYuvContext *slice_ctx[MAX_SLICES];
+    int slice_start, slice_end;             ///< luma rows covered by a slice context
+    int slice_size;                         ///< encoder: size of the slice bitstream in bytes
 } HYuvContext;
 
 void ff_huffyuv_common_init(AVCodecContext *s);
@@ -97,4 +102,22 @@ void ff_huffyuv_common_end(HYuvContext *s);
 int  ff_huffyuv_alloc_temp(HYuvContext *s);
 int ff_huffyuv_generate_bits_table(uint32_t *dst, const uint8_t *len_table, int n);
 
+/**
+ * Allocate per-slice copies of s, up to nb_slices in total.
+ * They share the huffman tables of s and are freed by ff_huffyuv_common_end().
+ */
+int ff_huffyuv_alloc_slice_contexts(HYuvContext *s, int nb_slices);
+
+/**
+ * @return the maximum number of slices a frame of s can be split into
+ */
+int ff_huffyuv_max_slices(const HYuvContext *s);
+
+/**
+ * Get the luma rows covered by slice idx out of nb_slices. Slice boundaries
+ * are aligned so that every slice holds whole chroma rows and field pairs.
+ */
+void ff_huffyuv_slice_bounds(const HYuvContext *s, int nb_slices, int idx,
+                             int *start, int *end);
+
 #endif /* AVCODEC_HUFFYUV_H */
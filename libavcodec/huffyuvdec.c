@@ -308,6 +308,8 @@ static av_cold int decode_init(AVCodecContext *avctx)
             s->version = 1; // do such files exist at all?
         else if (avctx->extradata_size > 3 && avctx->extradata[3] == 0)
             s->version = 2;
+        else if (avctx->extradata_size > 3 && (avctx->extradata[3] & 15) == 2)
+            s->version = 4;
         else
             s->version = 3;
     } else
@@ -336,6 +338,15 @@ static av_cold int decode_init(AVCodecContext *avctx)
             s->vlc_n = FFMIN(s->n, MAX_VLC_N);
             s->chroma_h_shift = avctx->extradata[1] & 3;
             s->chroma_v_shift = (avctx->extradata[1] >> 2) & 3;
+            if (s->version > 3) {
+                /* sliced streams store invalid subsampling values here, so
+                 * that older decoders refuse them, and the real ones along
+                 * with the version */
+                if ((avctx->extradata[1] & 15) != 15)
+                    return AVERROR_INVALIDDATA;
+                s->chroma_h_shift = (avctx->extradata[3] >> 4) & 3;
+                s->chroma_v_shift =  avctx->extradata[3] >> 6;
+            }
             s->yuv   = !!(avctx->extradata[2] & 1);
             s->chroma= !!(avctx->extradata[2] & 3);
             s->alpha = !!(avctx->extradata[2] & 4);
@@ -344,6 +355,12 @@ static av_cold int decode_init(AVCodecContext *avctx)
         s->interlaced = (interlace == 1) ? 1 : (interlace == 2) ? 0 : s->interlaced;
         s->context    = avctx->extradata[2] & 0x40 ? 1 : 0;
 
+        if (s->version > 3 && s->context) {
+            av_log(avctx, AV_LOG_ERROR,
+                   "per-frame huffman tables are not supported with slices\n");
+            return AVERROR_INVALIDDATA;
+        }
+
         if ((ret = read_huffman_tables(s, avctx->extradata + 4,
                                        avctx->extradata_size - 4)) < 0)
             goto error;
@@ -577,6 +594,9 @@ static av_cold int decode_init_thread_copy(AVCodecContext *avctx)
     HYuvContext *s = avctx->priv_data;
     int i, ret;
 
+    s->nb_slices = 0;
+    memset(s->slice_ctx, 0, sizeof(s->slice_ctx));
+
     if ((ret = ff_huffyuv_alloc_temp(s)) < 0) {
         ff_huffyuv_common_end(s);
         return ret;
@@ -901,6 +921,138 @@ static void add_median_prediction(HYuvContext *s, uint8_t *dst, const uint8_t *s
         s->llviddsp.add_hfyu_median_pred_int16((uint16_t *)dst, (const uint16_t *)src, (const uint16_t *)diff, s->n-1, w, left, left_top);
     }
 }
+static void decode_slice_planes(HYuvContext *s, AVFrame *p,
+                                int slice_start, int slice_end)
+{
+    int fake_ystride = s->interlaced ? p->linesize[0] * 2 : p->linesize[0];
+    int fake_ustride = s->interlaced ? p->linesize[1] * 2 : p->linesize[1];
+    int fake_vstride = s->interlaced ? p->linesize[2] * 2 : p->linesize[2];
+    int plane;
+
+    for(plane = 0; plane < 1 + 2*s->chroma + s->alpha; plane++) {
+        int left, lefttop, y;
+        int w = s->width;
+        int y0 = slice_start;
+        int h = slice_end - slice_start;
+        int fake_stride = fake_ystride;
+        uint8_t *data;
+
+        if (s->chroma && (plane == 1 || plane == 2)) {
+            w >>= s->chroma_h_shift;
+            y0  = slice_start >> s->chroma_v_shift;
+            h   = (slice_end >> s->chroma_v_shift) - y0;
+            fake_stride = plane == 1 ? fake_ustride : fake_vstride;
+        }
+        data = p->data[plane] + p->linesize[plane] * y0;
+
+        switch (s->predictor) {
+        case LEFT:
+        case PLANE:
+            decode_plane_bitstream(s, w, plane);
+            left = left_prediction(s, data, s->temp[0], w, 0);
+
+            for (y = 1; y < h; y++) {
+                uint8_t *dst = data + p->linesize[plane]*y;
+
+                decode_plane_bitstream(s, w, plane);
+                left = left_prediction(s, dst, s->temp[0], w, left);
+                if (s->predictor == PLANE) {
+                    if (y > s->interlaced) {
+                        add_bytes(s, dst, dst - fake_stride, w);
+                    }
+                }
+            }
+
+            break;
+        case MEDIAN:
+            decode_plane_bitstream(s, w, plane);
+            left= left_prediction(s, data, s->temp[0], w, 0);
+
+            y = 1;
+
+            /* second line is left predicted for interlaced case */
+            if (s->interlaced) {
+                decode_plane_bitstream(s, w, plane);
+                left = left_prediction(s, data + p->linesize[plane], s->temp[0], w, left);
+                y++;
+            }
+
+            lefttop = data[0];
+
+            for (; y<h; y++) {
+                uint8_t *dst;
+
+                decode_plane_bitstream(s, w, plane);
+
+                dst = data + p->linesize[plane] * y;
+
+                add_median_prediction(s, dst, dst - fake_stride, s->temp[0], w, &left, &lefttop);
+            }
+
+            break;
+        }
+    }
+}
+
+static int decode_slice(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    HYuvContext *s  = avctx->priv_data;
+    HYuvContext *fs = s->slice_ctx[jobnr];
+
+    decode_slice_planes(fs, arg, fs->slice_start, fs->slice_end);
+    emms_c();
+
+    return 0;
+}
+
+static int decode_frame_slices(AVCodecContext *avctx, AVFrame *p,
+                               const uint8_t *buf, int buf_size)
+{
+    HYuvContext *s = avctx->priv_data;
+    int nb_slices, header_size, slice_offset = 0;
+    int i, ret;
+
+    if (buf_size < 4)
+        return AVERROR_INVALIDDATA;
+    nb_slices = AV_RB32(buf);
+    if (nb_slices < 1 || nb_slices > ff_huffyuv_max_slices(s)) {
+        av_log(avctx, AV_LOG_ERROR, "invalid number of slices %d\n", nb_slices);
+        return AVERROR_INVALIDDATA;
+    }
+    header_size = 4 * (1 + nb_slices);
+    if (buf_size < header_size)
+        return AVERROR_INVALIDDATA;
+
+    /* the slice contexts share the huffman tables, which never change
+     * since per-frame tables are not allowed with slices */
+    if ((ret = ff_huffyuv_alloc_slice_contexts(s, nb_slices)) < 0)
+        return ret;
+
+    for (i = 0; i < nb_slices; i++) {
+        HYuvContext *fs = s->slice_ctx[i];
+        int slice_end   = AV_RB32(buf + 4 * (i + 1));
+
+        if (slice_end < slice_offset || slice_end > buf_size - header_size) {
+            av_log(avctx, AV_LOG_ERROR, "invalid slice size\n");
+            return AVERROR_INVALIDDATA;
+        }
+        ret = init_get_bits8(&fs->gb, buf + header_size + slice_offset,
+                             slice_end - slice_offset);
+        if (ret < 0)
+            return ret;
+        slice_offset = slice_end;
+
+        ff_huffyuv_slice_bounds(s, nb_slices, i, &fs->slice_start, &fs->slice_end);
+    }
+
+    avctx->execute2(avctx, decode_slice, p, NULL, nb_slices);
+
+    s->last_slice_end = 0;
+    draw_slice(s, p, s->height);
+
+    return header_size + slice_offset;
+}
+
 static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
                         AVPacket *avpkt)
 {
@@ -936,6 +1088,16 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
     if ((unsigned) (buf_size - table_size) >= INT_MAX / 8)
         return AVERROR_INVALIDDATA;
 
+    if (s->version > 3) {
+        ret = decode_frame_slices(avctx, p, s->bitstream_buffer + table_size,
+                                  buf_size - table_size);
+        if (ret < 0)
+            return ret;
+
+        *got_frame = 1;
+        return ret + table_size;
+    }
+
     if ((ret = init_get_bits(&s->gb, s->bitstream_buffer + table_size,
                              (buf_size - table_size) * 8)) < 0)
         return ret;
@@ -947,69 +1109,7 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
     s->last_slice_end = 0;
 
     if (s->version > 2) {
-        int plane;
-        for(plane = 0; plane < 1 + 2*s->chroma + s->alpha; plane++) {
-            int left, lefttop, y;
-            int w = width;
-            int h = height;
-            int fake_stride = fake_ystride;
-
-            if (s->chroma && (plane == 1 || plane == 2)) {
-                w >>= s->chroma_h_shift;
-                h >>= s->chroma_v_shift;
-                fake_stride = plane == 1 ? fake_ustride : fake_vstride;
-            }
-
-            switch (s->predictor) {
-            case LEFT:
-            case PLANE:
-                decode_plane_bitstream(s, w, plane);
-                left = left_prediction(s, p->data[plane], s->temp[0], w, 0);
-
-                for (y = 1; y < h; y++) {
-                    uint8_t *dst = p->data[plane] + p->linesize[plane]*y;
-
-                    decode_plane_bitstream(s, w, plane);
-                    left = left_prediction(s, dst, s->temp[0], w, left);
-                    if (s->predictor == PLANE) {
-                        if (y > s->interlaced) {
-                            add_bytes(s, dst, dst - fake_stride, w);
-                        }
-                    }
-                }
-
-                break;
-            case MEDIAN:
-                decode_plane_bitstream(s, w, plane);
-                left= left_prediction(s, p->data[plane], s->temp[0], w, 0);
-
-                y = 1;
-
-                /* second line is left predicted for interlaced case */
-                if (s->interlaced) {
-                    decode_plane_bitstream(s, w, plane);
-                    left = left_prediction(s, p->data[plane] + p->linesize[plane], s->temp[0], w, left);
-                    y++;
-                }
-
-                lefttop = p->data[plane][0];
-                decode_plane_bitstream(s, w, plane);
-                add_median_prediction(s, p->data[plane] + fake_stride, p->data[plane], s->temp[0], w, &left, &lefttop);
-                y++;
-
-                for (; y<h; y++) {
-                    uint8_t *dst;
-
-                    decode_plane_bitstream(s, w, plane);
-
-                    dst = p->data[plane] + p->linesize[plane] * y;
-
-                    add_median_prediction(s, dst, dst - fake_stride, s->temp[0], w, &left, &lefttop);
-                }
-
-                break;
-            }
-        }
+        decode_slice_planes(s, p, 0, height);
         draw_slice(s, p, height);
     } else if (s->bitstream_bpp < 24) {
         int y, cy;
@@ -1261,7 +1361,7 @@ AVCodec ff_ffvhuff_decoder = {
     .close            = decode_end,
     .decode           = decode_frame,
     .capabilities     = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DRAW_HORIZ_BAND |
-                        AV_CODEC_CAP_FRAME_THREADS,
+                        AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS,
     .init_thread_copy = ONLY_IF_THREADS_ENABLED(decode_init_thread_copy),
 };
 #endif /* CONFIG_FFVHUFF_DECODER */
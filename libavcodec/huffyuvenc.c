@@ -314,6 +314,29 @@ FF_ENABLE_DEPRECATION_WARNINGS
         av_log(avctx, AV_LOG_ERROR, "format not supported\n");
         return AVERROR(EINVAL);
     }
+
+    if (avctx->slices > 1) {
+        if (avctx->codec->id == AV_CODEC_ID_HUFFYUV) {
+            av_log(avctx, AV_LOG_ERROR,
+                   "Error: slices are not supported "
+                   "by huffyuv; use vcodec=ffvhuff\n");
+            return AVERROR(EINVAL);
+        }
+        if (s->bitstream_bpp >= 24) {
+            av_log(avctx, AV_LOG_ERROR,
+                   "Error: slices are not supported for packed RGB\n");
+            return AVERROR(EINVAL);
+        }
+        if (s->context || (s->flags & AV_CODEC_FLAG_PASS1)) {
+            av_log(avctx, AV_LOG_ERROR,
+                   "Error: slices are not compatible with context=1 "
+                   "or the first pass of 2 pass encoding\n");
+            return AVERROR(EINVAL);
+        }
+        /* the planar code path handles yuv420p and yuv422p as well */
+        s->bitstream_bpp = 0;
+        s->version       = 4;
+    }
     s->n = 1<<s->bps;
     s->vlc_n = FFMIN(s->n, MAX_VLC_N);
 
@@ -387,6 +410,13 @@ FF_ENABLE_DEPRECATION_WARNINGS
         if (s->alpha)
             ((uint8_t*)avctx->extradata)[2] |= 4;
         ((uint8_t*)avctx->extradata)[3] = 1;
+        if (s->version > 3) {
+            /* Store an invalid subsampling for decoders which do not know
+             * about slices, they then refuse the stream. */
+            ((uint8_t*)avctx->extradata)[1] |= 15;
+            ((uint8_t*)avctx->extradata)[3]  = 2 | s->chroma_h_shift << 4 |
+                                                   s->chroma_v_shift << 6;
+        }
     }
     s->avctx->extradata_size = 4;
 
@@ -442,6 +472,13 @@ FF_ENABLE_DEPRECATION_WARNINGS
         return AVERROR(ENOMEM);
     }
 
+    if (s->version > 3) {
+        ret = ff_huffyuv_alloc_slice_contexts(s, FFMIN(avctx->slices,
+                                                       ff_huffyuv_max_slices(s)));
+        if (ret < 0)
+            return ret;
+    }
+
     s->picture_number=0;
 
     return 0;
@@ -759,6 +796,144 @@ static inline int encode_bgra_bitstream(HYuvContext *s, int count, int planes)
     return 0;
 }
 
+static void encode_slice_planes(HYuvContext *s, const AVFrame *p,
+                                int slice_start, int slice_end)
+{
+    const int fake_ystride = s->interlaced ? p->linesize[0]*2  : p->linesize[0];
+    const int fake_ustride = s->interlaced ? p->linesize[1]*2  : p->linesize[1];
+    const int fake_vstride = s->interlaced ? p->linesize[2]*2  : p->linesize[2];
+    int plane;
+
+    for (plane = 0; plane < 1 + 2*s->chroma + s->alpha; plane++) {
+        int left, y;
+        int w = s->width;
+        int y0 = slice_start;
+        int h = slice_end - slice_start;
+        int fake_stride = fake_ystride;
+        uint8_t *data;
+
+        if (s->chroma && (plane == 1 || plane == 2)) {
+            w >>= s->chroma_h_shift;
+            y0  = slice_start >> s->chroma_v_shift;
+            h   = (slice_end >> s->chroma_v_shift) - y0;
+            fake_stride = plane == 1 ? fake_ustride : fake_vstride;
+        }
+        data = p->data[plane] + p->linesize[plane] * y0;
+
+        left = sub_left_prediction(s, s->temp[0], data, w , 0);
+
+        encode_plane_bitstream(s, w, plane);
+
+        if (s->predictor==MEDIAN) {
+            int lefttop;
+            y = 1;
+            if (s->interlaced) {
+                left = sub_left_prediction(s, s->temp[0], data + p->linesize[plane], w , left);
+
+                encode_plane_bitstream(s, w, plane);
+                y++;
+            }
+
+            lefttop = data[0];
+
+            for (; y < h; y++) {
+                uint8_t *dst = data + p->linesize[plane] * y;
+
+                sub_median_prediction(s, s->temp[0], dst - fake_stride, dst, w , &left, &lefttop);
+
+                encode_plane_bitstream(s, w, plane);
+            }
+        } else {
+            for (y = 1; y < h; y++) {
+                uint8_t *dst = data + p->linesize[plane] * y;
+
+                if (s->predictor == PLANE && s->interlaced < y) {
+                    diff_bytes(s, s->temp[1], dst, dst - fake_stride, w);
+
+                    left = sub_left_prediction(s, s->temp[0], s->temp[1], w , left);
+                } else {
+                    left = sub_left_prediction(s, s->temp[0], dst, w , left);
+                }
+
+                encode_plane_bitstream(s, w, plane);
+            }
+        }
+    }
+}
+
+static int encode_slice(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    HYuvContext *s   = avctx->priv_data;
+    HYuvContext *fs  = s->slice_ctx[jobnr];
+    const AVFrame *p = arg;
+    int words;
+
+    encode_slice_planes(fs, p, fs->slice_start, fs->slice_end);
+    emms_c();
+
+    words = (put_bits_count(&fs->pb) + 31) / 32;
+    put_bits(&fs->pb, 16, 0);
+    put_bits(&fs->pb, 15, 0);
+    fs->slice_size = words * 4;
+
+    if (!(avctx->flags2 & AV_CODEC_FLAG2_NO_OUTPUT)) {
+        flush_put_bits(&fs->pb);
+        s->bdsp.bswap_buf((uint32_t *) fs->pb.buf, (uint32_t *) fs->pb.buf, words);
+    }
+    return 0;
+}
+
+/**
+ * Sliced frames start with the number of slices followed by the end offset
+ * of every slice, as 32-bit words relative to the first slice, then the
+ * independently coded slices themselves.
+ */
+static int encode_frame_slices(AVCodecContext *avctx, AVPacket *pkt,
+                               const AVFrame *pict)
+{
+    HYuvContext *s  = avctx->priv_data;
+    int header_size = 4 * (1 + s->nb_slices);
+    uint8_t *dst;
+    int i, ret;
+
+    if ((ret = ff_alloc_packet2(avctx, pkt, s->width * s->height * 3 * 4 +
+                                header_size + 4 * s->nb_slices +
+                                AV_INPUT_BUFFER_MIN_SIZE, 0)) < 0)
+        return ret;
+
+    dst = pkt->data + header_size;
+    for (i = 0; i < s->nb_slices; i++) {
+        HYuvContext *fs = s->slice_ctx[i];
+        int size;
+
+        ff_huffyuv_slice_bounds(s, s->nb_slices, i, &fs->slice_start, &fs->slice_end);
+        size = (fs->slice_end - fs->slice_start) * s->width * 3 * 4 + 4;
+        init_put_bits(&fs->pb, dst, size);
+        dst += size;
+    }
+
+    avctx->execute2(avctx, encode_slice, (void *)pict, NULL, s->nb_slices);
+
+    /* the header is byteswapped along with the rest of the packet
+     * by the decoder, hence the little-endian writes */
+    AV_WL32(pkt->data, s->nb_slices);
+    dst = pkt->data + header_size;
+    for (i = 0; i < s->nb_slices; i++) {
+        HYuvContext *fs = s->slice_ctx[i];
+
+        memmove(dst, fs->pb.buf, fs->slice_size);
+        dst += fs->slice_size;
+        AV_WL32(pkt->data + 4 * (i + 1), dst - pkt->data - header_size);
+    }
+
+    s->picture_number++;
+
+    pkt->size   = dst - pkt->data;
+    pkt->flags |= AV_PKT_FLAG_KEY;
+
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pict, int *got_packet)
 {
@@ -772,6 +947,16 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     const AVFrame * const p = pict;
     int i, j, size = 0, ret;
 
+    if (s->version > 3) {
+        ret = encode_frame_slices(avctx, pkt, pict);
+        if (ret < 0)
+            return ret;
+        if (avctx->stats_out)
+            avctx->stats_out[0] = '\0';
+        *got_packet = 1;
+        return 0;
+    }
+
     if ((ret = ff_alloc_packet2(avctx, pkt, width * height * 3 * 4 + AV_INPUT_BUFFER_MIN_SIZE, 0)) < 0)
         return ret;
 
@@ -950,58 +1135,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
             encode_bgra_bitstream(s, width, 3);
         }
     } else if (s->version > 2) {
-        int plane;
-        for (plane = 0; plane < 1 + 2*s->chroma + s->alpha; plane++) {
-            int left, y;
-            int w = width;
-            int h = height;
-            int fake_stride = fake_ystride;
-
-            if (s->chroma && (plane == 1 || plane == 2)) {
-                w >>= s->chroma_h_shift;
-                h >>= s->chroma_v_shift;
-                fake_stride = plane == 1 ? fake_ustride : fake_vstride;
-            }
-
-            left = sub_left_prediction(s, s->temp[0], p->data[plane], w , 0);
-
-            encode_plane_bitstream(s, w, plane);
-
-            if (s->predictor==MEDIAN) {
-                int lefttop;
-                y = 1;
-                if (s->interlaced) {
-                    left = sub_left_prediction(s, s->temp[0], p->data[plane] + p->linesize[plane], w , left);
-
-                    encode_plane_bitstream(s, w, plane);
-                    y++;
-                }
-
-                lefttop = p->data[plane][0];
-
-                for (; y < h; y++) {
-                    uint8_t *dst = p->data[plane] + p->linesize[plane] * y;
-
-                    sub_median_prediction(s, s->temp[0], dst - fake_stride, dst, w , &left, &lefttop);
-
-                    encode_plane_bitstream(s, w, plane);
-                }
-            } else {
-                for (y = 1; y < h; y++) {
-                    uint8_t *dst = p->data[plane] + p->linesize[plane] * y;
-
-                    if (s->predictor == PLANE && s->interlaced < y) {
-                        diff_bytes(s, s->temp[1], dst, dst - fake_stride, w);
-
-                        left = sub_left_prediction(s, s->temp[0], s->temp[1], w , left);
-                    } else {
-                        left = sub_left_prediction(s, s->temp[0], dst, w , left);
-                    }
-
-                    encode_plane_bitstream(s, w, plane);
-                }
-            }
-        }
+        encode_slice_planes(s, p, 0, height);
     } else {
         av_log(avctx, AV_LOG_ERROR, "Format not supported!\n");
     }
@@ -1121,7 +1255,8 @@ AVCodec ff_ffvhuff_encoder = {
     .init           = encode_init,
     .encode2        = encode_frame,
     .close          = encode_end,
-    .capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_INTRA_ONLY,
+    .capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS |
+                      AV_CODEC_CAP_INTRA_ONLY,
     .priv_class     = &ff_class,
     .pix_fmts       = (const enum AVPixelFormat[]){
         AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV411P,
@@ -124,6 +124,7 @@ typedef struct {
     Jpeg2000QuantStyle  qntsty;
 
     Jpeg2000Tile *tile;
+    int *job_ret;      ///< return values of the per tile component jobs
 
     int format;
     int pred;
@@ -411,6 +412,9 @@ static int init_tiles(Jpeg2000EncoderContext *s)
     s->tile = av_malloc_array(s->numXtiles, s->numYtiles * sizeof(Jpeg2000Tile));
     if (!s->tile)
         return AVERROR(ENOMEM);
+    s->job_ret = av_malloc_array(s->numXtiles * s->numYtiles, s->ncomponents * sizeof(*s->job_ret));
+    if (!s->job_ret)
+        return AVERROR(ENOMEM);
     for (tileno = 0, tiley = 0; tiley < s->numYtiles; tiley++)
         for (tilex = 0; tilex < s->numXtiles; tilex++, tileno++){
             Jpeg2000Tile *tile = s->tile + tileno;
@@ -876,78 +880,91 @@ static void truncpasses(Jpeg2000EncoderContext *s, Jpeg2000Tile *tile)
     }
 }
 
-static int encode_tile(Jpeg2000EncoderContext *s, Jpeg2000Tile *tile, int tileno)
+/**
+ * Run the DWT and tier-1 coding of one component of one tile.
+ * Components and tiles do not share any state up to tier-2 coding, so this
+ * is run as one slice thread job per (tile, component) pair.
+ */
+static int encode_tile_comp(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
 {
-    int compno, reslevelno, bandno, ret;
+    Jpeg2000EncoderContext *s = avctx->priv_data;
+    int tileno = jobnr / s->ncomponents;
+    int compno = jobnr % s->ncomponents;
+    int reslevelno, bandno, ret;
     Jpeg2000T1Context t1;
     Jpeg2000CodingStyle *codsty = &s->codsty;
-    for (compno = 0; compno < s->ncomponents; compno++){
-        Jpeg2000Component *comp = s->tile[tileno].comp + compno;
-
-        t1.stride = (1<<codsty->log2_cblk_width) + 2;
-
-        av_log(s->avctx, AV_LOG_DEBUG,"dwt\n");
-        if ((ret = ff_dwt_encode(&comp->dwt, comp->i_data)) < 0)
-            return ret;
-        av_log(s->avctx, AV_LOG_DEBUG,"after dwt -> tier1\n");
-
-        for (reslevelno = 0; reslevelno < codsty->nreslevels; reslevelno++){
-            Jpeg2000ResLevel *reslevel = comp->reslevel + reslevelno;
+    Jpeg2000Tile *tile = s->tile + tileno;
+    Jpeg2000Component *comp = tile->comp + compno;
 
-            for (bandno = 0; bandno < reslevel->nbands ; bandno++){
-                Jpeg2000Band *band = reslevel->band + bandno;
-                Jpeg2000Prec *prec = band->prec; // we support only 1 precinct per band ATM in the encoder
-                int cblkx, cblky, cblkno=0, xx0, x0, xx1, y0, yy0, yy1, bandpos;
-                yy0 = bandno == 0 ? 0 : comp->reslevel[reslevelno-1].coord[1][1] - comp->reslevel[reslevelno-1].coord[1][0];
-                y0 = yy0;
-                yy1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[1][0] + 1, band->log2_cblk_height) << band->log2_cblk_height,
-                            band->coord[1][1]) - band->coord[1][0] + yy0;
+    t1.stride = (1<<codsty->log2_cblk_width) + 2;
 
-                if (band->coord[0][0] == band->coord[0][1] || band->coord[1][0] == band->coord[1][1])
-                    continue;
+    av_log(s->avctx, AV_LOG_DEBUG,"dwt\n");
+    if ((ret = ff_dwt_encode(&comp->dwt, comp->i_data)) < 0)
+        return ret;
+    av_log(s->avctx, AV_LOG_DEBUG,"after dwt -> tier1\n");
 
-                bandpos = bandno + (reslevelno > 0);
-
-                for (cblky = 0; cblky < prec->nb_codeblocks_height; cblky++){
-                    if (reslevelno == 0 || bandno == 1)
-                        xx0 = 0;
-                    else
-                        xx0 = comp->reslevel[reslevelno-1].coord[0][1] - comp->reslevel[reslevelno-1].coord[0][0];
-                    x0 = xx0;
-                    xx1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[0][0] + 1, band->log2_cblk_width) << band->log2_cblk_width,
-                                band->coord[0][1]) - band->coord[0][0] + xx0;
-
-                    for (cblkx = 0; cblkx < prec->nb_codeblocks_width; cblkx++, cblkno++){
-                        int y, x;
-                        if (codsty->transform == FF_DWT53){
-                            for (y = yy0; y < yy1; y++){
-                                int *ptr = t1.data + (y-yy0)*t1.stride;
-                                for (x = xx0; x < xx1; x++){
-                                    *ptr++ = comp->i_data[(comp->coord[0][1] - comp->coord[0][0]) * y + x] << NMSEDEC_FRACBITS;
-                                }
+    for (reslevelno = 0; reslevelno < codsty->nreslevels; reslevelno++){
+        Jpeg2000ResLevel *reslevel = comp->reslevel + reslevelno;
+
+        for (bandno = 0; bandno < reslevel->nbands ; bandno++){
+            Jpeg2000Band *band = reslevel->band + bandno;
+            Jpeg2000Prec *prec = band->prec; // we support only 1 precinct per band ATM in the encoder
+            int cblkx, cblky, cblkno=0, xx0, x0, xx1, y0, yy0, yy1, bandpos;
+            yy0 = bandno == 0 ? 0 : comp->reslevel[reslevelno-1].coord[1][1] - comp->reslevel[reslevelno-1].coord[1][0];
+            y0 = yy0;
+            yy1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[1][0] + 1, band->log2_cblk_height) << band->log2_cblk_height,
+                        band->coord[1][1]) - band->coord[1][0] + yy0;
+
+            if (band->coord[0][0] == band->coord[0][1] || band->coord[1][0] == band->coord[1][1])
+                continue;
+
+            bandpos = bandno + (reslevelno > 0);
+
+            for (cblky = 0; cblky < prec->nb_codeblocks_height; cblky++){
+                if (reslevelno == 0 || bandno == 1)
+                    xx0 = 0;
+                else
+                    xx0 = comp->reslevel[reslevelno-1].coord[0][1] - comp->reslevel[reslevelno-1].coord[0][0];
+                x0 = xx0;
+                xx1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[0][0] + 1, band->log2_cblk_width) << band->log2_cblk_width,
+                            band->coord[0][1]) - band->coord[0][0] + xx0;
+
+                for (cblkx = 0; cblkx < prec->nb_codeblocks_width; cblkx++, cblkno++){
+                    int y, x;
+                    if (codsty->transform == FF_DWT53){
+                        for (y = yy0; y < yy1; y++){
+                            int *ptr = t1.data + (y-yy0)*t1.stride;
+                            for (x = xx0; x < xx1; x++){
+                                *ptr++ = comp->i_data[(comp->coord[0][1] - comp->coord[0][0]) * y + x] << NMSEDEC_FRACBITS;
                             }
-                        } else{
-                            for (y = yy0; y < yy1; y++){
-                                int *ptr = t1.data + (y-yy0)*t1.stride;
-                                for (x = xx0; x < xx1; x++){
-                                    *ptr = (comp->i_data[(comp->coord[0][1] - comp->coord[0][0]) * y + x]);
-                                    *ptr = (int64_t)*ptr * (int64_t)(16384 * 65536 / band->i_stepsize) >> 15 - NMSEDEC_FRACBITS;
-                                    ptr++;
-                                }
+                        }
+                    } else{
+                        for (y = yy0; y < yy1; y++){
+                            int *ptr = t1.data + (y-yy0)*t1.stride;
+                            for (x = xx0; x < xx1; x++){
+                                *ptr = (comp->i_data[(comp->coord[0][1] - comp->coord[0][0]) * y + x]);
+                                *ptr = (int64_t)*ptr * (int64_t)(16384 * 65536 / band->i_stepsize) >> 15 - NMSEDEC_FRACBITS;
+                                ptr++;
                             }
                         }
-                        encode_cblk(s, &t1, prec->cblk + cblkno, tile, xx1 - xx0, yy1 - yy0,
-                                    bandpos, codsty->nreslevels - reslevelno - 1);
-                        xx0 = xx1;
-                        xx1 = FFMIN(xx1 + (1 << band->log2_cblk_width), band->coord[0][1] - band->coord[0][0] + x0);
                     }
-                    yy0 = yy1;
-                    yy1 = FFMIN(yy1 + (1 << band->log2_cblk_height), band->coord[1][1] - band->coord[1][0] + y0);
+                    encode_cblk(s, &t1, prec->cblk + cblkno, tile, xx1 - xx0, yy1 - yy0,
+                                bandpos, codsty->nreslevels - reslevelno - 1);
+                    xx0 = xx1;
+                    xx1 = FFMIN(xx1 + (1 << band->log2_cblk_width), band->coord[0][1] - band->coord[0][0] + x0);
                 }
+                yy0 = yy1;
+                yy1 = FFMIN(yy1 + (1 << band->log2_cblk_height), band->coord[1][1] - band->coord[1][0] + y0);
             }
         }
-        av_log(s->avctx, AV_LOG_DEBUG, "after tier1\n");
     }
+    av_log(s->avctx, AV_LOG_DEBUG, "after tier1\n");
+    return 0;
+}
+
+static int encode_tile(Jpeg2000EncoderContext *s, Jpeg2000Tile *tile, int tileno)
+{
+    int ret;
 
     av_log(s->avctx, AV_LOG_DEBUG, "rate control\n");
     truncpasses(s, tile);
@@ -970,6 +987,7 @@ static void cleanup(Jpeg2000EncoderContext *s)
         av_freep(&s->tile[tileno].comp);
     }
     av_freep(&s->tile);
+    av_freep(&s->job_ret);
 }
 
 static void reinit(Jpeg2000EncoderContext *s)
@@ -990,7 +1008,7 @@ static void update_size(uint8_t *size, const uint8_t *end)
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pict, int *got_packet)
 {
-    int tileno, ret;
+    int tileno, i, ret;
     Jpeg2000EncoderContext *s = avctx->priv_data;
     uint8_t *chunkstart, *jp2cstart, *jp2hstart;
 
@@ -1008,6 +1026,12 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     copy_frame(s);
     reinit(s);
 
+    avctx->execute2(avctx, encode_tile_comp, NULL, s->job_ret,
+                    s->numXtiles * s->numYtiles * s->ncomponents);
+    for (i = 0; i < s->numXtiles * s->numYtiles * s->ncomponents; i++)
+        if (s->job_ret[i] < 0)
+            return s->job_ret[i];
+
     if (s->format == CODEC_JP2) {
         av_assert0(s->buf == pkt->data);
 
@@ -1208,6 +1232,8 @@ AVCodec ff_jpeg2000_encoder = {
     .init           = j2kenc_init,
     .encode2        = encode_frame,
     .close          = j2kenc_destroy,
+    .capabilities   = AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_INTRA_ONLY,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_RGB24, AV_PIX_FMT_YUV444P, AV_PIX_FMT_GRAY8,
         AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P,
@@ -36,6 +36,7 @@
 #include <zlib.h>
 
 #define IOBUF_SIZE 4096
+#define MAX_SLICES 256
 
 typedef struct APNGFctlChunk {
     uint32_t sequence_number;
@@ -45,6 +46,16 @@ typedef struct APNGFctlChunk {
     uint8_t dispose_op, blend_op;
 } APNGFctlChunk;
 
+typedef struct PNGEncSlice {
+    z_stream zstream;
+    uint8_t *crow_base;          ///< scratch buffer for filtering the rows of this slice
+    uint8_t *buf;                ///< compressed data of this slice
+    unsigned int buf_size;
+    int len;                     ///< number of bytes in buf
+    uint32_t adler;              ///< Adler-32 of the filtered rows of this slice
+    int start, end;              ///< first and past-the-last row of this slice
+} PNGEncSlice;
+
 typedef struct PNGEncContext {
     AVClass *class;
     HuffYUVEncDSPContext hdsp;
@@ -65,6 +76,13 @@ typedef struct PNGEncContext {
     int color_type;
     int bits_per_pixel;
 
+    // parallel deflate
+    PNGEncSlice *slices;
+    int max_slices;
+    int nb_slices;
+    uint8_t *filtered_buf;       ///< filter type byte and filtered data of every row
+    unsigned int filtered_buf_size;
+
     // APNG
     uint32_t palette_checksum;   // Used to ensure a single unique palette
     uint32_t sequence_number;
@@ -425,6 +443,124 @@ static int encode_headers(AVCodecContext *avctx, const AVFrame *pict)
     return 0;
 }
 
+static int png_filter_slice(AVCodecContext *avctx, void *arg,
+                            int jobnr, int threadnr)
+{
+    PNGEncContext *s       = avctx->priv_data;
+    const AVFrame *const p = arg;
+    PNGEncSlice *sl        = &s->slices[jobnr];
+    int row_size = (p->width * s->bits_per_pixel + 7) >> 3;
+    uint8_t *crow_buf = sl->crow_base + 15;
+    uint8_t *ptr, *top, *crow;
+    int y;
+
+    for (y = sl->start; y < sl->end; y++) {
+        ptr  = p->data[0] + y * p->linesize[0];
+        top  = y ? ptr - p->linesize[0] : NULL;
+        crow = png_choose_filter(s, crow_buf, ptr, top,
+                                 row_size, s->bits_per_pixel >> 3);
+        memcpy(s->filtered_buf + y * (row_size + 1), crow, row_size + 1);
+    }
+    return 0;
+}
+
+/**
+ * Compress the filtered rows of one slice. The first slice carries the zlib
+ * header, all the other ones are raw deflate streams primed with the last
+ * 32 KiB of the preceding rows. Every slice but the last one ends with a
+ * sync flush, so their concatenation is a single valid zlib stream once the
+ * combined Adler-32 is appended.
+ */
+static int png_deflate_slice(AVCodecContext *avctx, void *arg,
+                             int jobnr, int threadnr)
+{
+    PNGEncContext *s       = avctx->priv_data;
+    const AVFrame *const p = arg;
+    PNGEncSlice *sl        = &s->slices[jobnr];
+    z_stream *zstream      = &sl->zstream;
+    int row_size = (p->width * s->bits_per_pixel + 7) >> 3;
+    int last     = jobnr == s->nb_slices - 1;
+    const uint8_t *src = s->filtered_buf + sl->start * (row_size + 1);
+    int size           = (sl->end - sl->start) * (row_size + 1);
+    int ret;
+
+    av_fast_malloc(&sl->buf, &sl->buf_size, deflateBound(zstream, size) + 16);
+    if (!sl->buf)
+        return AVERROR(ENOMEM);
+
+    if (jobnr) {
+        int dict_size = FFMIN(sl->start * (row_size + 1), 1 << 15);
+        if (deflateSetDictionary(zstream, src - dict_size, dict_size) != Z_OK)
+            return AVERROR_EXTERNAL;
+    }
+
+    zstream->next_in   = src;
+    zstream->avail_in  = size;
+    zstream->next_out  = sl->buf;
+    zstream->avail_out = sl->buf_size;
+    ret = deflate(zstream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    sl->len = sl->buf_size - zstream->avail_out;
+    deflateReset(zstream);
+    if (ret != (last ? Z_STREAM_END : Z_OK) || zstream->avail_in)
+        return AVERROR_EXTERNAL;
+
+    sl->adler = adler32(adler32(0, NULL, 0), src, size);
+    return 0;
+}
+
+static int encode_frame_slices(AVCodecContext *avctx, const AVFrame *pict)
+{
+    PNGEncContext *s = avctx->priv_data;
+    int row_size = (pict->width * s->bits_per_pixel + 7) >> 3;
+    int ret[MAX_SLICES];
+    uint32_t adler;
+    int i, j;
+
+    s->nb_slices = FFMIN(s->max_slices, pict->height);
+
+    av_fast_malloc(&s->filtered_buf, &s->filtered_buf_size,
+                   (size_t)pict->height * (row_size + 1));
+    if (!s->filtered_buf)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < s->nb_slices; i++) {
+        s->slices[i].start = pict->height *  i      / s->nb_slices;
+        s->slices[i].end   = pict->height * (i + 1) / s->nb_slices;
+    }
+
+    /* rows are predicted from the unfiltered previous row, so the whole
+     * image must be filtered before any slice can use the tail of the
+     * preceding one as its dictionary */
+    avctx->execute2(avctx, png_filter_slice, (void *)pict, NULL, s->nb_slices);
+    avctx->execute2(avctx, png_deflate_slice, (void *)pict, ret, s->nb_slices);
+
+    adler = s->slices[0].adler;
+    for (i = 0; i < s->nb_slices; i++) {
+        PNGEncSlice *sl = &s->slices[i];
+
+        if (ret[i] < 0)
+            return ret[i];
+        if (i)
+            adler = adler32_combine(adler, sl->adler,
+                                    (sl->end - sl->start) * (row_size + 1));
+    }
+    AV_WB32(s->slices[s->nb_slices - 1].buf + s->slices[s->nb_slices - 1].len, adler);
+    s->slices[s->nb_slices - 1].len += 4;
+
+    for (i = 0; i < s->nb_slices; i++) {
+        PNGEncSlice *sl = &s->slices[i];
+
+        for (j = 0; j < sl->len; j += IOBUF_SIZE) {
+            int len = FFMIN(sl->len - j, IOBUF_SIZE);
+            if (s->bytestream_end - s->bytestream <= len + 100)
+                return AVERROR_BUG;
+            png_write_image_data(avctx, sl->buf + j, len);
+        }
+    }
+
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
 {
     PNGEncContext *s       = avctx->priv_data;
@@ -436,6 +572,9 @@ static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
     uint8_t *progressive_buf = NULL;
     uint8_t *top_buf         = NULL;
 
+    if (s->max_slices > 1 && pict->height > 1)
+        return encode_frame_slices(avctx, pict);
+
     row_size = (pict->width * s->bits_per_pixel + 7) >> 3;
 
     crow_base = av_malloc((row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
@@ -1082,14 +1221,48 @@ FF_ENABLE_DEPRECATION_WARNINGS
     if (deflateInit2(&s->zstream, compression_level, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
         return -1;
 
+    if (avctx->slices > 1 && !s->is_progressive) {
+        int row_size = (avctx->width * s->bits_per_pixel + 7) >> 3;
+        int i;
+
+        s->max_slices = FFMIN(avctx->slices, MAX_SLICES);
+        s->slices     = av_mallocz_array(s->max_slices, sizeof(*s->slices));
+        if (!s->slices)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < s->max_slices; i++) {
+            PNGEncSlice *sl = &s->slices[i];
+
+            sl->crow_base = av_malloc((row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
+            if (!sl->crow_base)
+                return AVERROR(ENOMEM);
+            sl->zstream.zalloc = ff_png_zalloc;
+            sl->zstream.zfree  = ff_png_zfree;
+            sl->zstream.opaque = NULL;
+            if (deflateInit2(&sl->zstream, compression_level, Z_DEFLATED,
+                             i ? -15 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                sl->zstream.zalloc = NULL;
+                return -1;
+            }
+        }
+    }
+
     return 0;
 }
 
 static av_cold int png_enc_close(AVCodecContext *avctx)
 {
     PNGEncContext *s = avctx->priv_data;
+    int i;
 
     deflateEnd(&s->zstream);
+    for (i = 0; s->slices && i < s->max_slices; i++) {
+        if (s->slices[i].zstream.zalloc)
+            deflateEnd(&s->slices[i].zstream);
+        av_freep(&s->slices[i].crow_base);
+        av_freep(&s->slices[i].buf);
+    }
+    av_freep(&s->slices);
+    av_freep(&s->filtered_buf);
     av_frame_free(&s->last_frame);
     av_frame_free(&s->prev_frame);
     av_freep(&s->last_frame_packet);
@@ -1134,7 +1307,8 @@ AVCodec ff_png_encoder = {
     .init           = png_enc_init,
     .close          = png_enc_close,
     .encode2        = encode_png,
-    .capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_INTRA_ONLY,
+    .capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS |
+                      AV_CODEC_CAP_INTRA_ONLY,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGBA,
         AV_PIX_FMT_RGB48BE, AV_PIX_FMT_RGBA64BE,
@@ -1155,7 +1329,7 @@ AVCodec ff_apng_encoder = {
     .init           = png_enc_init,
     .close          = png_enc_close,
     .encode2        = encode_apng,
-    .capabilities   = CODEC_CAP_DELAY,
+    .capabilities   = CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGBA,
         AV_PIX_FMT_RGB48BE, AV_PIX_FMT_RGBA64BE,
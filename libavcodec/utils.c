@@ -553,6 +553,8 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
                 pool->pools[i] = av_buffer_pool_init(size[i] + 16 + STRIDE_ALIGN - 1,
                                                      CONFIG_MEMORY_POISONING ?
                                                         NULL :
+                                                     avctx->flags2 & AV_CODEC_FLAG2_HUGEPAGES ?
+                                                        av_buffer_alloc_hugepages :
                                                         av_buffer_allocz);
                 if (!pool->pools[i]) {
                     ret = AVERROR(ENOMEM);
@@ -122,89 +122,50 @@ static int build_huff(const uint8_t *src, VLC *vlc, int *fsym)
                               syms,  sizeof(*syms),  sizeof(*syms), 0);
 }
 
-static int decode_plane10(UtvideoContext *c, int plane_no,
-                          uint16_t *dst, int step, int stride,
-                          int width, int height,
-                          const uint8_t *src, const uint8_t *huff,
-                          int use_pred)
+typedef struct UtvideoPlane {
+    uint8_t *dst;        ///< first sample of the plane
+    int step, stride;    ///< in samples, not bytes
+    int width, height;
+    int cmask;           ///< mask applied to slice boundaries
+    int rmode;           ///< 4:2:0 luma, passed on to median restoration
+    const uint8_t *src;  ///< slice end offsets followed by the slice data
+    VLC vlc;
+    int fsym;
+} UtvideoPlane;
+
+typedef struct UtvideoFrameJobs {
+    UtvideoPlane plane[4];
+    int nb_planes;
+    int slice_bits_stride;
+    AVFrame *frame;
+} UtvideoFrameJobs;
+
+static int decode_slice10(AVCodecContext *avctx, void *arg,
+                          int jobnr, int threadnr)
 {
-    int i, j, slice, pix, ret;
+    UtvideoContext *c     = avctx->priv_data;
+    UtvideoFrameJobs *fj  = arg;
+    const int plane_no    = jobnr / c->slices;
+    const int slice       = jobnr % c->slices;
+    UtvideoPlane *p       = &fj->plane[plane_no];
+    const int use_pred    = c->frame_pred == PRED_LEFT;
+    uint8_t *slice_bits   = c->slice_bits + threadnr * fj->slice_bits_stride;
+    const uint8_t *src    = p->src;
+    int i, j, pix;
     int sstart, send;
-    VLC vlc;
     GetBitContext gb;
-    int prev, fsym;
-
-    if ((ret = build_huff10(huff, &vlc, &fsym)) < 0) {
-        av_log(c->avctx, AV_LOG_ERROR, "Cannot build Huffman codes\n");
-        return ret;
-    }
-    if (fsym >= 0) { // build_huff reported a symbol to fill slices with
-        send = 0;
-        for (slice = 0; slice < c->slices; slice++) {
-            uint16_t *dest;
-
-            sstart = send;
-            send   = (height * (slice + 1) / c->slices);
-            dest   = dst + sstart * stride;
-
-            prev = 0x200;
-            for (j = sstart; j < send; j++) {
-                for (i = 0; i < width * step; i += step) {
-                    pix = fsym;
-                    if (use_pred) {
-                        prev += pix;
-                        prev &= 0x3FF;
-                        pix   = prev;
-                    }
-                    dest[i] = pix;
-                }
-                dest += stride;
-            }
-        }
-        return 0;
-    }
-
-    send = 0;
-    for (slice = 0; slice < c->slices; slice++) {
-        uint16_t *dest;
-        int slice_data_start, slice_data_end, slice_size;
-
-        sstart = send;
-        send   = (height * (slice + 1) / c->slices);
-        dest   = dst + sstart * stride;
+    int prev, slice_data_start, slice_data_end, slice_size;
+    uint16_t *dest;
 
-        // slice offset and size validation was done earlier
-        slice_data_start = slice ? AV_RL32(src + slice * 4 - 4) : 0;
-        slice_data_end   = AV_RL32(src + slice * 4);
-        slice_size       = slice_data_end - slice_data_start;
-
-        if (!slice_size) {
-            av_log(c->avctx, AV_LOG_ERROR, "Plane has more than one symbol "
-                   "yet a slice has a length of zero.\n");
-            goto fail;
-        }
-
-        memcpy(c->slice_bits, src + slice_data_start + c->slices * 4,
-               slice_size);
-        memset(c->slice_bits + slice_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
-        c->bdsp.bswap_buf((uint32_t *) c->slice_bits,
-                          (uint32_t *) c->slice_bits,
-                          (slice_data_end - slice_data_start + 3) >> 2);
-        init_get_bits(&gb, c->slice_bits, slice_size * 8);
+    sstart = p->height * slice       / c->slices;
+    send   = p->height * (slice + 1) / c->slices;
+    dest   = (uint16_t *)p->dst + sstart * p->stride;
 
+    if (p->fsym >= 0) { // build_huff reported a symbol to fill slices with
         prev = 0x200;
         for (j = sstart; j < send; j++) {
-            for (i = 0; i < width * step; i += step) {
-                if (get_bits_left(&gb) <= 0) {
-                    av_log(c->avctx, AV_LOG_ERROR,
-                           "Slice decoding ran out of bits\n");
-                    goto fail;
-                }
-                pix = get_vlc2(&gb, vlc.table, vlc.bits, 3);
-                if (pix < 0) {
-                    av_log(c->avctx, AV_LOG_ERROR, "Decoding error\n");
-                    goto fail;
-                }
+            for (i = 0; i < p->width * p->step; i += p->step) {
+                pix = p->fsym;
                 if (use_pred) {
                     prev += pix;
                     prev &= 0x3FF;
@@ -212,124 +173,137 @@ static int decode_plane10(UtvideoContext *c, int plane_no,
                 }
                 dest[i] = pix;
             }
-            dest += stride;
+            dest += p->stride;
         }
-        if (get_bits_left(&gb) > 32)
-            av_log(c->avctx, AV_LOG_WARNING,
-                   "%d bits left after decoding slice\n", get_bits_left(&gb));
+        return 0;
     }
 
-    ff_free_vlc(&vlc);
-
-    return 0;
-fail:
-    ff_free_vlc(&vlc);
-    return AVERROR_INVALIDDATA;
-}
+    // slice offset and size validation was done earlier
+    slice_data_start = slice ? AV_RL32(src + slice * 4 - 4) : 0;
+    slice_data_end   = AV_RL32(src + slice * 4);
+    slice_size       = slice_data_end - slice_data_start;
 
-static int decode_plane(UtvideoContext *c, int plane_no,
-                        uint8_t *dst, int step, int stride,
-                        int width, int height,
-                        const uint8_t *src, int use_pred)
-{
-    int i, j, slice, pix;
-    int sstart, send;
-    VLC vlc;
-    GetBitContext gb;
-    int prev, fsym;
-    const int cmask = ~(!plane_no && c->avctx->pix_fmt == AV_PIX_FMT_YUV420P);
-
-    if (build_huff(src, &vlc, &fsym)) {
-        av_log(c->avctx, AV_LOG_ERROR, "Cannot build Huffman codes\n");
+    if (!slice_size) {
+        av_log(avctx, AV_LOG_ERROR, "Plane has more than one symbol "
+               "yet a slice has a length of zero.\n");
         return AVERROR_INVALIDDATA;
     }
-    if (fsym >= 0) { // build_huff reported a symbol to fill slices with
-        send = 0;
-        for (slice = 0; slice < c->slices; slice++) {
-            uint8_t *dest;
-
-            sstart = send;
-            send   = (height * (slice + 1) / c->slices) & cmask;
-            dest   = dst + sstart * stride;
-
-            prev = 0x80;
-            for (j = sstart; j < send; j++) {
-                for (i = 0; i < width * step; i += step) {
-                    pix = fsym;
-                    if (use_pred) {
-                        prev += pix;
-                        pix   = prev;
-                    }
-                    dest[i] = pix;
-                }
-                dest += stride;
+
+    memcpy(slice_bits, src + slice_data_start + c->slices * 4, slice_size);
+    memset(slice_bits + slice_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    c->bdsp.bswap_buf((uint32_t *) slice_bits, (uint32_t *) slice_bits,
+                      (slice_size + 3) >> 2);
+    init_get_bits(&gb, slice_bits, slice_size * 8);
+
+    prev = 0x200;
+    for (j = sstart; j < send; j++) {
+        for (i = 0; i < p->width * p->step; i += p->step) {
+            if (get_bits_left(&gb) <= 0) {
+                av_log(avctx, AV_LOG_ERROR,
+                       "Slice decoding ran out of bits\n");
+                return AVERROR_INVALIDDATA;
+            }
+            pix = get_vlc2(&gb, p->vlc.table, p->vlc.bits, 3);
+            if (pix < 0) {
+                av_log(avctx, AV_LOG_ERROR, "Decoding error\n");
+                return AVERROR_INVALIDDATA;
             }
+            if (use_pred) {
+                prev += pix;
+                prev &= 0x3FF;
+                pix   = prev;
+            }
+            dest[i] = pix;
         }
-        return 0;
+        dest += p->stride;
     }
+    if (get_bits_left(&gb) > 32)
+        av_log(avctx, AV_LOG_WARNING,
+               "%d bits left after decoding slice\n", get_bits_left(&gb));
 
-    src      += 256;
-
-    send = 0;
-    for (slice = 0; slice < c->slices; slice++) {
-        uint8_t *dest;
-        int slice_data_start, slice_data_end, slice_size;
-
-        sstart = send;
-        send   = (height * (slice + 1) / c->slices) & cmask;
-        dest   = dst + sstart * stride;
-
-        // slice offset and size validation was done earlier
-        slice_data_start = slice ? AV_RL32(src + slice * 4 - 4) : 0;
-        slice_data_end   = AV_RL32(src + slice * 4);
-        slice_size       = slice_data_end - slice_data_start;
+    return 0;
+}
 
-        if (!slice_size) {
-            av_log(c->avctx, AV_LOG_ERROR, "Plane has more than one symbol "
-                   "yet a slice has a length of zero.\n");
-            goto fail;
-        }
+static int decode_slice(AVCodecContext *avctx, void *arg,
+                        int jobnr, int threadnr)
+{
+    UtvideoContext *c     = avctx->priv_data;
+    UtvideoFrameJobs *fj  = arg;
+    const int plane_no    = jobnr / c->slices;
+    const int slice       = jobnr % c->slices;
+    UtvideoPlane *p       = &fj->plane[plane_no];
+    const int use_pred    = c->frame_pred == PRED_LEFT;
+    uint8_t *slice_bits   = c->slice_bits + threadnr * fj->slice_bits_stride;
+    const uint8_t *src    = p->src;
+    int i, j, pix;
+    int sstart, send;
+    GetBitContext gb;
+    int prev, slice_data_start, slice_data_end, slice_size;
+    uint8_t *dest;
 
-        memcpy(c->slice_bits, src + slice_data_start + c->slices * 4,
-               slice_size);
-        memset(c->slice_bits + slice_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
-        c->bdsp.bswap_buf((uint32_t *) c->slice_bits,
-                          (uint32_t *) c->slice_bits,
-                          (slice_data_end - slice_data_start + 3) >> 2);
-        init_get_bits(&gb, c->slice_bits, slice_size * 8);
+    sstart = (p->height * slice       / c->slices) & p->cmask;
+    send   = (p->height * (slice + 1) / c->slices) & p->cmask;
+    dest   = p->dst + sstart * p->stride;
 
+    if (p->fsym >= 0) { // build_huff reported a symbol to fill slices with
         prev = 0x80;
         for (j = sstart; j < send; j++) {
-            for (i = 0; i < width * step; i += step) {
-                if (get_bits_left(&gb) <= 0) {
-                    av_log(c->avctx, AV_LOG_ERROR,
-                           "Slice decoding ran out of bits\n");
-                    goto fail;
-                }
-                pix = get_vlc2(&gb, vlc.table, vlc.bits, 3);
-                if (pix < 0) {
-                    av_log(c->avctx, AV_LOG_ERROR, "Decoding error\n");
-                    goto fail;
-                }
+            for (i = 0; i < p->width * p->step; i += p->step) {
+                pix = p->fsym;
                 if (use_pred) {
                     prev += pix;
                     pix   = prev;
                 }
                 dest[i] = pix;
             }
-            dest += stride;
+            dest += p->stride;
         }
-        if (get_bits_left(&gb) > 32)
-            av_log(c->avctx, AV_LOG_WARNING,
-                   "%d bits left after decoding slice\n", get_bits_left(&gb));
+        return 0;
+    }
+
+    // slice offset and size validation was done earlier
+    slice_data_start = slice ? AV_RL32(src + slice * 4 - 4) : 0;
+    slice_data_end   = AV_RL32(src + slice * 4);
+    slice_size       = slice_data_end - slice_data_start;
+
+    if (!slice_size) {
+        av_log(avctx, AV_LOG_ERROR, "Plane has more than one symbol "
+               "yet a slice has a length of zero.\n");
+        return AVERROR_INVALIDDATA;
     }
 
-    ff_free_vlc(&vlc);
+    memcpy(slice_bits, src + slice_data_start + c->slices * 4, slice_size);
+    memset(slice_bits + slice_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    c->bdsp.bswap_buf((uint32_t *) slice_bits, (uint32_t *) slice_bits,
+                      (slice_size + 3) >> 2);
+    init_get_bits(&gb, slice_bits, slice_size * 8);
+
+    prev = 0x80;
+    for (j = sstart; j < send; j++) {
+        for (i = 0; i < p->width * p->step; i += p->step) {
+            if (get_bits_left(&gb) <= 0) {
+                av_log(avctx, AV_LOG_ERROR,
+                       "Slice decoding ran out of bits\n");
+                return AVERROR_INVALIDDATA;
+            }
+            pix = get_vlc2(&gb, p->vlc.table, p->vlc.bits, 3);
+            if (pix < 0) {
+                av_log(avctx, AV_LOG_ERROR, "Decoding error\n");
+                return AVERROR_INVALIDDATA;
+            }
+            if (use_pred) {
+                prev += pix;
+                pix   = prev;
+            }
+            dest[i] = pix;
+        }
+        dest += p->stride;
+    }
+    if (get_bits_left(&gb) > 32)
+        av_log(avctx, AV_LOG_WARNING,
+               "%d bits left after decoding slice\n", get_bits_left(&gb));
 
     return 0;
-fail:
-    ff_free_vlc(&vlc);
-    return AVERROR_INVALIDDATA;
 }
 
 static void restore_rgb_planes(uint8_t *src, int step, int stride, int width,
@@ -350,11 +324,12 @@ static void restore_rgb_planes(uint8_t *src, int step, int stride, int width,
     }
 }
 
-static void restore_rgb_planes10(AVFrame *frame, int width, int height)
+static void restore_rgb_planes10(AVFrame *frame, int start, int width,
+                                 int height)
 {
-    uint16_t *src_r = (uint16_t *)frame->data[2];
-    uint16_t *src_g = (uint16_t *)frame->data[0];
-    uint16_t *src_b = (uint16_t *)frame->data[1];
+    uint16_t *src_r = (uint16_t *)(frame->data[2] + start * frame->linesize[2]);
+    uint16_t *src_g = (uint16_t *)(frame->data[0] + start * frame->linesize[0]);
+    uint16_t *src_b = (uint16_t *)(frame->data[1] + start * frame->linesize[1]);
     int r, g, b;
     int i, j;
 
@@ -373,54 +348,53 @@ static void restore_rgb_planes10(AVFrame *frame, int width, int height)
 }
 
 static void restore_median(uint8_t *src, int step, int stride,
-                           int width, int height, int slices, int rmode)
+                           int width, int height, int slices, int rmode,
+                           int slice)
 {
-    int i, j, slice;
+    int i, j;
     int A, B, C;
     uint8_t *bsrc;
     int slice_start, slice_height;
     const int cmask = ~rmode;
 
-    for (slice = 0; slice < slices; slice++) {
-        slice_start  = ((slice * height) / slices) & cmask;
-        slice_height = ((((slice + 1) * height) / slices) & cmask) -
-                       slice_start;
+    slice_start  = ((slice * height) / slices) & cmask;
+    slice_height = ((((slice + 1) * height) / slices) & cmask) -
+                   slice_start;
 
-        if (!slice_height)
-            continue;
-        bsrc = src + slice_start * stride;
+    if (!slice_height)
+        return;
+    bsrc = src + slice_start * stride;
 
-        // first line - left neighbour prediction
-        bsrc[0] += 0x80;
-        A = bsrc[0];
-        for (i = step; i < width * step; i += step) {
-            bsrc[i] += A;
-            A        = bsrc[i];
-        }
-        bsrc += stride;
-        if (slice_height <= 1)
-            continue;
-        // second line - first element has top prediction, the rest uses median
-        C        = bsrc[-stride];
-        bsrc[0] += C;
-        A        = bsrc[0];
-        for (i = step; i < width * step; i += step) {
+    // first line - left neighbour prediction
+    bsrc[0] += 0x80;
+    A = bsrc[0];
+    for (i = step; i < width * step; i += step) {
+        bsrc[i] += A;
+        A        = bsrc[i];
+    }
+    bsrc += stride;
+    if (slice_height <= 1)
+        return;
+    // second line - first element has top prediction, the rest uses median
+    C        = bsrc[-stride];
+    bsrc[0] += C;
+    A        = bsrc[0];
+    for (i = step; i < width * step; i += step) {
+        B        = bsrc[i - stride];
+        bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
+        C        = B;
+        A        = bsrc[i];
+    }
+    bsrc += stride;
+    // the rest of lines use continuous median prediction
+    for (j = 2; j < slice_height; j++) {
+        for (i = 0; i < width * step; i += step) {
             B        = bsrc[i - stride];
             bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
             C        = B;
             A        = bsrc[i];
         }
         bsrc += stride;
-        // the rest of lines use continuous median prediction
-        for (j = 2; j < slice_height; j++) {
-            for (i = 0; i < width * step; i += step) {
-                B        = bsrc[i - stride];
-                bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
-                C        = B;
-                A        = bsrc[i];
-            }
-            bsrc += stride;
-        }
     }
 }
 
@@ -429,44 +403,59 @@ static void restore_median(uint8_t *src, int step, int stride,
  * two parts of the same "line".
  */
 static void restore_median_il(uint8_t *src, int step, int stride,
-                              int width, int height, int slices, int rmode)
+                              int width, int height, int slices, int rmode,
+                              int slice)
 {
-    int i, j, slice;
+    int i, j;
     int A, B, C;
     uint8_t *bsrc;
     int slice_start, slice_height;
     const int cmask   = ~(rmode ? 3 : 1);
     const int stride2 = stride << 1;
 
-    for (slice = 0; slice < slices; slice++) {
-        slice_start    = ((slice * height) / slices) & cmask;
-        slice_height   = ((((slice + 1) * height) / slices) & cmask) -
-                         slice_start;
-        slice_height >>= 1;
-        if (!slice_height)
-            continue;
-
-        bsrc = src + slice_start * stride;
-
-        // first line - left neighbour prediction
-        bsrc[0] += 0x80;
-        A        = bsrc[0];
-        for (i = step; i < width * step; i += step) {
-            bsrc[i] += A;
-            A        = bsrc[i];
-        }
+    slice_start    = ((slice * height) / slices) & cmask;
+    slice_height   = ((((slice + 1) * height) / slices) & cmask) -
+                     slice_start;
+    slice_height >>= 1;
+    if (!slice_height)
+        return;
+
+    bsrc = src + slice_start * stride;
+
+    // first line - left neighbour prediction
+    bsrc[0] += 0x80;
+    A        = bsrc[0];
+    for (i = step; i < width * step; i += step) {
+        bsrc[i] += A;
+        A        = bsrc[i];
+    }
+    for (i = 0; i < width * step; i += step) {
+        bsrc[stride + i] += A;
+        A                 = bsrc[stride + i];
+    }
+    bsrc += stride2;
+    if (slice_height <= 1)
+        return;
+    // second line - first element has top prediction, the rest uses median
+    C        = bsrc[-stride2];
+    bsrc[0] += C;
+    A        = bsrc[0];
+    for (i = step; i < width * step; i += step) {
+        B        = bsrc[i - stride2];
+        bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
+        C        = B;
+        A        = bsrc[i];
+    }
+    for (i = 0; i < width * step; i += step) {
+        B                 = bsrc[i - stride];
+        bsrc[stride + i] += mid_pred(A, B, (uint8_t)(A + B - C));
+        C                 = B;
+        A                 = bsrc[stride + i];
+    }
+    bsrc += stride2;
+    // the rest of lines use continuous median prediction
+    for (j = 2; j < slice_height; j++) {
         for (i = 0; i < width * step; i += step) {
-            bsrc[stride + i] += A;
-            A                 = bsrc[stride + i];
-        }
-        bsrc += stride2;
-        if (slice_height <= 1)
-            continue;
-        // second line - first element has top prediction, the rest uses median
-        C        = bsrc[-stride2];
-        bsrc[0] += C;
-        A        = bsrc[0];
-        for (i = step; i < width * step; i += step) {
             B        = bsrc[i - stride2];
             bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
             C        = B;
@@ -474,28 +463,107 @@ static void restore_median_il(uint8_t *src, int step, int stride,
         }
         for (i = 0; i < width * step; i += step) {
             B                 = bsrc[i - stride];
-            bsrc[stride + i] += mid_pred(A, B, (uint8_t)(A + B - C));
+            bsrc[i + stride] += mid_pred(A, B, (uint8_t)(A + B - C));
             C                 = B;
-            A                 = bsrc[stride + i];
+            A                 = bsrc[i + stride];
         }
         bsrc += stride2;
-        // the rest of lines use continuous median prediction
-        for (j = 2; j < slice_height; j++) {
-            for (i = 0; i < width * step; i += step) {
-                B        = bsrc[i - stride2];
-                bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
-                C        = B;
-                A        = bsrc[i];
-            }
-            for (i = 0; i < width * step; i += step) {
-                B                 = bsrc[i - stride];
-                bsrc[i + stride] += mid_pred(A, B, (uint8_t)(A + B - C));
-                C                 = B;
-                A                 = bsrc[i + stride];
-            }
-            bsrc += stride2;
+    }
+}
+
+static int restore_slice(AVCodecContext *avctx, void *arg,
+                         int jobnr, int threadnr)
+{
+    UtvideoContext *c    = avctx->priv_data;
+    UtvideoFrameJobs *fj = arg;
+    UtvideoPlane *p      = &fj->plane[jobnr / c->slices];
+    const int slice      = jobnr % c->slices;
+
+    if (!c->interlaced)
+        restore_median(p->dst, p->step, p->stride, p->width, p->height,
+                       c->slices, p->rmode, slice);
+    else
+        restore_median_il(p->dst, p->step, p->stride, p->width, p->height,
+                          c->slices, p->rmode, slice);
+
+    return 0;
+}
+
+static int restore_rgb_slice(AVCodecContext *avctx, void *arg,
+                             int jobnr, int threadnr)
+{
+    UtvideoContext *c    = avctx->priv_data;
+    UtvideoFrameJobs *fj = arg;
+    AVFrame *frame       = fj->frame;
+    const int start      = avctx->height * jobnr       / c->slices;
+    const int end        = avctx->height * (jobnr + 1) / c->slices;
+
+    if (avctx->pix_fmt == AV_PIX_FMT_GBRP10 ||
+        avctx->pix_fmt == AV_PIX_FMT_GBRAP10)
+        restore_rgb_planes10(frame, start, avctx->width, end - start);
+    else
+        restore_rgb_planes(frame->data[0] + start * frame->linesize[0],
+                           c->planes, frame->linesize[0], avctx->width,
+                           end - start);
+
+    return 0;
+}
+
+/**
+ * Build the Huffman tables of all planes, then decode every slice of every
+ * plane as an independent job, followed by the per-slice reconstruction
+ * passes when the frame uses median or RGB decorrelation.
+ */
+static int decode_planes(AVCodecContext *avctx, UtvideoFrameJobs *fj,
+                         const uint8_t *plane_start[5], int hbd)
+{
+    UtvideoContext *c = avctx->priv_data;
+    int ret[4 * 256];
+    int i, j, err = 0;
+
+    /* all the tables are freed at the end, even if building one fails */
+    for (i = 0; i < fj->nb_planes; i++)
+        memset(&fj->plane[i].vlc, 0, sizeof(fj->plane[i].vlc));
+
+    for (i = 0; i < fj->nb_planes; i++) {
+        UtvideoPlane *p = &fj->plane[i];
+
+        if (hbd) {
+            p->src = plane_start[i];
+            err    = build_huff10(plane_start[i + 1] - 1024, &p->vlc, &p->fsym);
+        } else {
+            p->src = plane_start[i] + 256;
+            err    = build_huff(plane_start[i], &p->vlc, &p->fsym);
+        }
+        if (err) {
+            av_log(avctx, AV_LOG_ERROR, "Cannot build Huffman codes\n");
+            err = AVERROR_INVALIDDATA;
+            goto end;
+        }
+    }
+
+    avctx->execute2(avctx, hbd ? decode_slice10 : decode_slice, fj, ret,
+                    fj->nb_planes * c->slices);
+    for (j = 0; j < fj->nb_planes * c->slices; j++) {
+        if (ret[j] < 0) {
+            err = ret[j];
+            goto end;
         }
     }
+
+    if (!hbd && c->frame_pred == PRED_MEDIAN)
+        avctx->execute2(avctx, restore_slice, fj, NULL,
+                        fj->nb_planes * c->slices);
+    if (avctx->pix_fmt == AV_PIX_FMT_RGB24  ||
+        avctx->pix_fmt == AV_PIX_FMT_RGBA   ||
+        avctx->pix_fmt == AV_PIX_FMT_GBRP10 ||
+        avctx->pix_fmt == AV_PIX_FMT_GBRAP10)
+        avctx->execute2(avctx, restore_rgb_slice, fj, NULL, c->slices);
+
+end:
+    for (i = 0; i < fj->nb_planes; i++)
+        ff_free_vlc(&fj->plane[i].vlc);
+    return err;
 }
 
 static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
@@ -510,6 +578,7 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
     int ret;
     GetByteContext gb;
     ThreadFrame frame = { .f = data };
+    UtvideoFrameJobs fj;
 
     if ((ret = ff_thread_get_buffer(avctx, &frame, 0)) < 0)
         return ret;
@@ -588,125 +657,58 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
         return AVERROR_PATCHWELCOME;
     }
 
+    /* every thread decodes into its own copy of the slice bits */
+    fj.slice_bits_stride = FFALIGN(max_slice_size + AV_INPUT_BUFFER_PADDING_SIZE, 16);
     av_fast_malloc(&c->slice_bits, &c->slice_bits_size,
-                   max_slice_size + AV_INPUT_BUFFER_PADDING_SIZE);
+                   fj.slice_bits_stride * FFMAX(avctx->thread_count, 1));
 
     if (!c->slice_bits) {
         av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer\n");
         return AVERROR(ENOMEM);
     }
 
-    switch (c->avctx->pix_fmt) {
-    case AV_PIX_FMT_RGB24:
-    case AV_PIX_FMT_RGBA:
-        for (i = 0; i < c->planes; i++) {
-            ret = decode_plane(c, i, frame.f->data[0] + ff_ut_rgb_order[i],
-                               c->planes, frame.f->linesize[0], avctx->width,
-                               avctx->height, plane_start[i],
-                               c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-            if (c->frame_pred == PRED_MEDIAN) {
-                if (!c->interlaced) {
-                    restore_median(frame.f->data[0] + ff_ut_rgb_order[i],
-                                   c->planes, frame.f->linesize[0], avctx->width,
-                                   avctx->height, c->slices, 0);
-                } else {
-                    restore_median_il(frame.f->data[0] + ff_ut_rgb_order[i],
-                                      c->planes, frame.f->linesize[0],
-                                      avctx->width, avctx->height, c->slices,
-                                      0);
-                }
-            }
-        }
-        restore_rgb_planes(frame.f->data[0], c->planes, frame.f->linesize[0],
-                           avctx->width, avctx->height);
-        break;
-    case AV_PIX_FMT_GBRAP10:
-    case AV_PIX_FMT_GBRP10:
-        for (i = 0; i < c->planes; i++) {
-            ret = decode_plane10(c, i, (uint16_t *)frame.f->data[i], 1,
-                                 frame.f->linesize[i] / 2, avctx->width,
-                                 avctx->height, plane_start[i],
-                                 plane_start[i + 1] - 1024,
-                                 c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-        }
-        restore_rgb_planes10(frame.f, avctx->width, avctx->height);
-        break;
-    case AV_PIX_FMT_YUV420P:
-        for (i = 0; i < 3; i++) {
-            ret = decode_plane(c, i, frame.f->data[i], 1, frame.f->linesize[i],
-                               avctx->width >> !!i, avctx->height >> !!i,
-                               plane_start[i], c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-            if (c->frame_pred == PRED_MEDIAN) {
-                if (!c->interlaced) {
-                    restore_median(frame.f->data[i], 1, frame.f->linesize[i],
-                                   avctx->width >> !!i, avctx->height >> !!i,
-                                   c->slices, !i);
-                } else {
-                    restore_median_il(frame.f->data[i], 1, frame.f->linesize[i],
-                                      avctx->width  >> !!i,
-                                      avctx->height >> !!i,
-                                      c->slices, !i);
-                }
-            }
-        }
-        break;
-    case AV_PIX_FMT_YUV422P:
-        for (i = 0; i < 3; i++) {
-            ret = decode_plane(c, i, frame.f->data[i], 1, frame.f->linesize[i],
-                               avctx->width >> !!i, avctx->height,
-                               plane_start[i], c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-            if (c->frame_pred == PRED_MEDIAN) {
-                if (!c->interlaced) {
-                    restore_median(frame.f->data[i], 1, frame.f->linesize[i],
-                                   avctx->width >> !!i, avctx->height,
-                                   c->slices, 0);
-                } else {
-                    restore_median_il(frame.f->data[i], 1, frame.f->linesize[i],
-                                      avctx->width >> !!i, avctx->height,
-                                      c->slices, 0);
-                }
-            }
+    fj.frame     = frame.f;
+    fj.nb_planes = c->planes;
+    for (i = 0; i < c->planes; i++) {
+        UtvideoPlane *p = &fj.plane[i];
+
+        switch (c->avctx->pix_fmt) {
+        case AV_PIX_FMT_RGB24:
+        case AV_PIX_FMT_RGBA:
+            p->dst    = frame.f->data[0] + ff_ut_rgb_order[i];
+            p->step   = c->planes;
+            p->stride = frame.f->linesize[0];
+            p->width  = avctx->width;
+            p->height = avctx->height;
+            break;
+        case AV_PIX_FMT_GBRAP10:
+        case AV_PIX_FMT_GBRP10:
+        case AV_PIX_FMT_YUV422P10:
+            p->dst    = frame.f->data[i];
+            p->step   = 1;
+            p->stride = frame.f->linesize[i] / 2;
+            p->width  = avctx->width >> (i && avctx->pix_fmt == AV_PIX_FMT_YUV422P10);
+            p->height = avctx->height;
+            break;
+        default:
+            p->dst    = frame.f->data[i];
+            p->step   = 1;
+            p->stride = frame.f->linesize[i];
+            p->width  = avctx->width >> (i && avctx->pix_fmt != AV_PIX_FMT_YUV444P);
+            p->height = avctx->height >> (i && avctx->pix_fmt == AV_PIX_FMT_YUV420P);
+            break;
         }
-        break;
-    case AV_PIX_FMT_YUV444P:
-        for (i = 0; i < 3; i++) {
-            ret = decode_plane(c, i, frame.f->data[i], 1, frame.f->linesize[i],
-                               avctx->width, avctx->height,
-                               plane_start[i], c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-            if (c->frame_pred == PRED_MEDIAN) {
-                if (!c->interlaced) {
-                    restore_median(frame.f->data[i], 1, frame.f->linesize[i],
-                                   avctx->width, avctx->height,
-                                   c->slices, 0);
-                } else {
-                    restore_median_il(frame.f->data[i], 1, frame.f->linesize[i],
-                                      avctx->width, avctx->height,
-                                      c->slices, 0);
-                }
-            }
-        }
-        break;
-    case AV_PIX_FMT_YUV422P10:
-        for (i = 0; i < 3; i++) {
-            ret = decode_plane10(c, i, (uint16_t *)frame.f->data[i], 1, frame.f->linesize[i] / 2,
-                                 avctx->width >> !!i, avctx->height,
-                                 plane_start[i], plane_start[i + 1] - 1024, c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-        }
-        break;
+        p->rmode = !i && avctx->pix_fmt == AV_PIX_FMT_YUV420P;
+        p->cmask = ~p->rmode;
     }
 
+    ret = decode_planes(avctx, &fj, plane_start,
+                        avctx->pix_fmt == AV_PIX_FMT_GBRAP10 ||
+                        avctx->pix_fmt == AV_PIX_FMT_GBRP10  ||
+                        avctx->pix_fmt == AV_PIX_FMT_YUV422P10);
+    if (ret < 0)
+        return ret;
+
     frame.f->key_frame = 1;
     frame.f->pict_type = AV_PICTURE_TYPE_I;
     frame.f->interlaced_frame = !!c->interlaced;
@@ -836,5 +838,6 @@ AVCodec ff_utvideo_decoder = {
     .init           = decode_init,
     .close          = decode_end,
     .decode         = decode_frame,
-    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS,
 };
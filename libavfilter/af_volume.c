@@ -465,6 +465,7 @@ static const AVFilterPad avfilter_af_volume_inputs[] = {
         .name           = "default",
         .type           = AVMEDIA_TYPE_AUDIO,
         .filter_frame   = filter_frame,
+        .prefers_writable = 1,
     },
     { NULL }
 };
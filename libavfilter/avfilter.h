@@ -559,6 +559,13 @@ struct AVFilterLink {
      * AVHWFramesContext describing the frames.
      */
     AVBufferRef *hw_frames_ctx;
+
+    /**
+     * True if the frames sent on this link end up modified in place,
+     * either by the destination filter or by a filter it forwards them
+     * to unchanged. Set by avfilter_graph_config().
+     */
+    int in_place;
 };
 
 /**
@@ -840,6 +847,26 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * If nonzero, the video frames allocated by the default buffer allocator
+     * of the graph are backed by huge pages, see av_buffer_alloc_hugepages().
+     * May be set by the caller before configuring the graph.
+     */
+    int hugepages;
+
+    /**
+     * Opaque reference to the buffer pools the video frames of the links are
+     * allocated from, set by avfilter_graph_alloc() and unreferenced by
+     * avfilter_graph_free().
+     *
+     * A caller freeing a graph and building a new one, e.g. when its input
+     * changes, may replace it before configuring the new graph with a new
+     * reference to the one of the old graph (see av_buffer_ref()). The
+     * buffers allocated for the old graph are then reused, and the pools are
+     * kept until the last reference is unreferenced.
+     */
+    AVBufferRef *frame_pools;
+
     /**
      * Private fields
      *
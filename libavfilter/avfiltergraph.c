@@ -49,6 +49,8 @@ static const AVOption filtergraph_options[] = {
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS },
+    { "hugepages",   "Allocate video frames from huge pages", OFFSET(hugepages),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, FLAGS },
     { NULL },
 };
 
@@ -85,6 +87,13 @@ AVFilterGraph *avfilter_graph_alloc(void)
         return NULL;
     }
 
+    ret->frame_pools = ff_video_frame_pool_shared_alloc();
+    if (!ret->frame_pools) {
+        av_freep(&ret->internal);
+        av_freep(&ret);
+        return NULL;
+    }
+
     ret->av_class = &filtergraph_class;
     av_opt_set_defaults(ret);
 
@@ -119,6 +128,8 @@ void avfilter_graph_free(AVFilterGraph **graph)
 
     ff_graph_thread_free(*graph);
 
+    av_buffer_unref(&(*graph)->frame_pools);
+
     av_freep(&(*graph)->sink_links);
 
     av_freep(&(*graph)->scale_sws_opts);
@@ -1214,6 +1225,30 @@ static int graph_config_pointers(AVFilterGraph *graph,
     return 0;
 }
 
+static int link_in_place(AVFilterLink *link)
+{
+    AVFilterContext *dst = link->dst;
+
+    if (link->dstpad->needs_writable || link->dstpad->prefers_writable)
+        return 1;
+    /* without filter_frame(), frames are forwarded to the first output */
+    if (!link->dstpad->filter_frame && dst->nb_outputs && dst->outputs[0])
+        return link_in_place(dst->outputs[0]);
+    return 0;
+}
+
+static void graph_config_in_place(AVFilterGraph *graph)
+{
+    unsigned i, j;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        for (j = 0; j < f->nb_outputs; j++)
+            if (f->outputs[j])
+                f->outputs[j]->in_place = link_in_place(f->outputs[j]);
+    }
+}
+
 static int graph_insert_fifos(AVFilterGraph *graph, AVClass *log_ctx)
 {
     AVFilterContext *f;
@@ -1267,6 +1302,8 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
 
+    graph_config_in_place(graphctx);
+
     return 0;
 }
 
@@ -25,6 +25,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/thread.h"
 
 struct FFVideoFramePool {
 
@@ -35,9 +36,158 @@ struct FFVideoFramePool {
     int linesize[4];
     AVBufferPool *pools[4];
 
+    AVBufferRef *shared; ///< FFSharedPools the pools come from, may be NULL
+
 };
 
-FFVideoFramePool *ff_video_frame_pool_init(AVBufferRef* (*alloc)(int size),
+/* Buffer pools are shared by all the frame pools created with the same
+ * FFSharedPools and using buffers of the same size and allocator, so that
+ * reconfiguring a link reuses the buffers allocated before. Up to
+ * SHARED_POOL_MAX_IDLE pools no frame pool uses anymore are kept, along with
+ * their buffers, for frame pools created later; all of them are released
+ * when the FFSharedPools is freed. */
+#define SHARED_POOL_MAX_IDLE 8
+
+typedef struct SharedPool {
+    int size;
+    AVBufferRef* (*alloc)(int size);
+    AVBufferPool *pool;
+    int users;
+    struct SharedPool *next;
+} SharedPool;
+
+typedef struct FFSharedPools {
+    SharedPool *pools;
+    AVMutex mutex;
+} FFSharedPools;
+
+static void shared_pools_free(void *opaque, uint8_t *data)
+{
+    FFSharedPools *sp = (FFSharedPools *)data;
+
+    while (sp->pools) {
+        SharedPool *e = sp->pools;
+        sp->pools = e->next;
+        av_buffer_pool_uninit(&e->pool);
+        av_free(e);
+    }
+    ff_mutex_destroy(&sp->mutex);
+    av_free(sp);
+}
+
+AVBufferRef *ff_video_frame_pool_shared_alloc(void)
+{
+    AVBufferRef *ref;
+    FFSharedPools *sp = av_mallocz(sizeof(*sp));
+
+    if (!sp)
+        return NULL;
+
+    ref = av_buffer_create((uint8_t *)sp, sizeof(*sp), shared_pools_free,
+                           NULL, 0);
+    if (!ref) {
+        av_free(sp);
+        return NULL;
+    }
+    ff_mutex_init(&sp->mutex, NULL);
+
+    return ref;
+}
+
+/* Must be called with the mutex held. The list is ordered from the most to
+ * the least recently requested pool, so the latter go first. */
+static void shared_pools_prune(FFSharedPools *sp)
+{
+    SharedPool **p = &sp->pools;
+    int idle = 0;
+
+    while (*p) {
+        SharedPool *e = *p;
+        if (!e->users && ++idle > SHARED_POOL_MAX_IDLE) {
+            *p = e->next;
+            av_buffer_pool_uninit(&e->pool);
+            av_free(e);
+        } else {
+            p = &e->next;
+        }
+    }
+}
+
+static AVBufferPool *shared_pool_get(AVBufferRef *shared, int size,
+                                     AVBufferRef* (*alloc)(int size))
+{
+    FFSharedPools *sp;
+    SharedPool **p, *e = NULL;
+    AVBufferPool *pool = NULL;
+
+    if (!shared)
+        return av_buffer_pool_init(size, alloc);
+
+    sp = (FFSharedPools *)shared->data;
+    ff_mutex_lock(&sp->mutex);
+
+    for (p = &sp->pools; *p; p = &(*p)->next) {
+        if ((*p)->size == size && (*p)->alloc == alloc) {
+            e  = *p;
+            *p = e->next;
+            break;
+        }
+    }
+
+    if (!e) {
+        e = av_mallocz(sizeof(*e));
+        if (!e)
+            goto end;
+        e->pool = av_buffer_pool_init(size, alloc);
+        if (!e->pool) {
+            av_freep(&e);
+            goto end;
+        }
+        e->size  = size;
+        e->alloc = alloc;
+    }
+
+    e->users++;
+    e->next   = sp->pools;
+    sp->pools = e;
+    pool      = e->pool;
+
+end:
+    shared_pools_prune(sp);
+    ff_mutex_unlock(&sp->mutex);
+    return pool;
+}
+
+static void shared_pool_release(AVBufferRef *shared, AVBufferPool **pool)
+{
+    FFSharedPools *sp;
+    SharedPool *e;
+
+    if (!*pool)
+        return;
+
+    if (!shared) {
+        av_buffer_pool_uninit(pool);
+        return;
+    }
+
+    sp = (FFSharedPools *)shared->data;
+    ff_mutex_lock(&sp->mutex);
+    for (e = sp->pools; e; e = e->next) {
+        if (e->pool == *pool) {
+            e->users--;
+            break;
+        }
+    }
+    av_assert0(e);
+    shared_pools_prune(sp);
+    ff_mutex_unlock(&sp->mutex);
+
+    *pool = NULL;
+}
+
+FFVideoFramePool *ff_video_frame_pool_init(AVBufferRef *shared,
+                                           AVBufferRef* (*alloc)(int size),
                                            int width,
                                            int height,
                                            enum AVPixelFormat format,
@@ -59,6 +209,12 @@ FFVideoFramePool *ff_video_frame_pool_init(AVBufferRef* (*alloc)(int size),
     pool->format = format;
     pool->align = align;
 
+    if (shared) {
+        pool->shared = av_buffer_ref(shared);
+        if (!pool->shared)
+            goto fail;
+    }
+
     if ((ret = av_image_check_size(width, height, 0, NULL)) < 0) {
         goto fail;
     }
@@ -84,15 +240,16 @@ FFVideoFramePool *ff_video_frame_pool_init(AVBufferRef* (*alloc)(int size),
         if (i == 1 || i == 2)
             h = AV_CEIL_RSHIFT(h, desc->log2_chroma_h);
 
-        pool->pools[i] = av_buffer_pool_init(pool->linesize[i] * h + 16 + 16 - 1,
-                                             alloc);
+        pool->pools[i] = shared_pool_get(pool->shared,
+                                         pool->linesize[i] * h + 16 + 16 - 1,
+                                         alloc);
         if (!pool->pools[i])
             goto fail;
     }
 
     if (desc->flags & AV_PIX_FMT_FLAG_PAL ||
         desc->flags & AV_PIX_FMT_FLAG_PSEUDOPAL) {
-        pool->pools[1] = av_buffer_pool_init(AVPALETTE_SIZE, alloc);
+        pool->pools[1] = shared_pool_get(pool->shared, AVPALETTE_SIZE, alloc);
         if (!pool->pools[1])
             goto fail;
     }
@@ -182,8 +339,9 @@ void ff_video_frame_pool_uninit(FFVideoFramePool **pool)
         return;
 
     for (i = 0; i < 4; i++) {
-        av_buffer_pool_uninit(&(*pool)->pools[i]);
+        shared_pool_release((*pool)->shared, &(*pool)->pools[i]);
     }
+    av_buffer_unref(&(*pool)->shared);
 
     av_freep(pool);
 }
@@ -31,9 +31,25 @@
  */
 typedef struct FFVideoFramePool FFVideoFramePool;
 
+/**
+ * Allocate a set of buffer pools to be shared by video frame pools.
+ *
+ * The returned reference is passed to ff_video_frame_pool_init(); every
+ * frame pool created with it holds a reference of its own. The buffer pools
+ * it keeps are released once all references have been unreferenced.
+ *
+ * @return a new reference on success, NULL on error.
+ */
+AVBufferRef *ff_video_frame_pool_shared_alloc(void);
+
 /**
  * Allocate and initialize a video frame pool.
  *
+ * @param shared set of buffer pools returned by
+ * ff_video_frame_pool_shared_alloc(), or NULL. If set, the buffers of each
+ * plane come from buffer pools shared by all frame pools created with it
+ * using the same buffer size and allocator, so that buffers allocated before
+ * e.g. a link is reconfigured get reused.
  * @param alloc a function that will be used to allocate new frame buffers when
  * the pool is empty. May be NULL, then the default allocator will be used
  * (av_buffer_alloc()).
@@ -43,7 +59,8 @@ typedef struct FFVideoFramePool FFVideoFramePool;
  * @param align buffers alignement of each frame in this pool
  * @return newly created video frame pool on success, NULL on error.
  */
-FFVideoFramePool *ff_video_frame_pool_init(AVBufferRef* (*alloc)(int size),
+FFVideoFramePool *ff_video_frame_pool_init(AVBufferRef *shared,
+                                           AVBufferRef* (*alloc)(int size),
                                            int width,
                                            int height,
                                            enum AVPixelFormat format,
@@ -142,6 +142,16 @@ struct AVFilterPad {
      * input pads only.
      */
     int needs_writable;
+
+    /**
+     * The filter modifies frames in place when they are writable, and
+     * falls back to allocating a new output frame otherwise.
+     * Upstream filters use this through AVFilterLink.in_place to hand
+     * over frames they no longer reference.
+     *
+     * input pads only.
+     */
+    int prefers_writable;
 };
 
 struct AVFilterGraphInternal {
@@ -18,6 +18,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
 #include "motion_estimation.h"
 
 static const int8_t sqr1[8][2]  = {{ 0,-1}, { 0, 1}, {-1, 0}, { 1, 0}, {-1,-1}, {-1, 1}, { 1,-1}, { 1, 1}};
@@ -45,6 +46,8 @@ if (x >= x_min && x <= x_max && y >= y_min && y <= y_max)\
 void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_param,
                         int width, int height, int x_min, int x_max, int y_min, int y_max)
 {
+    int i;
+
     me_ctx->width = width;
     me_ctx->height = height;
     me_ctx->mb_size = mb_size;
@@ -54,26 +57,50 @@ void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_para
     me_ctx->x_max = x_max;
     me_ctx->y_min = y_min;
     me_ctx->y_max = y_max;
+
+    for (i = 1; i < FF_ARRAY_ELEMS(me_ctx->sad); i++)
+        me_ctx->sad[i] = CONFIG_PIXELUTILS ? av_pixelutils_get_sad_fn(i, i, 0, NULL) : NULL;
 }
 
-uint64_t ff_me_cmp_sad(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int x_mv, int y_mv)
+uint64_t ff_me_block_sad(AVMotionEstContext *me_ctx, const uint8_t *src1,
+                         const uint8_t *src2, int size)
 {
     const int linesize = me_ctx->linesize;
-    uint8_t *data_ref = me_ctx->data_ref;
-    uint8_t *data_cur = me_ctx->data_cur;
+    const int log2_size = av_log2(size);
     uint64_t sad = 0;
     int i, j;
 
-    data_ref += y_mv * linesize;
-    data_cur += y_mb * linesize;
+    if (log2_size && size == 1 << log2_size) {
+        const int bits = FFMIN(log2_size, FF_ARRAY_ELEMS(me_ctx->sad) - 1);
+        const int step = 1 << bits;
+        av_pixelutils_sad_fn sad_fn = me_ctx->sad[bits];
+
+        if (sad_fn) {
+            for (j = 0; j < size; j += step)
+                for (i = 0; i < size; i += step)
+                    sad += sad_fn(src1 + i + j * linesize, linesize,
+                                  src2 + i + j * linesize, linesize);
+            return sad;
+        }
+    }
 
-    for (j = 0; j < me_ctx->mb_size; j++)
-        for (i = 0; i < me_ctx->mb_size; i++)
-            sad += FFABS(data_ref[x_mv + i + j * linesize] - data_cur[x_mb + i + j * linesize]);
+    for (j = 0; j < size; j++)
+        for (i = 0; i < size; i++)
+            sad += FFABS(src1[i + j * linesize] - src2[i + j * linesize]);
 
     return sad;
 }
 
+uint64_t ff_me_cmp_sad(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int x_mv, int y_mv)
+{
+    const int linesize = me_ctx->linesize;
+    uint8_t *data_ref = me_ctx->data_ref;
+    uint8_t *data_cur = me_ctx->data_cur;
+
+    return ff_me_block_sad(me_ctx, data_ref + x_mv + y_mv * linesize,
+                           data_cur + x_mb + y_mb * linesize, me_ctx->mb_size);
+}
+
 uint64_t ff_me_search_esa(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int *mv)
 {
     int x, y;
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2011 Roger Pau Monné <roger.pau@entel.upc.edu>
+ * Copyright (c) 2011 Stefano Sabatini
+ * Copyright (c) 2013 Paul B Mahol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * PSNR computation shared by the psnr and psnrssim filters.
+ */
+
+#include "config.h"
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/pixdesc.h"
+#include "drawutils.h"
+#include "psnr.h"
+
+static inline unsigned pow2(unsigned base)
+{
+    return base*base;
+}
+
+static inline double get_psnr(double mse, uint64_t nb_frames, int max)
+{
+    return 10.0 * log10(pow2(max) / (mse / nb_frames));
+}
+
+static uint64_t sse_line_8bit(const uint8_t *main_line,  const uint8_t *ref_line, int outw)
+{
+    int j;
+    unsigned m2 = 0;
+
+    for (j = 0; j < outw; j++)
+        m2 += pow2(main_line[j] - ref_line[j]);
+
+    return m2;
+}
+
+static uint64_t sse_line_16bit(const uint8_t *_main_line, const uint8_t *_ref_line, int outw)
+{
+    int j;
+    uint64_t m2 = 0;
+    const uint16_t *main_line = (const uint16_t *) _main_line;
+    const uint16_t *ref_line = (const uint16_t *) _ref_line;
+
+    for (j = 0; j < outw; j++)
+        m2 += pow2(main_line[j] - ref_line[j]);
+
+    return m2;
+}
+
+uint64_t ff_psnr_metrics_sse(PSNRMetrics *m, const AVFrame *main,
+                             const AVFrame *ref, int c,
+                             int slice_start, int slice_end)
+{
+    const int outw = m->planewidth[c];
+    const int ref_linesize = ref->linesize[c];
+    const int main_linesize = main->linesize[c];
+    const uint8_t *main_line = main->data[c] + main_linesize * slice_start;
+    const uint8_t *ref_line = ref->data[c] + ref_linesize * slice_start;
+    uint64_t sse = 0;
+    int i;
+
+    for (i = slice_start; i < slice_end; i++) {
+        sse += m->dsp.sse_line(main_line, ref_line, outw);
+        ref_line += ref_linesize;
+        main_line += main_linesize;
+    }
+
+    return sse;
+}
+
+static void set_meta(AVDictionary **metadata, const char *key, char comp, float d)
+{
+    char value[128];
+    snprintf(value, sizeof(value), "%0.2f", d);
+    if (comp) {
+        char key2[128];
+        snprintf(key2, sizeof(key2), "%s%c", key, comp);
+        av_dict_set(metadata, key2, value, 0);
+    } else {
+        av_dict_set(metadata, key, value, 0);
+    }
+}
+
+void ff_psnr_metrics_frame(PSNRMetrics *m, const uint64_t *sse,
+                           AVDictionary **metadata)
+{
+    double *comp_mse = m->frame_mse_comp, mse = 0;
+    int j, c;
+
+    for (c = 0; c < m->nb_components; c++)
+        comp_mse[c] = sse[c] / (double)(m->planewidth[c] * m->planeheight[c]);
+
+    for (j = 0; j < m->nb_components; j++)
+        mse += comp_mse[j] * m->planeweight[j];
+    m->frame_mse = mse;
+
+    m->min_mse = FFMIN(m->min_mse, mse);
+    m->max_mse = FFMAX(m->max_mse, mse);
+
+    m->mse += mse;
+    for (j = 0; j < m->nb_components; j++)
+        m->mse_comp[j] += comp_mse[j];
+    m->nb_frames++;
+
+    for (j = 0; j < m->nb_components; j++) {
+        c = m->is_rgb ? m->rgba_map[j] : j;
+        set_meta(metadata, "lavfi.psnr.mse.", m->comps[j], comp_mse[c]);
+        set_meta(metadata, "lavfi.psnr.psnr.", m->comps[j], get_psnr(comp_mse[c], 1, m->max[c]));
+    }
+    set_meta(metadata, "lavfi.psnr.mse_avg", 0, mse);
+    set_meta(metadata, "lavfi.psnr.psnr_avg", 0, get_psnr(mse, 1, m->average_max));
+}
+
+void ff_psnr_metrics_print(PSNRMetrics *m, FILE *f)
+{
+    int j, c;
+
+    fprintf(f, "mse_avg:%0.2f ", m->frame_mse);
+    for (j = 0; j < m->nb_components; j++) {
+        c = m->is_rgb ? m->rgba_map[j] : j;
+        fprintf(f, "mse_%c:%0.2f ", m->comps[j], m->frame_mse_comp[c]);
+    }
+    fprintf(f, "psnr_avg:%0.2f ", get_psnr(m->frame_mse, 1, m->average_max));
+    for (j = 0; j < m->nb_components; j++) {
+        c = m->is_rgb ? m->rgba_map[j] : j;
+        fprintf(f, "psnr_%c:%0.2f ", m->comps[j],
+                get_psnr(m->frame_mse_comp[c], 1, m->max[c]));
+    }
+}
+
+void ff_psnr_metrics_config(PSNRMetrics *m, AVFilterLink *inlink)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    double average_max;
+    unsigned sum;
+    int j;
+
+    m->min_mse = +INFINITY;
+    m->max_mse = -INFINITY;
+
+    m->nb_components = desc->nb_components;
+
+    m->max[0] = (1 << desc->comp[0].depth) - 1;
+    m->max[1] = (1 << desc->comp[1].depth) - 1;
+    m->max[2] = (1 << desc->comp[2].depth) - 1;
+    m->max[3] = (1 << desc->comp[3].depth) - 1;
+
+    m->is_rgb = ff_fill_rgba_map(m->rgba_map, inlink->format) >= 0;
+    m->comps[0] = m->is_rgb ? 'r' : 'y' ;
+    m->comps[1] = m->is_rgb ? 'g' : 'u' ;
+    m->comps[2] = m->is_rgb ? 'b' : 'v' ;
+    m->comps[3] = 'a';
+
+    m->planeheight[1] = m->planeheight[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
+    m->planeheight[0] = m->planeheight[3] = inlink->h;
+    m->planewidth[1]  = m->planewidth[2]  = AV_CEIL_RSHIFT(inlink->w, desc->log2_chroma_w);
+    m->planewidth[0]  = m->planewidth[3]  = inlink->w;
+    sum = 0;
+    for (j = 0; j < m->nb_components; j++)
+        sum += m->planeheight[j] * m->planewidth[j];
+    average_max = 0;
+    for (j = 0; j < m->nb_components; j++) {
+        m->planeweight[j] = (double) m->planeheight[j] * m->planewidth[j] / sum;
+        average_max += m->max[j] * m->planeweight[j];
+    }
+    m->average_max = lrint(average_max);
+
+    m->dsp.sse_line = desc->comp[0].depth > 8 ? sse_line_16bit : sse_line_8bit;
+    if (ARCH_X86)
+        ff_psnr_init_x86(&m->dsp, desc->comp[0].depth);
+}
+
+void ff_psnr_metrics_log(void *log_ctx, PSNRMetrics *m)
+{
+    char buf[256];
+    int j;
+
+    if (!m->nb_frames)
+        return;
+
+    buf[0] = 0;
+    for (j = 0; j < m->nb_components; j++) {
+        int c = m->is_rgb ? m->rgba_map[j] : j;
+        av_strlcatf(buf, sizeof(buf), " %c:%f", m->comps[j],
+                    get_psnr(m->mse_comp[c], m->nb_frames, m->max[c]));
+    }
+    av_log(log_ctx, AV_LOG_INFO, "PSNR%s average:%f min:%f max:%f\n",
+           buf,
+           get_psnr(m->mse, m->nb_frames, m->average_max),
+           get_psnr(m->max_mse, 1, m->average_max),
+           get_psnr(m->min_mse, 1, m->average_max));
+}
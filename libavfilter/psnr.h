@@ -23,6 +23,11 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/frame.h"
+#include "avfilter.h"
 
 typedef struct PSNRDSPContext {
     uint64_t (*sse_line)(const uint8_t *buf, const uint8_t *ref, int w);
@@ -30,4 +35,53 @@ typedef struct PSNRDSPContext {
 
 void ff_psnr_init_x86(PSNRDSPContext *dsp, int bpp);
 
+/**
+ * PSNR computation and statistics, shared by the filters reporting it.
+ */
+typedef struct PSNRMetrics {
+    double mse, min_mse, max_mse, mse_comp[4];
+    uint64_t nb_frames;
+    double frame_mse, frame_mse_comp[4]; ///< values of the last frame
+    int max[4], average_max;
+    int is_rgb;
+    uint8_t rgba_map[4];
+    char comps[4];
+    int nb_components;
+    int planewidth[4];
+    int planeheight[4];
+    double planeweight[4];
+    PSNRDSPContext dsp;
+} PSNRMetrics;
+
+/**
+ * Set up the metrics for the format and dimensions of inlink.
+ */
+void ff_psnr_metrics_config(PSNRMetrics *m, AVFilterLink *inlink);
+
+/**
+ * Return the sum of squared errors of lines slice_start to slice_end - 1
+ * of plane c. May be called concurrently for distinct slices.
+ */
+uint64_t ff_psnr_metrics_sse(PSNRMetrics *m, const AVFrame *main,
+                             const AVFrame *ref, int c,
+                             int slice_start, int slice_end);
+
+/**
+ * Account a frame given the sum of squared errors of each of its planes,
+ * and export the values to the frame metadata.
+ */
+void ff_psnr_metrics_frame(PSNRMetrics *m, const uint64_t *sse,
+                           AVDictionary **metadata);
+
+/**
+ * Write the values of the last frame to a stats file, as in the version 1
+ * format, without frame number and line ending.
+ */
+void ff_psnr_metrics_print(PSNRMetrics *m, FILE *f);
+
+/**
+ * Log the averages over all frames.
+ */
+void ff_psnr_metrics_log(void *log_ctx, PSNRMetrics *m);
+
 #endif /* AVFILTER_PSNR_H */
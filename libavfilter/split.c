@@ -73,23 +73,39 @@ static av_cold void split_uninit(AVFilterContext *ctx)
 static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
 {
     AVFilterContext *ctx = inlink->dst;
-    int i, ret = AVERROR_EOF;
-
-    for (i = 0; i < ctx->nb_outputs; i++) {
-        AVFrame *buf_out;
-
-        if (ctx->outputs[i]->status)
-            continue;
-        buf_out = av_frame_clone(frame);
-        if (!buf_out) {
-            ret = AVERROR(ENOMEM);
-            break;
+    int i, pass, last = -1, ret = AVERROR_EOF;
+
+    /* Outputs modifying frames in place are served last, and the last one
+     * gets our own reference: it is then writable if the other branches
+     * are done with the frame. */
+    for (pass = 0; pass < 2; pass++)
+        for (i = 0; i < ctx->nb_outputs; i++)
+            if (!ctx->outputs[i]->status && ctx->outputs[i]->in_place == pass)
+                last = i;
+
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < ctx->nb_outputs; i++) {
+            AVFrame *buf_out;
+
+            if (ctx->outputs[i]->status || ctx->outputs[i]->in_place != pass)
+                continue;
+            if (i == last) {
+                buf_out = frame;
+                frame   = NULL;
+            } else {
+                buf_out = av_frame_clone(frame);
+                if (!buf_out) {
+                    ret = AVERROR(ENOMEM);
+                    goto end;
+                }
+            }
+
+            ret = ff_filter_frame(ctx->outputs[i], buf_out);
+            if (ret < 0)
+                goto end;
         }
-
-        ret = ff_filter_frame(ctx->outputs[i], buf_out);
-        if (ret < 0)
-            break;
     }
+end:
     av_frame_free(&frame);
     return ret;
 }
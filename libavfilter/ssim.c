@@ -0,0 +1,470 @@
+/*
+ * Copyright (c) 2003-2013 Loren Merritt
+ * Copyright (c) 2015 Paul B Mahol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Computes the Structural Similarity Metric between two video streams.
+ * original algorithm:
+ * Z. Wang, A. C. Bovik, H. R. Sheikh and E. P. Simoncelli,
+ *   "Image quality assessment: From error visibility to structural similarity,"
+ *   IEEE Transactions on Image Processing, vol. 13, no. 4, pp. 600-612, Apr. 2004.
+ *
+ * To improve speed, this implementation uses the standard approximation of
+ * overlapped 8x8 block sums, rather than the original gaussian weights.
+ */
+
+/**
+ * @file
+ * SSIM and MS-SSIM computation shared by the ssim and psnrssim filters.
+ */
+
+#include "config.h"
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "drawutils.h"
+#include "ssim.h"
+
+static void set_meta(AVDictionary **metadata, const char *key, char comp, float d)
+{
+    char value[128];
+    snprintf(value, sizeof(value), "%0.2f", d);
+    if (comp) {
+        char key2[128];
+        snprintf(key2, sizeof(key2), "%s%c", key, comp);
+        av_dict_set(metadata, key2, value, 0);
+    } else {
+        av_dict_set(metadata, key, value, 0);
+    }
+}
+
+static void ssim_4x4xn(const uint8_t *main, ptrdiff_t main_stride,
+                       const uint8_t *ref, ptrdiff_t ref_stride,
+                       int (*sums)[4], int width)
+{
+    int x, y, z;
+
+    for (z = 0; z < width; z++) {
+        uint32_t s1 = 0, s2 = 0, ss = 0, s12 = 0;
+
+        for (y = 0; y < 4; y++) {
+            for (x = 0; x < 4; x++) {
+                int a = main[x + y * main_stride];
+                int b = ref[x + y * ref_stride];
+
+                s1  += a;
+                s2  += b;
+                ss  += a*a;
+                ss  += b*b;
+                s12 += a*b;
+            }
+        }
+
+        sums[z][0] = s1;
+        sums[z][1] = s2;
+        sums[z][2] = ss;
+        sums[z][3] = s12;
+        main += 4;
+        ref += 4;
+    }
+}
+
+static float ssim_end1(int s1, int s2, int ss, int s12)
+{
+    static const int ssim_c1 = (int)(.01*.01*255*255*64 + .5);
+    static const int ssim_c2 = (int)(.03*.03*255*255*64*63 + .5);
+
+    int fs1 = s1;
+    int fs2 = s2;
+    int fss = ss;
+    int fs12 = s12;
+    int vars = fss * 64 - fs1 * fs1 - fs2 * fs2;
+    int covar = fs12 * 64 - fs1 * fs2;
+
+    return (float)(2 * fs1 * fs2 + ssim_c1) * (float)(2 * covar + ssim_c2)
+         / ((float)(fs1 * fs1 + fs2 * fs2 + ssim_c1) * (float)(vars + ssim_c2));
+}
+
+static float ssim_endn(const int (*sum0)[4], const int (*sum1)[4], int width)
+{
+    float ssim = 0.0;
+    int i;
+
+    for (i = 0; i < width; i++)
+        ssim += ssim_end1(sum0[i][0] + sum0[i + 1][0] + sum1[i][0] + sum1[i + 1][0],
+                          sum0[i][1] + sum0[i + 1][1] + sum1[i][1] + sum1[i + 1][1],
+                          sum0[i][2] + sum0[i + 1][2] + sum1[i][2] + sum1[i + 1][2],
+                          sum0[i][3] + sum0[i + 1][3] + sum1[i][3] + sum1[i + 1][3]);
+    return ssim;
+}
+
+/* contrast and structure terms only, as used by MS-SSIM */
+static float ssim_cs_end1(int s1, int s2, int ss, int s12)
+{
+    static const int ssim_c2 = (int)(.03*.03*255*255*64*63 + .5);
+
+    int vars = ss * 64 - s1 * s1 - s2 * s2;
+    int covar = s12 * 64 - s1 * s2;
+
+    return (float)(2 * covar + ssim_c2) / (float)(vars + ssim_c2);
+}
+
+static float ssim_cs_endn(const int (*sum0)[4], const int (*sum1)[4], int width)
+{
+    float cs = 0.0;
+    int i;
+
+    for (i = 0; i < width; i++)
+        cs += ssim_cs_end1(sum0[i][0] + sum0[i + 1][0] + sum1[i][0] + sum1[i + 1][0],
+                           sum0[i][1] + sum0[i + 1][1] + sum1[i][1] + sum1[i + 1][1],
+                           sum0[i][2] + sum0[i + 1][2] + sum1[i][2] + sum1[i + 1][2],
+                           sum0[i][3] + sum0[i + 1][3] + sum1[i][3] + sum1[i + 1][3]);
+    return cs;
+}
+
+/* score and cs_score may be NULL if the respective values are not needed */
+static void ssim_plane_rows(SSIMDSPContext *dsp,
+                            const uint8_t *main, int main_stride,
+                            const uint8_t *ref, int ref_stride,
+                            int width, int slice_start, int slice_end,
+                            void *temp, float *score, float *cs_score)
+{
+    int z = slice_start - 1, y;
+    int (*sum0)[4] = temp;
+    int (*sum1)[4] = sum0 + width + 3;
+
+    for (y = slice_start; y < slice_end; y++) {
+        for (; z <= y; z++) {
+            FFSWAP(void*, sum0, sum1);
+            dsp->ssim_4x4_line(&main[4 * z * main_stride], main_stride,
+                               &ref[4 * z * ref_stride], ref_stride,
+                               sum0, width);
+        }
+
+        if (score)
+            score[y] = dsp->ssim_end_line((const int (*)[4])sum0, (const int (*)[4])sum1, width - 1);
+        if (cs_score)
+            cs_score[y] = ssim_cs_endn((const int (*)[4])sum0, (const int (*)[4])sum1, width - 1);
+    }
+}
+
+/* average the 2x2 blocks of lines 2 * slice_start to 2 * slice_end - 1 */
+static void downscale_rows(uint8_t *dst, int dst_stride,
+                           const uint8_t *src, int src_stride,
+                           int width, int slice_start, int slice_end)
+{
+    int x, y;
+
+    for (y = slice_start; y < slice_end; y++) {
+        const uint8_t *src0 = src + 2 * y * src_stride;
+        const uint8_t *src1 = src0 + src_stride;
+        uint8_t *dst_line = dst + y * dst_stride;
+
+        for (x = 0; x < width; x++)
+            dst_line[x] = (src0[2 * x] + src0[2 * x + 1] +
+                           src1[2 * x] + src1[2 * x + 1] + 2) >> 2;
+    }
+}
+
+static int ms_stride(SSIMMetrics *m, int c, int scale)
+{
+    return FFALIGN(m->planewidth[c] >> scale, 32);
+}
+
+int ff_ssim_metrics_rows(SSIMMetrics *m, int c)
+{
+    return m->planeheight[c] >> 2;
+}
+
+void ff_ssim_metrics_slice(SSIMMetrics *m, const AVFrame *main,
+                           const AVFrame *ref, int c,
+                           int slice_start, int slice_end, int jobnr)
+{
+    const int width = m->planewidth[c] >> 2;
+    const int height = m->planeheight[c] >> 2;
+
+    ssim_plane_rows(&m->dsp, main->data[c], main->linesize[c],
+                    ref->data[c], ref->linesize[c],
+                    width, slice_start, slice_end, m->temp[jobnr],
+                    m->score[c], m->ms_ssim ? m->cs_score[c] : NULL);
+
+    if (m->ms_ssim) {
+        /* the slice holding the first (last) block row also downscales
+         * the lines above (below) the block rows */
+        const int start = slice_start == 1 ? 0 : 2 * slice_start;
+        const int end = slice_end == height ? m->planeheight[c] >> 1 : 2 * slice_end;
+        const int w = m->planewidth[c] >> 1;
+
+        downscale_rows(m->ms_main[c][0], ms_stride(m, c, 1),
+                       main->data[c], main->linesize[c], w, start, end);
+        downscale_rows(m->ms_ref[c][0], ms_stride(m, c, 1),
+                       ref->data[c], ref->linesize[c], w, start, end);
+    }
+}
+
+/* Z. Wang, E. P. Simoncelli and A. C. Bovik, "Multiscale structural
+ * similarity for image quality assessment", 2003. The contrast and
+ * structure terms of the first scale have been computed with the SSIM. */
+static double ms_ssim_plane(SSIMMetrics *m, int c)
+{
+    static const double weights[SSIM_MS_SCALES] = {
+        0.0448, 0.2856, 0.3001, 0.2363, 0.1333
+    };
+    int width = m->planewidth[c] >> 2;
+    int height = m->planeheight[c] >> 2;
+    float *row_score = m->cs_score[c];
+    double ms, val = 0;
+    int scale, y;
+
+    for (y = 1; y < height; y++)
+        val += row_score[y];
+    val /= (height - 1) * (width - 1);
+    ms = pow(FFMAX(val, 0), weights[0]);
+
+    for (scale = 1; scale < SSIM_MS_SCALES; scale++) {
+        const uint8_t *main = m->ms_main[c][scale - 1];
+        const uint8_t *ref = m->ms_ref[c][scale - 1];
+        const int stride = ms_stride(m, c, scale);
+        const int last = scale == SSIM_MS_SCALES - 1;
+
+        if (scale > 1) {
+            const uint8_t *main_up = m->ms_main[c][scale - 2];
+            const uint8_t *ref_up = m->ms_ref[c][scale - 2];
+            const int stride_up = ms_stride(m, c, scale - 1);
+            const int h = m->planeheight[c] >> scale;
+
+            downscale_rows(m->ms_main[c][scale - 1], stride, main_up, stride_up,
+                           m->planewidth[c] >> scale, 0, h);
+            downscale_rows(m->ms_ref[c][scale - 1], stride, ref_up, stride_up,
+                           m->planewidth[c] >> scale, 0, h);
+        }
+
+        width = (m->planewidth[c] >> scale) >> 2;
+        height = (m->planeheight[c] >> scale) >> 2;
+        /* the luminance term is only used at the coarsest scale */
+        ssim_plane_rows(&m->dsp, main, stride, ref, stride,
+                        width, 1, height, m->temp[0],
+                        last ? row_score : NULL, last ? NULL : row_score);
+
+        val = 0;
+        for (y = 1; y < height; y++)
+            val += row_score[y];
+        val /= (height - 1) * (width - 1);
+        ms *= pow(FFMAX(val, 0), weights[scale]);
+    }
+
+    return ms;
+}
+
+static double ssim_db(double ssim, double weight)
+{
+    return 10 * log10(weight / (weight - ssim));
+}
+
+void ff_ssim_metrics_frame(SSIMMetrics *m, AVDictionary **metadata)
+{
+    float *c = m->frame_ssim, ssimv = 0.0;
+    int i, y;
+
+    m->nb_frames++;
+
+    for (i = 0; i < m->nb_components; i++) {
+        const int width = m->planewidth[i] >> 2;
+        const int height = m->planeheight[i] >> 2;
+        float ssim = 0.0;
+
+        /* sum the per-row scores in order so the result does not depend
+         * on the number of slices */
+        for (y = 1; y < height; y++)
+            ssim += m->score[i][y];
+        c[i] = ssim / ((height - 1) * (width - 1));
+        ssimv += m->coefs[i] * c[i];
+        m->ssim[i] += c[i];
+    }
+    for (i = 0; i < m->nb_components; i++) {
+        int cidx = m->is_rgb ? m->rgba_map[i] : i;
+        set_meta(metadata, "lavfi.ssim.", m->comps[i], c[cidx]);
+    }
+    m->ssim_total += ssimv;
+    m->frame_ssim_total = ssimv;
+
+    set_meta(metadata, "lavfi.ssim.All", 0, ssimv);
+    set_meta(metadata, "lavfi.ssim.dB", 0, ssim_db(ssimv, 1.0));
+
+    if (m->ms_ssim) {
+        float *ms = m->frame_ms, msv = 0.0;
+
+        for (i = 0; i < m->nb_components; i++) {
+            ms[i] = ms_ssim_plane(m, i);
+            msv += m->coefs[i] * ms[i];
+            m->ms[i] += ms[i];
+        }
+        for (i = 0; i < m->nb_components; i++) {
+            int cidx = m->is_rgb ? m->rgba_map[i] : i;
+            set_meta(metadata, "lavfi.ms_ssim.", m->comps[i], ms[cidx]);
+        }
+        m->ms_total += msv;
+        m->frame_ms_total = msv;
+
+        set_meta(metadata, "lavfi.ms_ssim.All", 0, msv);
+        set_meta(metadata, "lavfi.ms_ssim.dB", 0, ssim_db(msv, 1.0));
+    }
+}
+
+void ff_ssim_metrics_print(SSIMMetrics *m, FILE *f)
+{
+    int i;
+
+    for (i = 0; i < m->nb_components; i++) {
+        int cidx = m->is_rgb ? m->rgba_map[i] : i;
+        fprintf(f, "%c:%f ", m->comps[i], m->frame_ssim[cidx]);
+    }
+
+    fprintf(f, "All:%f (%f)", m->frame_ssim_total, ssim_db(m->frame_ssim_total, 1.0));
+
+    if (m->ms_ssim) {
+        for (i = 0; i < m->nb_components; i++) {
+            int cidx = m->is_rgb ? m->rgba_map[i] : i;
+            fprintf(f, " ms_%c:%f", m->comps[i], m->frame_ms[cidx]);
+        }
+
+        fprintf(f, " ms_All:%f (%f)", m->frame_ms_total, ssim_db(m->frame_ms_total, 1.0));
+    }
+}
+
+void ff_ssim_metrics_log(void *log_ctx, SSIMMetrics *m)
+{
+    char buf[256];
+    int i;
+
+    if (!m->nb_frames)
+        return;
+
+    buf[0] = 0;
+    for (i = 0; i < m->nb_components; i++) {
+        int c = m->is_rgb ? m->rgba_map[i] : i;
+        av_strlcatf(buf, sizeof(buf), " %c:%f (%f)", m->comps[i], m->ssim[c] / m->nb_frames,
+                    ssim_db(m->ssim[c], m->nb_frames));
+    }
+    av_log(log_ctx, AV_LOG_INFO, "SSIM%s All:%f (%f)\n", buf,
+           m->ssim_total / m->nb_frames, ssim_db(m->ssim_total, m->nb_frames));
+
+    if (m->ms_ssim) {
+        buf[0] = 0;
+        for (i = 0; i < m->nb_components; i++) {
+            int c = m->is_rgb ? m->rgba_map[i] : i;
+            av_strlcatf(buf, sizeof(buf), " %c:%f (%f)", m->comps[i], m->ms[c] / m->nb_frames,
+                        ssim_db(m->ms[c], m->nb_frames));
+        }
+        av_log(log_ctx, AV_LOG_INFO, "MS-SSIM%s All:%f (%f)\n", buf,
+               m->ms_total / m->nb_frames, ssim_db(m->ms_total, m->nb_frames));
+    }
+}
+
+int ff_ssim_metrics_config(SSIMMetrics *m, void *log_ctx,
+                           AVFilterLink *inlink, int nb_jobs)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int sum = 0, i, j;
+
+    m->nb_components = desc->nb_components;
+
+    m->is_rgb = ff_fill_rgba_map(m->rgba_map, inlink->format) >= 0;
+    m->comps[0] = m->is_rgb ? 'R' : 'Y';
+    m->comps[1] = m->is_rgb ? 'G' : 'U';
+    m->comps[2] = m->is_rgb ? 'B' : 'V';
+    m->comps[3] = 'A';
+
+    m->planeheight[1] = m->planeheight[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
+    m->planeheight[0] = m->planeheight[3] = inlink->h;
+    m->planewidth[1]  = m->planewidth[2]  = AV_CEIL_RSHIFT(inlink->w, desc->log2_chroma_w);
+    m->planewidth[0]  = m->planewidth[3]  = inlink->w;
+    for (i = 0; i < m->nb_components; i++)
+        sum += m->planeheight[i] * m->planewidth[i];
+    for (i = 0; i < m->nb_components; i++)
+        m->coefs[i] = (double) m->planeheight[i] * m->planewidth[i] / sum;
+
+    m->nb_temp = nb_jobs;
+    m->temp = av_calloc(m->nb_temp, sizeof(*m->temp));
+    if (!m->temp)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < m->nb_temp; i++) {
+        m->temp[i] = av_malloc((2 * inlink->w + 12) * sizeof(**m->temp));
+        if (!m->temp[i])
+            return AVERROR(ENOMEM);
+    }
+
+    for (i = 0; i < m->nb_components; i++) {
+        m->score[i] = av_malloc_array((m->planeheight[i] >> 2) + 1, sizeof(*m->score[i]));
+        if (!m->score[i])
+            return AVERROR(ENOMEM);
+    }
+
+    if (m->ms_ssim) {
+        for (i = 0; i < m->nb_components; i++) {
+            /* the coarsest scale needs at least 2x2 blocks of 4x4 pixels */
+            if ((m->planewidth[i]  >> (SSIM_MS_SCALES - 1)) < 8 ||
+                (m->planeheight[i] >> (SSIM_MS_SCALES - 1)) < 8) {
+                av_log(log_ctx, AV_LOG_ERROR,
+                       "Planes must be at least %dx%d for MS-SSIM.\n",
+                       8 << (SSIM_MS_SCALES - 1), 8 << (SSIM_MS_SCALES - 1));
+                return AVERROR(EINVAL);
+            }
+
+            m->cs_score[i] = av_malloc_array((m->planeheight[i] >> 2) + 1, sizeof(*m->cs_score[i]));
+            if (!m->cs_score[i])
+                return AVERROR(ENOMEM);
+
+            for (j = 1; j < SSIM_MS_SCALES; j++) {
+                int size = ms_stride(m, i, j) * (m->planeheight[i] >> j) + 32;
+
+                m->ms_main[i][j - 1] = av_mallocz(size);
+                m->ms_ref[i][j - 1] = av_mallocz(size);
+                if (!m->ms_main[i][j - 1] || !m->ms_ref[i][j - 1])
+                    return AVERROR(ENOMEM);
+            }
+        }
+    }
+
+    m->dsp.ssim_4x4_line = ssim_4x4xn;
+    m->dsp.ssim_end_line = ssim_endn;
+    if (ARCH_X86)
+        ff_ssim_init_x86(&m->dsp);
+
+    return 0;
+}
+
+void ff_ssim_metrics_uninit(SSIMMetrics *m)
+{
+    int i, j;
+
+    for (i = 0; i < m->nb_temp && m->temp; i++)
+        av_freep(&m->temp[i]);
+    av_freep(&m->temp);
+    for (i = 0; i < 4; i++) {
+        av_freep(&m->score[i]);
+        av_freep(&m->cs_score[i]);
+        for (j = 0; j < SSIM_MS_SCALES - 1; j++) {
+            av_freep(&m->ms_main[i][j]);
+            av_freep(&m->ms_ref[i][j]);
+        }
+    }
+}
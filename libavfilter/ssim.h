@@ -23,6 +23,11 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/frame.h"
+#include "avfilter.h"
 
 typedef struct SSIMDSPContext {
     void (*ssim_4x4_line)(const uint8_t *buf, ptrdiff_t buf_stride,
@@ -33,4 +38,75 @@ typedef struct SSIMDSPContext {
 
 void ff_ssim_init_x86(SSIMDSPContext *dsp);
 
+#define SSIM_MS_SCALES 5
+
+/**
+ * SSIM and MS-SSIM computation and statistics, shared by the filters
+ * reporting them.
+ */
+typedef struct SSIMMetrics {
+    int ms_ssim;        ///< also compute MS-SSIM, set before configuring
+    int nb_components;
+    uint64_t nb_frames;
+    double ssim[4], ssim_total;
+    double ms[4], ms_total;
+    float frame_ssim[4], frame_ssim_total; ///< values of the last frame
+    float frame_ms[4], frame_ms_total;
+    char comps[4];
+    float coefs[4];
+    uint8_t rgba_map[4];
+    int planewidth[4];
+    int planeheight[4];
+    int **temp;
+    float *score[4];
+    float *cs_score[4];
+    /* planes of the frames downscaled for MS-SSIM, from scale 1 */
+    uint8_t *ms_main[4][SSIM_MS_SCALES - 1];
+    uint8_t *ms_ref[4][SSIM_MS_SCALES - 1];
+    int nb_temp;
+    int is_rgb;
+    SSIMDSPContext dsp;
+} SSIMMetrics;
+
+/**
+ * Set up the metrics for the format and dimensions of inlink, for slices
+ * computed by up to nb_jobs jobs at once.
+ */
+int ff_ssim_metrics_config(SSIMMetrics *m, void *log_ctx,
+                           AVFilterLink *inlink, int nb_jobs);
+
+/**
+ * Return the number of block rows of plane c, SSIM slices are expressed in
+ * block rows from 1 to this number.
+ */
+int ff_ssim_metrics_rows(SSIMMetrics *m, int c);
+
+/**
+ * Compute block rows slice_start to slice_end - 1 of plane c, with the
+ * temporary buffers of job jobnr. May be called concurrently for distinct
+ * slices and jobs.
+ */
+void ff_ssim_metrics_slice(SSIMMetrics *m, const AVFrame *main,
+                           const AVFrame *ref, int c,
+                           int slice_start, int slice_end, int jobnr);
+
+/**
+ * Account a frame of which all block rows have been computed, and export
+ * the values to the frame metadata.
+ */
+void ff_ssim_metrics_frame(SSIMMetrics *m, AVDictionary **metadata);
+
+/**
+ * Write the values of the last frame to a stats file, as the ssim filter
+ * does, without frame number and line ending.
+ */
+void ff_ssim_metrics_print(SSIMMetrics *m, FILE *f);
+
+/**
+ * Log the averages over all frames.
+ */
+void ff_ssim_metrics_log(void *log_ctx, SSIMMetrics *m);
+
+void ff_ssim_metrics_uninit(SSIMMetrics *m);
+
 #endif /* AVFILTER_SSIM_H */
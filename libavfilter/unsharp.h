@@ -65,7 +65,8 @@ typedef struct UnsharpFilterParam {
     int steps_y;                             ///< vertical step count
     int scalebits;                           ///< bits to shift pixel
     int32_t halfscale;                       ///< amount to add to pixel
-    uint32_t *sc[MAX_MATRIX_SIZE - 1];       ///< finite state machine storage
+    uint32_t **sc;                           ///< vertical finite state machine storage, 2 * steps_y rows per thread
+    uint32_t **sr;                           ///< horizontal sums, one row per thread
 } UnsharpFilterParam;
 
 typedef struct UnsharpContext {
@@ -75,6 +76,9 @@ typedef struct UnsharpContext {
     UnsharpFilterParam luma;   ///< luma parameters (width, height, amount)
     UnsharpFilterParam chroma; ///< chroma parameters (width, height, amount)
     int hsub, vsub;
+    int bitdepth;
+    int bps;
+    int nb_threads;
     int opencl;
 #if CONFIG_OPENCL
     UnsharpOpenclContext opencl_ctx;
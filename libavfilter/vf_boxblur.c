@@ -70,9 +70,14 @@ typedef struct BoxBlurContext {
     int hsub, vsub;
     int radius[4];
     int power[4];
-    uint8_t *temp[2]; ///< temporary buffer used in blur_power()
+    int nb_threads;
+    uint8_t **temp;      ///< temporary buffers used in blur_power(), two per thread
+    uint8_t **transpose; ///< per-thread buffers for the column blocks of vblur()
 } BoxBlurContext;
 
+/* number of columns vblur() transposes and blurs at once */
+#define VBLUR_BLOCK 16
+
 #define Y 0
 #define U 1
 #define V 2
@@ -110,9 +115,16 @@ static av_cold int init(AVFilterContext *ctx)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     BoxBlurContext *s = ctx->priv;
-
-    av_freep(&s->temp[0]);
-    av_freep(&s->temp[1]);
+    int i;
+
+    if (s->temp)
+        for (i = 0; i < 2 * s->nb_threads; i++)
+            av_freep(&s->temp[i]);
+    if (s->transpose)
+        for (i = 0; i < s->nb_threads; i++)
+            av_freep(&s->transpose[i]);
+    av_freep(&s->temp);
+    av_freep(&s->transpose);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -141,11 +153,19 @@ static int config_input(AVFilterLink *inlink)
     int cw, ch;
     double var_values[VARS_NB], res;
     char *expr;
-    int ret;
+    int i, ret;
 
-    if (!(s->temp[0] = av_malloc(2*FFMAX(w, h))) ||
-        !(s->temp[1] = av_malloc(2*FFMAX(w, h))))
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    s->temp      = av_mallocz_array(2 * s->nb_threads, sizeof(*s->temp));
+    s->transpose = av_mallocz_array(s->nb_threads, sizeof(*s->transpose));
+    if (!s->temp || !s->transpose)
         return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_threads; i++) {
+        if (!(s->temp[2*i    ] = av_malloc(2*FFMAX(w, h))) ||
+            !(s->temp[2*i + 1] = av_malloc(2*FFMAX(w, h))) ||
+            !(s->transpose[i]  = av_malloc_array(VBLUR_BLOCK, 2*h)))
+            return AVERROR(ENOMEM);
+    }
 
     s->hsub = desc->log2_chroma_w;
     s->vsub = desc->log2_chroma_h;
@@ -306,17 +326,96 @@ static void hblur(uint8_t *dst, int dst_linesize, const uint8_t *src, int src_li
                    w, radius, power, temp, pixsize);
 }
 
+/* Walking down single columns touches a new cache line for every pixel, so
+ * the columns are copied in blocks of VBLUR_BLOCK into a transposed buffer,
+ * blurred there as contiguous lines and copied back. */
 static void vblur(uint8_t *dst, int dst_linesize, const uint8_t *src, int src_linesize,
-                  int w, int h, int radius, int power, uint8_t *temp[2], int pixsize)
+                  int x_start, int x_end, int h, int radius, int power,
+                  uint8_t *temp[2], uint8_t *transpose, int pixsize)
 {
-    int x;
+    const int tstride = h * pixsize;
+    int x, y, i;
 
     if (radius == 0 && dst == src)
         return;
 
-    for (x = 0; x < w; x++)
-        blur_power(dst + x*pixsize, dst_linesize, src + x*pixsize, src_linesize,
-                   h, radius, power, temp, pixsize);
+    for (x = x_start; x < x_end; x += VBLUR_BLOCK) {
+        const int n = FFMIN(VBLUR_BLOCK, x_end - x);
+
+        for (y = 0; y < h; y++) {
+            const uint8_t *srcp = src + y*src_linesize + x*pixsize;
+            if (pixsize == 1) {
+                for (i = 0; i < n; i++)
+                    transpose[i*tstride + y] = srcp[i];
+            } else {
+                for (i = 0; i < n; i++)
+                    ((uint16_t*)(transpose + i*tstride))[y] = ((const uint16_t*)srcp)[i];
+            }
+        }
+
+        for (i = 0; i < n; i++)
+            blur_power(transpose + i*tstride, pixsize, transpose + i*tstride, pixsize,
+                       h, radius, power, temp, pixsize);
+
+        for (y = 0; y < h; y++) {
+            uint8_t *dstp = dst + y*dst_linesize + x*pixsize;
+            if (pixsize == 1) {
+                for (i = 0; i < n; i++)
+                    dstp[i] = transpose[i*tstride + y];
+            } else {
+                for (i = 0; i < n; i++)
+                    ((uint16_t*)dstp)[i] = ((const uint16_t*)(transpose + i*tstride))[y];
+            }
+        }
+    }
+}
+
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int w[4], h[4];
+    int pixsize;
+} ThreadData;
+
+static int hblur_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    BoxBlurContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in, *out = td->out;
+    int plane;
+
+    for (plane = 0; plane < 4 && in->data[plane] && in->linesize[plane]; plane++) {
+        const int slice_start = (td->h[plane] *  jobnr     ) / nb_jobs;
+        const int slice_end   = (td->h[plane] * (jobnr + 1)) / nb_jobs;
+
+        hblur(out->data[plane] + slice_start * out->linesize[plane], out->linesize[plane],
+              in ->data[plane] + slice_start * in ->linesize[plane], in ->linesize[plane],
+              td->w[plane], slice_end - slice_start,
+              s->radius[plane], s->power[plane],
+              s->temp + 2 * jobnr, td->pixsize);
+    }
+    return 0;
+}
+
+static int vblur_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    BoxBlurContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in, *out = td->out;
+    int plane;
+
+    for (plane = 0; plane < 4 && in->data[plane] && in->linesize[plane]; plane++) {
+        /* keep the column slices aligned to whole blocks */
+        const int nb_blocks   = (td->w[plane] + VBLUR_BLOCK - 1) / VBLUR_BLOCK;
+        const int slice_start = FFMIN((nb_blocks *  jobnr     ) / nb_jobs * VBLUR_BLOCK, td->w[plane]);
+        const int slice_end   = FFMIN((nb_blocks * (jobnr + 1)) / nb_jobs * VBLUR_BLOCK, td->w[plane]);
+
+        vblur(out->data[plane], out->linesize[plane],
+              out->data[plane], out->linesize[plane],
+              slice_start, slice_end, td->h[plane],
+              s->radius[plane], s->power[plane],
+              s->temp + 2 * jobnr, s->transpose[jobnr], td->pixsize);
+    }
+    return 0;
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
@@ -325,13 +424,14 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     BoxBlurContext *s = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
     AVFrame *out;
-    int plane;
     int cw = AV_CEIL_RSHIFT(inlink->w, s->hsub), ch = AV_CEIL_RSHIFT(in->height, s->vsub);
-    int w[4] = { inlink->w, cw, cw, inlink->w };
-    int h[4] = { in->height, ch, ch, in->height };
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
     const int depth = desc->comp[0].depth;
-    const int pixsize = (depth+7)/8;
+    ThreadData td = {
+        .w       = { inlink->w, cw, cw, inlink->w },
+        .h       = { in->height, ch, ch, in->height },
+        .pixsize = (depth+7)/8,
+    };
 
     out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
     if (!out) {
@@ -340,17 +440,12 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
     av_frame_copy_props(out, in);
 
-    for (plane = 0; plane < 4 && in->data[plane] && in->linesize[plane]; plane++)
-        hblur(out->data[plane], out->linesize[plane],
-              in ->data[plane], in ->linesize[plane],
-              w[plane], h[plane], s->radius[plane], s->power[plane],
-              s->temp, pixsize);
-
-    for (plane = 0; plane < 4 && in->data[plane] && in->linesize[plane]; plane++)
-        vblur(out->data[plane], out->linesize[plane],
-              out->data[plane], out->linesize[plane],
-              w[plane], h[plane], s->radius[plane], s->power[plane],
-              s->temp, pixsize);
+    td.in  = in;
+    td.out = out;
+    ctx->internal->execute(ctx, hblur_slice, &td, NULL,
+                           FFMIN(ch, s->nb_threads));
+    ctx->internal->execute(ctx, vblur_slice, &td, NULL,
+                           FFMIN((cw + VBLUR_BLOCK - 1) / VBLUR_BLOCK, s->nb_threads));
 
     av_frame_free(&in);
 
@@ -409,5 +504,5 @@ AVFilter ff_vf_boxblur = {
     .query_formats = query_formats,
     .inputs        = avfilter_vf_boxblur_inputs,
     .outputs       = avfilter_vf_boxblur_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -189,6 +189,7 @@ static const AVFilterPad colorbalance_inputs[] = {
         .name         = "default",
         .type         = AVMEDIA_TYPE_VIDEO,
         .filter_frame = filter_frame,
+        .prefers_writable = 1,
     },
     { NULL }
 };
@@ -336,6 +336,7 @@ static const AVFilterPad colorchannelmixer_inputs[] = {
         .name         = "default",
         .type         = AVMEDIA_TYPE_VIDEO,
         .filter_frame = filter_frame,
+        .prefers_writable = 1,
     },
     { NULL }
 };
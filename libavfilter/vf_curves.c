@@ -670,6 +670,7 @@ static const AVFilterPad curves_inputs[] = {
         .type         = AVMEDIA_TYPE_VIDEO,
         .filter_frame = filter_frame,
         .config_props = config_input,
+        .prefers_writable = 1,
     },
     { NULL }
 };
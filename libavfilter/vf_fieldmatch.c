@@ -72,6 +72,12 @@ enum comb_dbg {
     NB_COMBDBG
 };
 
+typedef struct {
+    int64_t absdiff;
+    uint64_t accumPc, accumPm, accumPml;
+    uint64_t accumNc, accumNm, accumNml;
+} SliceStats;
+
 typedef struct {
     const AVClass *class;
 
@@ -82,6 +88,7 @@ typedef struct {
     uint32_t eof;                   ///< bitmask for end of stream
     int64_t lastscdiff;
     int64_t lastn;
+    int nb_threads;
 
     /* options */
     int order;
@@ -104,9 +111,11 @@ typedef struct {
     int map_linesize[4];
     uint8_t *cmask_data[4];
     int cmask_linesize[4];
-    int *c_array;
+    int *c_array;                   ///< combed block counts, one array per thread
+    int c_array_size;
     int tpitchy, tpitchuv;
     uint8_t *tbuffer;
+    SliceStats *stats;              ///< per-slice sums, reduced after each execute()
 } FieldMatchContext;
 
 #define OFFSET(x) offsetof(FieldMatchContext, x)
@@ -161,23 +170,71 @@ static int get_height(const FieldMatchContext *fm, const AVFrame *f, int plane)
     return plane ? AV_CEIL_RSHIFT(f->height, fm->vsub) : f->height;
 }
 
-static int64_t luma_abs_diff(const AVFrame *f1, const AVFrame *f2)
+#define TBUFFER_PADDING 4
+
+/* each plane gets its own part of tbuffer, with a few lines of padding since
+ * the diff map may look slightly past the last field line */
+static uint8_t *get_tbuffer(const FieldMatchContext *fm, const AVFrame *f, int plane)
+{
+    uint8_t *tbuffer = fm->tbuffer;
+
+    if (plane > 0)
+        tbuffer += ((f->height >> 1) + TBUFFER_PADDING) * fm->tpitchy;
+    if (plane > 1)
+        tbuffer += ((get_height(fm, f, 1) >> 1) + TBUFFER_PADDING) * fm->tpitchuv;
+    return tbuffer;
+}
+
+typedef struct ThreadData {
+    const AVFrame *f1, *f2;
+    int nb_planes;
+    /* compare_fields() */
+    const uint8_t *diff_prvp[3], *diff_nxtp[3];
+    const uint8_t *prvpf[3], *nxtpf[3], *srcf[3];
+    int prvf_linesize[3], nxtf_linesize[3], srcf_linesize[3];
+    uint8_t *diff_dstp[3];
+    uint8_t *mapp[3];
+    int map_linesize[3];
+} ThreadData;
+
+static int luma_abs_diff_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    FieldMatchContext *fm = ctx->priv;
+    ThreadData *td = arg;
+    const AVFrame *f1 = td->f1;
+    const AVFrame *f2 = td->f2;
     int x, y;
-    const uint8_t *srcp1 = f1->data[0];
-    const uint8_t *srcp2 = f2->data[0];
     const int src1_linesize = f1->linesize[0];
     const int src2_linesize = f2->linesize[0];
     const int width  = f1->width;
     const int height = f1->height;
+    const int slice_start = (height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+    const uint8_t *srcp1 = f1->data[0] + slice_start * src1_linesize;
+    const uint8_t *srcp2 = f2->data[0] + slice_start * src2_linesize;
     int64_t acc = 0;
 
-    for (y = 0; y < height; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for (x = 0; x < width; x++)
             acc += abs(srcp1[x] - srcp2[x]);
         srcp1 += src1_linesize;
         srcp2 += src2_linesize;
     }
+    fm->stats[jobnr].absdiff = acc;
+    return 0;
+}
+
+static int64_t luma_abs_diff(AVFilterContext *ctx, const AVFrame *f1, const AVFrame *f2)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const int nb_jobs = FFMIN(f1->height, fm->nb_threads);
+    ThreadData td = { .f1 = f1, .f2 = f2 };
+    int64_t acc = 0;
+    int i;
+
+    ctx->internal->execute(ctx, luma_abs_diff_slice, &td, NULL, nb_jobs);
+    for (i = 0; i < nb_jobs; i++)
+        acc += fm->stats[i].absdiff;
     return acc;
 }
 
@@ -191,81 +248,193 @@ static void fill_buf(uint8_t *data, int w, int h, int linesize, uint8_t v)
     }
 }
 
-static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
+/* [1 -3 4 -3 1] vertical filter */
+#define FILTER(xm2, xm1, xp1, xp2) \
+        abs(  4 * srcp[x] \
+             -3 * (srcp[x + (xm1)*src_linesize] + srcp[x + (xp1)*src_linesize]) \
+             +    (srcp[x + (xm2)*src_linesize] + srcp[x + (xp2)*src_linesize])) > cthresh6
+
+static int build_combed_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int x, y, plane, max_v = 0;
+    const FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *src = td->f1;
+    int x, y, plane;
     const int cthresh = fm->cthresh;
     const int cthresh6 = cthresh * 6;
 
     for (plane = 0; plane < (fm->chroma ? 3 : 1); plane++) {
-        const uint8_t *srcp = src->data[plane];
         const int src_linesize = src->linesize[plane];
         const int width  = get_width (fm, src, plane);
         const int height = get_height(fm, src, plane);
-        uint8_t *cmkp = fm->cmask_data[plane];
         const int cmk_linesize = fm->cmask_linesize[plane];
+        const int slice_start = (height *  jobnr   ) / nb_jobs;
+        const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+        const uint8_t *srcp = src->data[plane] + slice_start * src_linesize;
+        uint8_t *cmkp = fm->cmask_data[plane] + slice_start * cmk_linesize;
 
         if (cthresh < 0) {
-            fill_buf(cmkp, width, height, cmk_linesize, 0xff);
+            fill_buf(cmkp, width, slice_end - slice_start, cmk_linesize, 0xff);
             continue;
         }
-        fill_buf(cmkp, width, height, cmk_linesize, 0);
-
-        /* [1 -3 4 -3 1] vertical filter */
-#define FILTER(xm2, xm1, xp1, xp2) \
-        abs(  4 * srcp[x] \
-             -3 * (srcp[x + (xm1)*src_linesize] + srcp[x + (xp1)*src_linesize]) \
-             +    (srcp[x + (xm2)*src_linesize] + srcp[x + (xp2)*src_linesize])) > cthresh6
-
-        /* first line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && FILTER(2, 1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* second line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(2, -1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* all lines minus first two and last two */
-        for (y = 2; y < height-2; y++) {
-            for (x = 0; x < width; x++) {
-                const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-                const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-                if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, 2))
-                    cmkp[x] = 0xff;
+        fill_buf(cmkp, width, slice_end - slice_start, cmk_linesize, 0);
+
+        for (y = slice_start; y < slice_end; y++) {
+            if (y == 0) {
+                /* first line */
+                for (x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && FILTER(2, 1, 1, 2))
+                        cmkp[x] = 0xff;
+                }
+            } else if (y == 1) {
+                /* second line */
+                for (x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && s2 > cthresh && FILTER(2, -1, 1, 2))
+                        cmkp[x] = 0xff;
+                }
+            } else if (y < height - 2) {
+                /* all lines minus first two and last two */
+                for (x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, 2))
+                        cmkp[x] = 0xff;
+                }
+            } else if (y == height - 2) {
+                /* before-last line */
+                for (x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, -2))
+                        cmkp[x] = 0xff;
+                }
+            } else {
+                /* last line */
+                for (x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    if (s1 > cthresh && FILTER(-2, -1, -1, -2))
+                        cmkp[x] = 0xff;
+                }
             }
             srcp += src_linesize;
             cmkp += cmk_linesize;
         }
+    }
+
+    return 0;
+}
+
+static int count_combed_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *src = td->f1;
+    int x, y;
+    const int blockx = fm->blockx;
+    const int blocky = fm->blocky;
+    const int xhalf = blockx/2;
+    const int yhalf = blocky/2;
+    const int cmk_linesize = fm->cmask_linesize[0];
+    const uint8_t *cmkp;
+    const int width  = src->width;
+    const int height = src->height;
+    const int xblocks = ((width+xhalf)/blockx) + 1;
+    const int xblocks4 = xblocks<<2;
+    int *c_array = fm->c_array + jobnr * fm->c_array_size;
+    int      heighta = (height/(blocky/2))*(blocky/2);
+    const int widtha = (width /(blockx/2))*(blockx/2);
+    int nb_steps, step_start, step_end;
+    if (heighta == height)
+        heighta = height - yhalf;
+    memset(c_array, 0, fm->c_array_size * sizeof(*c_array));
+
+    /* each slice gets a range of yhalf high block rows; the partial rows
+     * at the top and bottom go to the first and last slices */
+    nb_steps   = FFMAX(heighta / yhalf - 1, 0);
+    step_start = (nb_steps *  jobnr   ) / nb_jobs;
+    step_end   = (nb_steps * (jobnr+1)) / nb_jobs;
+
+#define C_ARRAY_ADD(v) do {                         \
+    const int box1 = (x / blockx) * 4;              \
+    const int box2 = ((x + xhalf) / blockx) * 4;    \
+    c_array[temp1 + box1    ] += v;                 \
+    c_array[temp1 + box2 + 1] += v;                 \
+    c_array[temp2 + box1 + 2] += v;                 \
+    c_array[temp2 + box2 + 3] += v;                 \
+} while (0)
+
+#define VERTICAL_HALF(y_start, y_end) do {                                  \
+    cmkp = fm->cmask_data[0] + (y_start) * cmk_linesize;                    \
+    for (y = y_start; y < y_end; y++) {                                     \
+        const int temp1 = (y / blocky) * xblocks4;                          \
+        const int temp2 = ((y + yhalf) / blocky) * xblocks4;                \
+        for (x = 0; x < width; x++)                                         \
+            if (cmkp[x - cmk_linesize] == 0xff &&                           \
+                cmkp[x               ] == 0xff &&                           \
+                cmkp[x + cmk_linesize] == 0xff)                             \
+                C_ARRAY_ADD(1);                                             \
+        cmkp += cmk_linesize;                                               \
+    }                                                                       \
+} while (0)
+
+    if (jobnr == 0)
+        VERTICAL_HALF(1, yhalf);
 
-        /* before-last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, -2))
-                cmkp[x] = 0xff;
+    cmkp = fm->cmask_data[0] + (yhalf + step_start * yhalf) * cmk_linesize;
+    for (y = yhalf + step_start * yhalf; y < yhalf + step_end * yhalf; y += yhalf) {
+        const int temp1 = (y / blocky) * xblocks4;
+        const int temp2 = ((y + yhalf) / blocky) * xblocks4;
+
+        for (x = 0; x < widtha; x += xhalf) {
+            const uint8_t *cmkp_tmp = cmkp + x;
+            int u, v, sum = 0;
+            for (u = 0; u < yhalf; u++) {
+                for (v = 0; v < xhalf; v++)
+                    if (cmkp_tmp[v - cmk_linesize] == 0xff &&
+                        cmkp_tmp[v               ] == 0xff &&
+                        cmkp_tmp[v + cmk_linesize] == 0xff)
+                        sum++;
+                cmkp_tmp += cmk_linesize;
+            }
+            if (sum)
+                C_ARRAY_ADD(sum);
         }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            if (s1 > cthresh && FILTER(-2, -1, -1, -2))
-                cmkp[x] = 0xff;
+
+        for (x = widtha; x < width; x++) {
+            const uint8_t *cmkp_tmp = cmkp + x;
+            int u, sum = 0;
+            for (u = 0; u < yhalf; u++) {
+                if (cmkp_tmp[-cmk_linesize] == 0xff &&
+                    cmkp_tmp[            0] == 0xff &&
+                    cmkp_tmp[ cmk_linesize] == 0xff)
+                    sum++;
+                cmkp_tmp += cmk_linesize;
+            }
+            if (sum)
+                C_ARRAY_ADD(sum);
         }
+
+        cmkp += cmk_linesize * yhalf;
     }
 
+    if (jobnr == nb_jobs - 1)
+        VERTICAL_HALF(FFMAX(heighta, yhalf), height - 1);
+
+    return 0;
+}
+
+static int calc_combed_score(AVFilterContext *ctx, const AVFrame *src)
+{
+    FieldMatchContext *fm = ctx->priv;
+    ThreadData td = { .f1 = src };
+    int x, y, i, nb_jobs, max_v = 0;
+
+    nb_jobs = FFMIN(get_height(fm, src, 1), fm->nb_threads);
+    ctx->internal->execute(ctx, build_combed_mask_slice, &td, NULL, nb_jobs);
+
     if (fm->chroma) {
         uint8_t *cmkp  = fm->cmask_data[0];
         uint8_t *cmkpU = fm->cmask_data[1];
@@ -299,91 +468,15 @@ static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
         }
     }
 
-    {
-        const int blockx = fm->blockx;
-        const int blocky = fm->blocky;
-        const int xhalf = blockx/2;
-        const int yhalf = blocky/2;
-        const int cmk_linesize = fm->cmask_linesize[0];
-        const uint8_t *cmkp    = fm->cmask_data[0] + cmk_linesize;
-        const int width  = src->width;
-        const int height = src->height;
-        const int xblocks = ((width+xhalf)/blockx) + 1;
-        const int xblocks4 = xblocks<<2;
-        const int yblocks = ((height+yhalf)/blocky) + 1;
-        int *c_array = fm->c_array;
-        const int arraysize = (xblocks*yblocks)<<2;
-        int      heighta = (height/(blocky/2))*(blocky/2);
-        const int widtha = (width /(blockx/2))*(blockx/2);
-        if (heighta == height)
-            heighta = height - yhalf;
-        memset(c_array, 0, arraysize * sizeof(*c_array));
-
-#define C_ARRAY_ADD(v) do {                         \
-    const int box1 = (x / blockx) * 4;              \
-    const int box2 = ((x + xhalf) / blockx) * 4;    \
-    c_array[temp1 + box1    ] += v;                 \
-    c_array[temp1 + box2 + 1] += v;                 \
-    c_array[temp2 + box1 + 2] += v;                 \
-    c_array[temp2 + box2 + 3] += v;                 \
-} while (0)
+    nb_jobs = FFMIN(src->height / fm->blocky + 1, fm->nb_threads);
+    ctx->internal->execute(ctx, count_combed_slice, &td, NULL, nb_jobs);
 
-#define VERTICAL_HALF(y_start, y_end) do {                                  \
-    for (y = y_start; y < y_end; y++) {                                     \
-        const int temp1 = (y / blocky) * xblocks4;                          \
-        const int temp2 = ((y + yhalf) / blocky) * xblocks4;                \
-        for (x = 0; x < width; x++)                                         \
-            if (cmkp[x - cmk_linesize] == 0xff &&                           \
-                cmkp[x               ] == 0xff &&                           \
-                cmkp[x + cmk_linesize] == 0xff)                             \
-                C_ARRAY_ADD(1);                                             \
-        cmkp += cmk_linesize;                                               \
-    }                                                                       \
-} while (0)
-
-        VERTICAL_HALF(1, yhalf);
-
-        for (y = yhalf; y < heighta; y += yhalf) {
-            const int temp1 = (y / blocky) * xblocks4;
-            const int temp2 = ((y + yhalf) / blocky) * xblocks4;
-
-            for (x = 0; x < widtha; x += xhalf) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, v, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    for (v = 0; v < xhalf; v++)
-                        if (cmkp_tmp[v - cmk_linesize] == 0xff &&
-                            cmkp_tmp[v               ] == 0xff &&
-                            cmkp_tmp[v + cmk_linesize] == 0xff)
-                            sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
-            }
-
-            for (x = widtha; x < width; x++) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    if (cmkp_tmp[-cmk_linesize] == 0xff &&
-                        cmkp_tmp[            0] == 0xff &&
-                        cmkp_tmp[ cmk_linesize] == 0xff)
-                        sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
-            }
-
-            cmkp += cmk_linesize * yhalf;
-        }
-
-        VERTICAL_HALF(heighta, height - 1);
-
-        for (x = 0; x < arraysize; x++)
-            if (c_array[x] > max_v)
-                max_v = c_array[x];
+    for (x = 0; x < fm->c_array_size; x++) {
+        int v = fm->c_array[x];
+        for (i = 1; i < nb_jobs; i++)
+            v += fm->c_array[i * fm->c_array_size + x];
+        if (v > max_v)
+            max_v = v;
     }
     return max_v;
 }
@@ -407,23 +500,50 @@ static void build_abs_diff_mask(const uint8_t *prvp, int prv_linesize,
     }
 }
 
+static int build_abs_diff_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    int plane;
+
+    for (plane = 0; plane < td->nb_planes; plane++) {
+        const int tpitch = plane ? fm->tpitchuv : fm->tpitchy;
+        const int width  = get_width(fm, td->f1, plane);
+        const int height = get_height(fm, td->f1, plane) >> 1;
+        const int slice_start = (height *  jobnr   ) / nb_jobs;
+        const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+        uint8_t *tbuffer = get_tbuffer(fm, td->f1, plane);
+
+        /* with 4:4:4 input tpitchuv is narrower than a line, so each line
+         * overwrites the end of the previous one; only write what survives */
+        build_abs_diff_mask(td->diff_prvp[plane] + slice_start * td->prvf_linesize[plane], td->prvf_linesize[plane],
+                            td->diff_nxtp[plane] + slice_start * td->nxtf_linesize[plane], td->nxtf_linesize[plane],
+                            tbuffer + slice_start * tpitch, tpitch,
+                            FFMIN(width, tpitch), slice_end - slice_start);
+        if (width > tpitch && slice_end == height && height > 0)
+            build_abs_diff_mask(td->diff_prvp[plane] + (height - 1) * td->prvf_linesize[plane], td->prvf_linesize[plane],
+                                td->diff_nxtp[plane] + (height - 1) * td->nxtf_linesize[plane], td->nxtf_linesize[plane],
+                                tbuffer + (height - 1) * tpitch, tpitch,
+                                width, 1);
+    }
+
+    return 0;
+}
+
 /**
  * Build a map over which pixels differ a lot/a little
  */
-static void build_diff_map(FieldMatchContext *fm,
-                           const uint8_t *prvp, int prv_linesize,
-                           const uint8_t *nxtp, int nxt_linesize,
+static void build_diff_map(const FieldMatchContext *fm, const uint8_t *tbuffer,
                            uint8_t *dstp, int dst_linesize, int height,
-                           int width, int plane)
+                           int width, int plane, int y_start, int y_end)
 {
     int x, y, u, diff, count;
     int tpitch = plane ? fm->tpitchuv : fm->tpitchy;
-    const uint8_t *dp = fm->tbuffer + tpitch;
+    const uint8_t *dp = tbuffer + tpitch * (y_start >> 1);
 
-    build_abs_diff_mask(prvp, prv_linesize, nxtp, nxt_linesize,
-                        fm->tbuffer, tpitch, width, height>>1);
+    dstp += dst_linesize * ((y_start - 2) >> 1);
 
-    for (y = 2; y < height - 2; y += 2) {
+    for (y = y_start; y < y_end; y += 2) {
         for (x = 1; x < width - 1; x++) {
             diff = dp[x];
             if (diff > 3) {
@@ -468,79 +588,75 @@ static void build_diff_map(FieldMatchContext *fm,
     }
 }
 
-enum { mP, mC, mN, mB, mU };
-
-static int get_field_base(int match, int field)
+/**
+ * Get the range of field lines [y_start, y_end) handled by a slice, the
+ * lines being 2, 4, ... up to height - 2 excluded.
+ */
+static void get_field_slice(int height, int jobnr, int nb_jobs, int *y_start, int *y_end)
 {
-    return match < 3 ? 2 - field : 1 + field;
+    const int nb_lines = FFMAX(height - 3, 0) >> 1;
+
+    *y_start = 2 + 2 * ((nb_lines *  jobnr   ) / nb_jobs);
+    *y_end   = 2 + 2 * ((nb_lines * (jobnr+1)) / nb_jobs);
 }
 
-static AVFrame *select_frame(FieldMatchContext *fm, int match)
+static int build_diff_map_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    if      (match == mP || match == mB) return fm->prv;
-    else if (match == mN || match == mU) return fm->nxt;
-    else  /* match == mC */              return fm->src;
+    const FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    int plane;
+
+    for (plane = 0; plane < td->nb_planes; plane++) {
+        const int height = get_height(fm, td->f1, plane);
+        int y_start, y_end;
+
+        get_field_slice(height, jobnr, nb_jobs, &y_start, &y_end);
+        build_diff_map(fm, get_tbuffer(fm, td->f1, plane),
+                       td->diff_dstp[plane], td->map_linesize[plane], height,
+                       get_width(fm, td->f1, plane), plane, y_start, y_end);
+    }
+
+    return 0;
 }
 
-static int compare_fields(FieldMatchContext *fm, int match1, int match2, int field)
+static int compare_fields_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int plane, ret;
+    const FieldMatchContext *fm = ctx->priv;
+    const ThreadData *td = arg;
+    SliceStats *stats = &fm->stats[jobnr];
     uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
     uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
-    int norm1, norm2, mtn1, mtn2;
-    float c1, c2, mr;
-    const AVFrame *src = fm->src;
+    int plane;
 
-    for (plane = 0; plane < (fm->mchroma ? 3 : 1); plane++) {
-        int x, y, temp1, temp2, fbase;
-        const AVFrame *prev, *next;
-        uint8_t *mapp    = fm->map_data[plane];
-        int map_linesize = fm->map_linesize[plane];
-        const uint8_t *srcp = src->data[plane];
-        const int src_linesize  = src->linesize[plane];
-        const int srcf_linesize = src_linesize << 1;
-        int prv_linesize,  nxt_linesize;
-        int prvf_linesize, nxtf_linesize;
-        const int width  = get_width (fm, src, plane);
-        const int height = get_height(fm, src, plane);
+    for (plane = 0; plane < td->nb_planes; plane++) {
+        int x, y, temp1, temp2, y_start, y_end, off;
+        const int width  = get_width (fm, td->f1, plane);
+        const int height = get_height(fm, td->f1, plane);
         const int y0a = fm->y0 >> (plane != 0);
         const int y1a = fm->y1 >> (plane != 0);
         const int startx = (plane == 0 ? 8 : 4);
         const int stopx  = width - startx;
+        const int prvf_linesize = td->prvf_linesize[plane];
+        const int nxtf_linesize = td->nxtf_linesize[plane];
+        const int srcf_linesize = td->srcf_linesize[plane];
+        const int map_linesize  = td->map_linesize[plane];
         const uint8_t *srcpf, *srcf, *srcnf;
         const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
+        const uint8_t *mapp;
 
-        fill_buf(mapp, width, height, map_linesize, 0);
+        get_field_slice(height, jobnr, nb_jobs, &y_start, &y_end);
+        off = (y_start - 2) >> 1;
 
-        /* match1 */
-        fbase = get_field_base(match1, field);
-        srcf  = srcp + (fbase + 1) * src_linesize;
+        srcf  = td->srcf[plane] + off * srcf_linesize;
         srcpf = srcf - srcf_linesize;
         srcnf = srcf + srcf_linesize;
-        mapp  = mapp + fbase * map_linesize;
-        prev = select_frame(fm, match1);
-        prv_linesize  = prev->linesize[plane];
-        prvf_linesize = prv_linesize << 1;
-        prvpf = prev->data[plane] + fbase * prv_linesize;   // previous frame, previous field
-        prvnf = prvpf + prvf_linesize;                      // previous frame, next     field
+        prvpf = td->prvpf[plane] + off * prvf_linesize;
+        prvnf = prvpf + prvf_linesize;
+        nxtpf = td->nxtpf[plane] + off * nxtf_linesize;
+        nxtnf = nxtpf + nxtf_linesize;
+        mapp  = td->mapp[plane] + off * map_linesize;
 
-        /* match2 */
-        fbase = get_field_base(match2, field);
-        next = select_frame(fm, match2);
-        nxt_linesize  = next->linesize[plane];
-        nxtf_linesize = nxt_linesize << 1;
-        nxtpf = next->data[plane] + fbase * nxt_linesize;   // next frame, previous field
-        nxtnf = nxtpf + nxtf_linesize;                      // next frame, next     field
-
-        map_linesize <<= 1;
-        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1))
-            build_diff_map(fm, prvpf, prvf_linesize, nxtpf, nxtf_linesize,
-                           mapp, map_linesize, height, width, plane);
-        else
-            build_diff_map(fm, prvnf, prvf_linesize, nxtnf, nxtf_linesize,
-                           mapp + map_linesize, map_linesize, height, width, plane);
-
-        for (y = 2; y < height - 2; y += 2) {
+        for (y = y_start; y < y_end; y += 2) {
             if (y0a == y1a || y < y0a || y > y1a) {
                 for (x = startx; x < stopx; x++) {
                     if (mapp[x] > 0 || mapp[x + map_linesize] > 0) {
@@ -579,6 +695,110 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         }
     }
 
+    stats->accumPc  = accumPc;
+    stats->accumPm  = accumPm;
+    stats->accumPml = accumPml;
+    stats->accumNc  = accumNc;
+    stats->accumNm  = accumNm;
+    stats->accumNml = accumNml;
+    return 0;
+}
+
+enum { mP, mC, mN, mB, mU };
+
+static int get_field_base(int match, int field)
+{
+    return match < 3 ? 2 - field : 1 + field;
+}
+
+static AVFrame *select_frame(FieldMatchContext *fm, int match)
+{
+    if      (match == mP || match == mB) return fm->prv;
+    else if (match == mN || match == mU) return fm->nxt;
+    else  /* match == mC */              return fm->src;
+}
+
+static int compare_fields(AVFilterContext *ctx, int match1, int match2, int field)
+{
+    FieldMatchContext *fm = ctx->priv;
+    int plane, ret, i, nb_jobs;
+    uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
+    uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
+    int norm1, norm2, mtn1, mtn2;
+    float c1, c2, mr;
+    const AVFrame *src = fm->src;
+    ThreadData td = { .f1 = src, .nb_planes = fm->mchroma ? 3 : 1 };
+
+    for (plane = 0; plane < td.nb_planes; plane++) {
+        int fbase;
+        const AVFrame *prev, *next;
+        uint8_t *mapp    = fm->map_data[plane];
+        int map_linesize = fm->map_linesize[plane];
+        const uint8_t *srcp = src->data[plane];
+        const int src_linesize  = src->linesize[plane];
+        const int srcf_linesize = src_linesize << 1;
+        int prv_linesize,  nxt_linesize;
+        int prvf_linesize, nxtf_linesize;
+        const int width  = get_width (fm, src, plane);
+        const int height = get_height(fm, src, plane);
+        const uint8_t *srcf;
+        const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
+
+        fill_buf(mapp, width, height, map_linesize, 0);
+
+        /* match1 */
+        fbase = get_field_base(match1, field);
+        srcf  = srcp + (fbase + 1) * src_linesize;
+        mapp  = mapp + fbase * map_linesize;
+        prev = select_frame(fm, match1);
+        prv_linesize  = prev->linesize[plane];
+        prvf_linesize = prv_linesize << 1;
+        prvpf = prev->data[plane] + fbase * prv_linesize;   // previous frame, previous field
+        prvnf = prvpf + prvf_linesize;                      // previous frame, next     field
+
+        /* match2 */
+        fbase = get_field_base(match2, field);
+        next = select_frame(fm, match2);
+        nxt_linesize  = next->linesize[plane];
+        nxtf_linesize = nxt_linesize << 1;
+        nxtpf = next->data[plane] + fbase * nxt_linesize;   // next frame, previous field
+        nxtnf = nxtpf + nxtf_linesize;                      // next frame, next     field
+
+        map_linesize <<= 1;
+        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1)) {
+            td.diff_prvp[plane] = prvpf;
+            td.diff_nxtp[plane] = nxtpf;
+            td.diff_dstp[plane] = mapp;
+        } else {
+            td.diff_prvp[plane] = prvnf;
+            td.diff_nxtp[plane] = nxtnf;
+            td.diff_dstp[plane] = mapp + map_linesize;
+        }
+
+        td.srcf[plane]          = srcf;
+        td.srcf_linesize[plane] = srcf_linesize;
+        td.prvpf[plane]         = prvpf;
+        td.prvf_linesize[plane] = prvf_linesize;
+        td.nxtpf[plane]         = nxtpf;
+        td.nxtf_linesize[plane] = nxtf_linesize;
+        td.mapp[plane]          = mapp;
+        td.map_linesize[plane]  = map_linesize;
+    }
+
+    nb_jobs = av_clip(get_height(fm, src, 1) >> 1, 1, fm->nb_threads);
+    ctx->internal->execute(ctx, build_abs_diff_mask_slice, &td, NULL, nb_jobs);
+    ctx->internal->execute(ctx, build_diff_map_slice,      &td, NULL, nb_jobs);
+    ctx->internal->execute(ctx, compare_fields_slice,      &td, NULL, nb_jobs);
+
+    for (i = 0; i < nb_jobs; i++) {
+        accumPc  += fm->stats[i].accumPc;
+        accumPm  += fm->stats[i].accumPm;
+        accumPml += fm->stats[i].accumPml;
+        accumNc  += fm->stats[i].accumNc;
+        accumNm  += fm->stats[i].accumNm;
+        accumNml += fm->stats[i].accumNml;
+    }
+
     if (accumPm < 500 && accumNm < 500 && (accumPml >= 500 || accumNml >= 500) &&
         FFMAX(accumPml,accumNml) > 3*FFMIN(accumPml,accumNml)) {
         accumPm = accumPml;
@@ -654,7 +874,7 @@ static int checkmm(AVFilterContext *ctx, int *combs, int m1, int m2,
         if (!gen_frames[mid])                                                   \
             gen_frames[mid] = create_weave_frame(ctx, mid, field,               \
                                                  fm->prv, fm->src, fm->nxt);    \
-        combs[mid] = calc_combed_score(fm, gen_frames[mid]);                    \
+        combs[mid] = calc_combed_score(ctx, gen_frames[mid]);                   \
     }                                                                           \
 } while (0)
 
@@ -723,7 +943,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             gen_frames[i] = create_weave_frame(ctx, i, field, fm->prv, fm->src, fm->nxt);
             if (!gen_frames[i])
                 return AVERROR(ENOMEM);
-            combs[i] = calc_combed_score(fm, gen_frames[i]);
+            combs[i] = calc_combed_score(ctx, gen_frames[i]);
         }
         av_log(ctx, AV_LOG_INFO, "COMBS: %3d %3d %3d %3d %3d\n",
                combs[0], combs[1], combs[2], combs[3], combs[4]);
@@ -734,22 +954,22 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
 
     /* p/c selection and optional 3-way p/c/n matches */
-    match = compare_fields(fm, fxo[mC], fxo[mP], field);
+    match = compare_fields(ctx, fxo[mC], fxo[mP], field);
     if (fm->mode == MODE_PCN || fm->mode == MODE_PCN_UB)
-        match = compare_fields(fm, match, fxo[mN], field);
+        match = compare_fields(ctx, match, fxo[mN], field);
 
     /* scene change check */
     if (fm->combmatch == COMBMATCH_SC) {
         if (fm->lastn == outlink->frame_count - 1) {
             if (fm->lastscdiff > fm->scthresh)
                 sc = 1;
-        } else if (luma_abs_diff(fm->prv, fm->src) > fm->scthresh) {
+        } else if (luma_abs_diff(ctx, fm->prv, fm->src) > fm->scthresh) {
             sc = 1;
         }
 
         if (!sc) {
             fm->lastn = outlink->frame_count;
-            fm->lastscdiff = luma_abs_diff(fm->src, fm->nxt);
+            fm->lastscdiff = luma_abs_diff(ctx, fm->src, fm->nxt);
             sc = fm->lastscdiff > fm->scthresh;
         }
     }
@@ -885,11 +1105,15 @@ static int config_input(AVFilterLink *inlink)
     fm->tpitchy  = FFALIGN(w,      16);
     fm->tpitchuv = FFALIGN(w >> 1, 16);
 
-    fm->tbuffer = av_malloc(h/2 * fm->tpitchy);
-    fm->c_array = av_malloc((((w + fm->blockx/2)/fm->blockx)+1) *
-                            (((h + fm->blocky/2)/fm->blocky)+1) *
-                            4 * sizeof(*fm->c_array));
-    if (!fm->tbuffer || !fm->c_array)
+    fm->nb_threads = ff_filter_get_nb_threads(ctx);
+    fm->c_array_size = (((w + fm->blockx/2)/fm->blockx)+1) *
+                       (((h + fm->blocky/2)/fm->blocky)+1) * 4;
+
+    fm->tbuffer = av_mallocz((h/2 + TBUFFER_PADDING) * fm->tpitchy +
+                         2 * (AV_CEIL_RSHIFT(h, fm->vsub)/2 + TBUFFER_PADDING) * fm->tpitchuv);
+    fm->c_array = av_malloc_array(fm->nb_threads, fm->c_array_size * sizeof(*fm->c_array));
+    fm->stats   = av_calloc(fm->nb_threads, sizeof(*fm->stats));
+    if (!fm->tbuffer || !fm->c_array || !fm->stats)
         return AVERROR(ENOMEM);
 
     return 0;
@@ -945,6 +1169,7 @@ static av_cold void fieldmatch_uninit(AVFilterContext *ctx)
     av_freep(&fm->cmask_data[0]);
     av_freep(&fm->tbuffer);
     av_freep(&fm->c_array);
+    av_freep(&fm->stats);
     for (i = 0; i < ctx->nb_inputs; i++)
         av_freep(&ctx->input_pads[i].name);
 }
@@ -984,5 +1209,5 @@ AVFilter ff_vf_fieldmatch = {
     .inputs         = NULL,
     .outputs        = fieldmatch_outputs,
     .priv_class     = &fieldmatch_class,
-    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -120,8 +120,125 @@ static void denoise_spatial(HQDN3DContext *s,
     }
 }
 
+typedef struct ThreadData {
+    uint8_t *src, *dst;
+    uint16_t *frame_ant;
+    int w, h, sstride, dstride;
+    int16_t *spatial, *temporal;
+} ThreadData;
+
+/* The spatial filter is separable: the horizontal recursion only depends on
+ * the current row and the vertical one only on the current column. Threaded
+ * runs therefore do the horizontal pass in row bands into s->hline and the
+ * vertical and temporal passes in column bands, which gives the same output
+ * as the serial code without any seams between the slices. */
 av_always_inline
-static int denoise_depth(HQDN3DContext *s,
+static void denoise_spatial_h(HQDN3DContext *s, ThreadData *td,
+                              int slice_start, int slice_end, int depth)
+{
+    int16_t *spatial = td->spatial + (256 << LUT_BITS);
+    long x, y;
+    uint32_t pixel_ant;
+
+    for (y = slice_start; y < slice_end; y++) {
+        uint8_t *src = td->src + y * td->sstride;
+        uint32_t *hline = s->hline + y * td->w;
+
+        pixel_ant = LOAD(0);
+        /* The first line also filters its first pixel against itself. */
+        x = 0;
+        if (y) {
+            hline[0] = pixel_ant;
+            x = 1;
+        }
+        for (; x < td->w; x++)
+            hline[x] = pixel_ant = lowpass(pixel_ant, LOAD(x), spatial, depth);
+    }
+}
+
+av_always_inline
+static void denoise_spatial_v(HQDN3DContext *s, ThreadData *td,
+                              int slice_start, int slice_end, int depth)
+{
+    int16_t *spatial  = td->spatial  + (256 << LUT_BITS);
+    int16_t *temporal = td->temporal + (256 << LUT_BITS);
+    uint16_t *line_ant  = s->line;
+    uint16_t *frame_ant = td->frame_ant;
+    uint32_t *hline = s->hline;
+    uint8_t *dst = td->dst;
+    long x, y;
+    uint32_t tmp;
+
+    for (x = slice_start; x < slice_end; x++) {
+        line_ant[x] = tmp = hline[x];
+        frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+        STORE(x, tmp);
+    }
+
+    for (y = 1; y < td->h; y++) {
+        dst       += td->dstride;
+        frame_ant += td->w;
+        hline     += td->w;
+        for (x = slice_start; x < slice_end; x++) {
+            line_ant[x] = tmp = lowpass(line_ant[x], hline[x], spatial, depth);
+            frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+            STORE(x, tmp);
+        }
+    }
+}
+
+#define DEPTH_DISPATCH(fn, ...)                                               \
+    do {                                                                      \
+        switch (s->depth) {                                                   \
+            case  8: fn(__VA_ARGS__,  8); break;                              \
+            case  9: fn(__VA_ARGS__,  9); break;                              \
+            case 10: fn(__VA_ARGS__, 10); break;                              \
+            case 16: fn(__VA_ARGS__, 16); break;                              \
+        }                                                                     \
+    } while (0)
+
+static int spatial_h_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HQDN3DContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int slice_start = (td->h *  jobnr     ) / nb_jobs;
+    const int slice_end   = (td->h * (jobnr + 1)) / nb_jobs;
+
+    DEPTH_DISPATCH(denoise_spatial_h, s, td, slice_start, slice_end);
+    return 0;
+}
+
+static int spatial_v_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HQDN3DContext *s = ctx->priv;
+    ThreadData *td = arg;
+    /* keep the column bands of different jobs in separate cache lines */
+    const int slice_start = ((td->w *  jobnr     ) / nb_jobs) & ~31;
+    const int slice_end   = jobnr == nb_jobs - 1 ? td->w :
+                            ((td->w * (jobnr + 1)) / nb_jobs) & ~31;
+
+    DEPTH_DISPATCH(denoise_spatial_v, s, td, slice_start, slice_end);
+    return 0;
+}
+
+static int temporal_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HQDN3DContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int slice_start = (td->h *  jobnr     ) / nb_jobs;
+    const int slice_end   = (td->h * (jobnr + 1)) / nb_jobs;
+
+    DEPTH_DISPATCH(denoise_temporal,
+                   td->src + slice_start * td->sstride,
+                   td->dst + slice_start * td->dstride,
+                   td->frame_ant + slice_start * td->w,
+                   td->w, slice_end - slice_start, td->sstride, td->dstride,
+                   td->temporal);
+    return 0;
+}
+
+av_always_inline
+static int denoise_depth(AVFilterContext *ctx,
                          uint8_t *src, uint8_t *dst,
                          uint16_t *line_ant, uint16_t **frame_ant_ptr,
                          int w, int h, int sstride, int dstride,
@@ -129,6 +246,7 @@ static int denoise_depth(HQDN3DContext *s,
 {
     // FIXME: For 16-bit depth, frame_ant could be a pointer to the previous
     // filtered frame rather than a separate buffer.
+    HQDN3DContext *s = ctx->priv;
     long x, y;
     uint16_t *frame_ant = *frame_ant_ptr;
     if (!frame_ant) {
@@ -143,12 +261,29 @@ static int denoise_depth(HQDN3DContext *s,
         frame_ant = *frame_ant_ptr;
     }
 
-    if (spatial[0])
+    if (s->nb_threads > 1) {
+        ThreadData td = {
+            .src = src, .dst = dst, .frame_ant = frame_ant,
+            .w = w, .h = h, .sstride = sstride, .dstride = dstride,
+            .spatial = spatial, .temporal = temporal,
+        };
+
+        if (spatial[0]) {
+            ctx->internal->execute(ctx, spatial_h_slice, &td, NULL,
+                                   FFMIN(h, s->nb_threads));
+            ctx->internal->execute(ctx, spatial_v_slice, &td, NULL,
+                                   av_clip(w / 32, 1, s->nb_threads));
+        } else {
+            ctx->internal->execute(ctx, temporal_slice, &td, NULL,
+                                   FFMIN(h, s->nb_threads));
+        }
+    } else if (spatial[0]) {
         denoise_spatial(s, src, dst, line_ant, frame_ant,
                         w, h, sstride, dstride, spatial, temporal, depth);
-    else
+    } else {
         denoise_temporal(src, dst, frame_ant,
                          w, h, sstride, dstride, temporal, depth);
+    }
     emms_c();
     return 0;
 }
@@ -224,6 +359,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->coefs[2]);
     av_freep(&s->coefs[3]);
     av_freep(&s->line);
+    av_freep(&s->hline);
     av_freep(&s->frame_prev[0]);
     av_freep(&s->frame_prev[1]);
     av_freep(&s->frame_prev[2]);
@@ -275,6 +411,13 @@ static int config_input(AVFilterLink *inlink)
     if (!s->line)
         return AVERROR(ENOMEM);
 
+    s->nb_threads = ff_filter_get_nb_threads(inlink->dst);
+    if (s->nb_threads > 1) {
+        s->hline = av_malloc_array(inlink->w, inlink->h * sizeof(*s->hline));
+        if (!s->hline)
+            return AVERROR(ENOMEM);
+    }
+
     for (i = 0; i < 4; i++) {
         s->coefs[i] = precalc_coefs(s->strength[i], s->depth);
         if (!s->coefs[i])
@@ -309,7 +452,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
 
     for (c = 0; c < 3; c++) {
-        denoise(s, in->data[c], out->data[c],
+        denoise(ctx, in->data[c], out->data[c],
                 s->line, &s->frame_prev[c],
                 AV_CEIL_RSHIFT(in->width,  (!!c * s->hsub)),
                 AV_CEIL_RSHIFT(in->height, (!!c * s->vsub)),
@@ -370,5 +513,5 @@ AVFilter ff_vf_hqdn3d = {
     .query_formats = query_formats,
     .inputs        = avfilter_vf_hqdn3d_inputs,
     .outputs       = avfilter_vf_hqdn3d_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_SLICE_THREADS,
 };
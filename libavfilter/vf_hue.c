@@ -426,6 +426,7 @@ static const AVFilterPad hue_inputs[] = {
         .type         = AVMEDIA_TYPE_VIDEO,
         .filter_frame = filter_frame,
         .config_props = config_props,
+        .prefers_writable = 1,
     },
     { NULL }
 };
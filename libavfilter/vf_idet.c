@@ -110,39 +110,64 @@ int ff_idet_filter_line_c_16bit(const uint16_t *a, const uint16_t *b, const uint
     return ret;
 }
 
-static void filter(AVFilterContext *ctx)
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     IDETContext *idet = ctx->priv;
+    IDETSums *sums = &idet->sums[jobnr];
     int y, i;
-    int64_t alpha[2]={0};
-    int64_t delta=0;
-    int64_t gamma[2]={0};
-    Type type, best_type;
-    RepeatedField repeat;
-    int match = 0;
-    AVDictionary **metadata = avpriv_frame_get_metadatap(idet->cur);
+
+    memset(sums, 0, sizeof(*sums));
 
     for (i = 0; i < idet->csp->nb_components; i++) {
         int w = idet->cur->width;
         int h = idet->cur->height;
         int refs = idet->cur->linesize[i];
+        int slice_start, slice_end;
 
         if (i && i<3) {
             w = AV_CEIL_RSHIFT(w, idet->csp->log2_chroma_w);
             h = AV_CEIL_RSHIFT(h, idet->csp->log2_chroma_h);
         }
 
-        for (y = 2; y < h - 2; y++) {
+        slice_start = 2 + (FFMAX(h - 4, 0) *  jobnr   ) / nb_jobs;
+        slice_end   = 2 + (FFMAX(h - 4, 0) * (jobnr+1)) / nb_jobs;
+
+        for (y = slice_start; y < slice_end; y++) {
             uint8_t *prev = &idet->prev->data[i][y*refs];
             uint8_t *cur  = &idet->cur ->data[i][y*refs];
             uint8_t *next = &idet->next->data[i][y*refs];
-            alpha[ y   &1] += idet->filter_line(cur-refs, prev, cur+refs, w);
-            alpha[(y^1)&1] += idet->filter_line(cur-refs, next, cur+refs, w);
-            delta          += idet->filter_line(cur-refs,  cur, cur+refs, w);
-            gamma[(y^1)&1] += idet->filter_line(cur     , prev, cur     , w);
+            sums->alpha[ y   &1] += idet->filter_line(cur-refs, prev, cur+refs, w);
+            sums->alpha[(y^1)&1] += idet->filter_line(cur-refs, next, cur+refs, w);
+            sums->delta          += idet->filter_line(cur-refs,  cur, cur+refs, w);
+            sums->gamma[(y^1)&1] += idet->filter_line(cur     , prev, cur     , w);
         }
     }
 
+    return 0;
+}
+
+static void filter(AVFilterContext *ctx)
+{
+    IDETContext *idet = ctx->priv;
+    int i;
+    int64_t alpha[2]={0};
+    int64_t delta=0;
+    int64_t gamma[2]={0};
+    Type type, best_type;
+    RepeatedField repeat;
+    int match = 0;
+    AVDictionary **metadata = avpriv_frame_get_metadatap(idet->cur);
+
+    ctx->internal->execute(ctx, filter_slice, NULL, NULL, idet->nb_threads);
+
+    for (i = 0; i < idet->nb_threads; i++) {
+        alpha[0] += idet->sums[i].alpha[0];
+        alpha[1] += idet->sums[i].alpha[1];
+        delta    += idet->sums[i].delta;
+        gamma[0] += idet->sums[i].gamma[0];
+        gamma[1] += idet->sums[i].gamma[1];
+    }
+
     if      (alpha[0] > idet->interlace_threshold * alpha[1]){
         type = TFF;
     }else if(alpha[1] > idet->interlace_threshold * alpha[0]){
@@ -359,6 +384,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&idet->prev);
     av_frame_free(&idet->cur );
     av_frame_free(&idet->next);
+    av_freep(&idet->sums);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -421,11 +447,26 @@ static av_cold int init(AVFilterContext *ctx)
     return 0;
 }
 
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    IDETContext *idet = ctx->priv;
+
+    idet->nb_threads = ff_filter_get_nb_threads(ctx);
+    av_freep(&idet->sums);
+    idet->sums = av_calloc(idet->nb_threads, sizeof(*idet->sums));
+    if (!idet->sums)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
 static const AVFilterPad idet_inputs[] = {
     {
         .name         = "default",
         .type         = AVMEDIA_TYPE_VIDEO,
         .filter_frame = filter_frame,
+        .config_props = config_input,
     },
     { NULL }
 };
@@ -449,4 +490,5 @@ AVFilter ff_vf_idet = {
     .inputs        = idet_inputs,
     .outputs       = idet_outputs,
     .priv_class    = &idet_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -39,6 +39,12 @@ typedef enum {
     REPEAT_BOTTOM,
 } RepeatedField;
 
+typedef struct {
+    int64_t alpha[2];
+    int64_t delta;
+    int64_t gamma[2];
+} IDETSums;
+
 typedef struct {
     const AVClass *class;
     float interlace_threshold;
@@ -63,6 +69,9 @@ typedef struct {
     AVFrame *prev;
     ff_idet_filter_func filter_line;
 
+    IDETSums *sums;                 ///< per-slice statistics
+    int nb_threads;
+
     int interlaced_flag_accuracy;
     int analyze_interlaced_flag;
     int analyze_interlaced_flag_done;
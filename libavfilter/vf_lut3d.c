@@ -612,6 +612,7 @@ static const AVFilterPad lut3d_inputs[] = {
         .type         = AVMEDIA_TYPE_VIDEO,
         .filter_frame = filter_frame,
         .config_props = config_input,
+        .prefers_writable = 1,
     },
     { NULL }
 };
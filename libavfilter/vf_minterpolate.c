@@ -157,6 +157,16 @@ typedef struct Frame {
     Block *blocks;
 } Frame;
 
+typedef struct ThreadData {
+    Block *blocks;      ///< blocks searched by the motion estimation jobs
+    int dir;
+    int wave;           ///< diagonal mb_x + 2 * mb_y of a wavefront search
+    int wave_y_min;     ///< first block row crossed by the wavefront
+    int pred_x, pred_y; ///< predictor left by the search of the last block
+    int alpha;
+    AVFrame *avf_out;
+} ThreadData;
+
 typedef struct MIContext {
     const AVClass *class;
     AVMotionEstContext me_ctx;
@@ -254,20 +264,17 @@ static uint64_t get_sbad(AVMotionEstContext *me_ctx, int x, int y, int x_mv, int
     int linesize = me_ctx->linesize;
     int mv_x1 = x_mv - x;
     int mv_y1 = y_mv - y;
-    int mv_x, mv_y, i, j;
-    uint64_t sbad = 0;
+    int mv_x, mv_y;
+    uint64_t sbad;
 
     x = av_clip(x, me_ctx->x_min, me_ctx->x_max);
     y = av_clip(y, me_ctx->y_min, me_ctx->y_max);
     mv_x = av_clip(x_mv - x, -FFMIN(x - me_ctx->x_min, me_ctx->x_max - x), FFMIN(x - me_ctx->x_min, me_ctx->x_max - x));
     mv_y = av_clip(y_mv - y, -FFMIN(y - me_ctx->y_min, me_ctx->y_max - y), FFMIN(y - me_ctx->y_min, me_ctx->y_max - y));
 
-    data_cur += (y + mv_y) * linesize;
-    data_next += (y - mv_y) * linesize;
-
-    for (j = 0; j < me_ctx->mb_size; j++)
-        for (i = 0; i < me_ctx->mb_size; i++)
-            sbad += FFABS(data_cur[x + mv_x + i + j * linesize] - data_next[x - mv_x + i + j * linesize]);
+    sbad = ff_me_block_sad(me_ctx, data_cur  + x + mv_x + (y + mv_y) * linesize,
+                                   data_next + x - mv_x + (y - mv_y) * linesize,
+                           me_ctx->mb_size);
 
     return sbad + (FFABS(mv_x1 - me_ctx->pred_x) + FFABS(mv_y1 - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -283,17 +290,18 @@ static uint64_t get_sbad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv,
     int y_max = me_ctx->y_max - me_ctx->mb_size / 2;
     int mv_x1 = x_mv - x;
     int mv_y1 = y_mv - y;
-    int mv_x, mv_y, i, j;
-    uint64_t sbad = 0;
+    const int off = me_ctx->mb_size / 2;
+    int mv_x, mv_y;
+    uint64_t sbad;
 
     x = av_clip(x, x_min, x_max);
     y = av_clip(y, y_min, y_max);
     mv_x = av_clip(x_mv - x, -FFMIN(x - x_min, x_max - x), FFMIN(x - x_min, x_max - x));
     mv_y = av_clip(y_mv - y, -FFMIN(y - y_min, y_max - y), FFMIN(y - y_min, y_max - y));
 
-    for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
-        for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
-            sbad += FFABS(data_cur[x + mv_x + i + (y + mv_y + j) * linesize] - data_next[x - mv_x + i + (y - mv_y + j) * linesize]);
+    sbad = ff_me_block_sad(me_ctx, data_cur  + x + mv_x - off + (y + mv_y - off) * linesize,
+                                   data_next + x - mv_x - off + (y - mv_y - off) * linesize,
+                           me_ctx->mb_size * 3 / 2 + off);
 
     return sbad + (FFABS(mv_x1 - me_ctx->pred_x) + FFABS(mv_y1 - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -307,19 +315,19 @@ static uint64_t get_sad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv, i
     int x_max = me_ctx->x_max - me_ctx->mb_size / 2;
     int y_min = me_ctx->y_min + me_ctx->mb_size / 2;
     int y_max = me_ctx->y_max - me_ctx->mb_size / 2;
+    const int off = me_ctx->mb_size / 2;
     int mv_x = x_mv - x;
     int mv_y = y_mv - y;
-    int i, j;
-    uint64_t sad = 0;
+    uint64_t sad;
 
     x = av_clip(x, x_min, x_max);
     y = av_clip(y, y_min, y_max);
     x_mv = av_clip(x_mv, x_min, x_max);
     y_mv = av_clip(y_mv, y_min, y_max);
 
-    for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
-        for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
-            sad += FFABS(data_ref[x_mv + i + (y_mv + j) * linesize] - data_cur[x + i + (y + j) * linesize]);
+    sad = ff_me_block_sad(me_ctx, data_ref + x_mv - off + (y_mv - off) * linesize,
+                                  data_cur + x    - off + (y    - off) * linesize,
+                          me_ctx->mb_size * 3 / 2 + off);
 
     return sad + (FFABS(mv_x - me_ctx->pred_x) + FFABS(mv_y - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -402,9 +410,9 @@ static int config_output(AVFilterLink *outlink)
         preds.nb++;\
     } while(0)
 
-static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int dir)
+static void search_mv(MIContext *mi_ctx, AVMotionEstContext *me_ctx, Block *blocks,
+                      int mb_x, int mb_y, int dir)
 {
-    AVMotionEstContext *me_ctx = &mi_ctx->me_ctx;
     AVMotionEstPredictor *preds = me_ctx->preds;
     Block *block = &blocks[mb_x + mb_y * mi_ctx->b_width];
 
@@ -544,8 +552,80 @@ static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int
     block->mvs[dir][1] = mv[1] - y_mb;
 }
 
-static void bilateral_me(MIContext *mi_ctx)
+static int search_mv_rows(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    MIContext *mi_ctx = ctx->priv;
+    AVMotionEstContext me_ctx = mi_ctx->me_ctx;
+    ThreadData *td = arg;
+    const int slice_start = (mi_ctx->b_height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (mi_ctx->b_height * (jobnr+1)) / nb_jobs;
+    int mb_x, mb_y;
+
+    for (mb_y = slice_start; mb_y < slice_end; mb_y++)
+        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++)
+            search_mv(mi_ctx, &me_ctx, td->blocks, mb_x, mb_y, td->dir);
+
+    if (slice_end == mi_ctx->b_height) {
+        td->pred_x = me_ctx.pred_x;
+        td->pred_y = me_ctx.pred_y;
+    }
+
+    emms_c();
+    return 0;
+}
+
+static int search_mv_wave(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    AVMotionEstContext me_ctx = mi_ctx->me_ctx;
+    ThreadData *td = arg;
+    const int mb_y = td->wave_y_min + jobnr;
+    const int mb_x = td->wave - 2 * mb_y;
+
+    search_mv(mi_ctx, &me_ctx, td->blocks, mb_x, mb_y, td->dir);
+
+    if (mb_x == mi_ctx->b_width - 1 && mb_y == mi_ctx->b_height - 1) {
+        td->pred_x = me_ctx.pred_x;
+        td->pred_y = me_ctx.pred_y;
+    }
+
+    emms_c();
+    return 0;
+}
+
+static void search_mvs(AVFilterContext *ctx, Block *blocks, int dir)
+{
+    MIContext *mi_ctx = ctx->priv;
+    const int nb_threads = ff_filter_get_nb_threads(ctx);
+    ThreadData td = { .blocks = blocks, .dir = dir,
+                      .pred_x = mi_ctx->me_ctx.pred_x,
+                      .pred_y = mi_ctx->me_ctx.pred_y };
+
+    if ((mi_ctx->me_method == AV_ME_METHOD_EPZS ||
+         mi_ctx->me_method == AV_ME_METHOD_UMH) && nb_threads > 1) {
+        /* These predict from the left, top and top-right neighbours, which
+         * all lie on earlier diagonals mb_x + 2 * mb_y, so every diagonal
+         * can be searched in parallel. */
+        for (td.wave = 0; td.wave < mi_ctx->b_width + 2 * mi_ctx->b_height - 2; td.wave++) {
+            const int y_max = FFMIN(mi_ctx->b_height - 1, td.wave / 2);
+
+            td.wave_y_min = FFMAX(0, (td.wave - mi_ctx->b_width + 2) / 2);
+            ctx->internal->execute(ctx, search_mv_wave, &td, NULL, y_max - td.wave_y_min + 1);
+        }
+    } else {
+        ctx->internal->execute(ctx, search_mv_rows, &td, NULL,
+                               FFMIN(mi_ctx->b_height, nb_threads));
+    }
+
+    /* the jobs search on private copies of the context; later cost
+     * evaluations use the predictor left by the last block */
+    mi_ctx->me_ctx.pred_x = td.pred_x;
+    mi_ctx->me_ctx.pred_y = td.pred_y;
+}
+
+static void bilateral_me(AVFilterContext *ctx)
+{
+    MIContext *mi_ctx = ctx->priv;
     Block *block;
     int mb_x, mb_y;
 
@@ -560,9 +640,7 @@ static void bilateral_me(MIContext *mi_ctx)
             block->mvs[0][1] = 0;
         }
 
-    for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++)
-            search_mv(mi_ctx, mi_ctx->int_blocks, mb_x, mb_y, 0);
+    search_mvs(ctx, mi_ctx->int_blocks, 0);
 }
 
 static int var_size_bme(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n)
@@ -707,13 +785,17 @@ static int cluster_mvs(MIContext *mi_ctx)
                     if (block->cid != mi_ctx->int_blocks[x + y * mi_ctx->b_width].cid) {
                         if (!dx && block->cid == mi_ctx->int_blocks[x + (mb_y - dy) * mi_ctx->b_width].cid ||
                             !dy && block->cid == mi_ctx->int_blocks[(mb_x - dx) + y * mi_ctx->b_width].cid) {
-                            if (ret = var_size_bme(mi_ctx, block, mb_x << mi_ctx->log2_mb_size, mb_y << mi_ctx->log2_mb_size, mi_ctx->log2_mb_size))
+                            ret = var_size_bme(mi_ctx, block, mb_x << mi_ctx->log2_mb_size, mb_y << mi_ctx->log2_mb_size, mi_ctx->log2_mb_size);
+                            if (ret < 0) {
+                                emms_c();
                                 return ret;
+                            }
                         }
                     }
                 }
         }
 
+    emms_c();
     return 0;
 }
 
@@ -746,9 +828,7 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
                     mi_ctx->me_ctx.data_cur = mi_ctx->frames[2].avf->data[0];
                     mi_ctx->me_ctx.data_ref = mi_ctx->frames[dir ? 3 : 1].avf->data[0];
 
-                    for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-                        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++)
-                            search_mv(mi_ctx, mi_ctx->frames[2].blocks, mb_x, mb_y, dir);
+                    search_mvs(ctx, mi_ctx->frames[2].blocks, dir);
                 }
             }
 
@@ -763,7 +843,7 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
             mi_ctx->me_ctx.data_cur = mi_ctx->frames[1].avf->data[0];
             mi_ctx->me_ctx.data_ref = mi_ctx->frames[2].avf->data[0];
 
-            bilateral_me(mi_ctx);
+            bilateral_me(ctx);
 
             if (mi_ctx->mc_mode == MC_MODE_AOBMC) {
 
@@ -775,6 +855,7 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
 
                         block->sbad = get_sbad(&mi_ctx->me_ctx, x_mb, y_mb, x_mb + block->mvs[0][0], y_mb + block->mvs[0][1]);
                     }
+                emms_c();
             }
 
             if (mi_ctx->vsbmc) {
@@ -848,14 +929,14 @@ static int detect_scene_change(MIContext *mi_ctx)
         pixel->nb++;\
     } while(0)
 
-static void bidirectional_obmc(MIContext *mi_ctx, int alpha)
+static void bidirectional_obmc(MIContext *mi_ctx, int alpha, int slice_start, int slice_end)
 {
     int x, y;
     int width = mi_ctx->frames[0].avf->width;
     int height = mi_ctx->frames[0].avf->height;
     int mb_y, mb_x, dir;
 
-    for (y = 0; y < height; y++)
+    for (y = slice_start; y < slice_end; y++)
         for (x = 0; x < width; x++)
             mi_ctx->pixels[x + y * width].nb = 0;
 
@@ -872,9 +953,9 @@ static void bidirectional_obmc(MIContext *mi_ctx, int alpha)
                 start_y = (mb_y << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2 + mv_y * a / ALPHA_MAX;
 
                 startc_x = av_clip(start_x, 0, width - 1);
-                startc_y = av_clip(start_y, 0, height - 1);
+                startc_y = av_clip(start_y, slice_start, slice_end);
                 endc_x = av_clip(start_x + (2 << mi_ctx->log2_mb_size), 0, width - 1);
-                endc_y = av_clip(start_y + (2 << mi_ctx->log2_mb_size), 0, height - 1);
+                endc_y = av_clip(start_y + (2 << mi_ctx->log2_mb_size), slice_start, FFMIN(slice_end, height - 1));
 
                 if (dir) {
                     mv_x = -mv_x;
@@ -896,16 +977,16 @@ static void bidirectional_obmc(MIContext *mi_ctx, int alpha)
             }
 }
 
-static void set_frame_data(MIContext *mi_ctx, int alpha, AVFrame *avf_out)
+static void set_frame_data(MIContext *mi_ctx, int alpha, AVFrame *avf_out,
+                           int slice_start, int slice_end)
 {
     int x, y, plane;
 
     for (plane = 0; plane < mi_ctx->nb_planes; plane++) {
         int width = avf_out->width;
-        int height = avf_out->height;
         int chroma = plane == 1 || plane == 2;
 
-        for (y = 0; y < height; y++)
+        for (y = slice_start; y < slice_end; y++)
             for (x = 0; x < width; x++) {
                 int x_mv, y_mv;
                 int weight_sum = 0;
@@ -952,7 +1033,8 @@ static void set_frame_data(MIContext *mi_ctx, int alpha, AVFrame *avf_out)
     }
 }
 
-static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n, int alpha)
+static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n, int alpha,
+                         int slice_start, int slice_end)
 {
     int sb_x, sb_y;
     int width = mi_ctx->frames[0].avf->width;
@@ -963,7 +1045,8 @@ static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, in
             Block *sb = &block->subs[sb_x + sb_y * 2];
 
             if (sb->sb)
-                var_size_bmc(mi_ctx, sb, x_mb + (sb_x << (n - 1)), y_mb + (sb_y << (n - 1)), n - 1, alpha);
+                var_size_bmc(mi_ctx, sb, x_mb + (sb_x << (n - 1)), y_mb + (sb_y << (n - 1)), n - 1, alpha,
+                             slice_start, slice_end);
             else {
                 int x, y;
                 int mv_x = sb->mvs[0][0] * 2;
@@ -972,7 +1055,9 @@ static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, in
                 int start_x = x_mb + (sb_x << (n - 1));
                 int start_y = y_mb + (sb_y << (n - 1));
                 int end_x = start_x + (1 << (n - 1));
-                int end_y = start_y + (1 << (n - 1));
+                int end_y = FFMIN(start_y + (1 << (n - 1)), slice_end);
+
+                start_y = FFMAX(start_y, slice_start);
 
                 for (y = start_y; y < end_y; y++)  {
                     int y_min = -y;
@@ -989,7 +1074,8 @@ static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, in
         }
 }
 
-static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y, int alpha)
+static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y, int alpha,
+                           int slice_start, int slice_end)
 {
     int x, y;
     int width = mi_ctx->frames[0].avf->width;
@@ -1004,6 +1090,17 @@ static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y,
     int start_x, start_y;
     int startc_x, startc_y, endc_x, endc_y;
 
+    start_x = (mb_x << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2;
+    start_y = (mb_y << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2;
+
+    startc_x = av_clip(start_x, 0, width - 1);
+    startc_y = av_clip(start_y, slice_start, slice_end);
+    endc_x = av_clip(start_x + (2 << mi_ctx->log2_mb_size), 0, width - 1);
+    endc_y = av_clip(start_y + (2 << mi_ctx->log2_mb_size), slice_start, FFMIN(slice_end, height - 1));
+
+    if (startc_y >= endc_y)
+        return;
+
     if (mi_ctx->mc_mode == MC_MODE_AOBMC)
         for (nb_y = FFMAX(0, mb_y - 1); nb_y < FFMIN(mb_y + 2, mi_ctx->b_height); nb_y++)
             for (nb_x = FFMAX(0, mb_x - 1); nb_x < FFMIN(mb_x + 2, mi_ctx->b_width); nb_x++) {
@@ -1014,14 +1111,6 @@ static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y,
                     sbads[nb_x - mb_x + 1 + (nb_y - mb_y + 1) * 3] = get_sbad(&mi_ctx->me_ctx, x_nb, y_nb, x_nb + block->mvs[0][0], y_nb + block->mvs[0][1]);
             }
 
-    start_x = (mb_x << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2;
-    start_y = (mb_y << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2;
-
-    startc_x = av_clip(start_x, 0, width - 1);
-    startc_y = av_clip(start_y, 0, height - 1);
-    endc_x = av_clip(start_x + (2 << mi_ctx->log2_mb_size), 0, width - 1);
-    endc_y = av_clip(start_y + (2 << mi_ctx->log2_mb_size), 0, height - 1);
-
     for (y = startc_y; y < endc_y; y++) {
         int y_min = -y;
         int y_max = height - y - 1;
@@ -1051,6 +1140,54 @@ static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y,
     }
 }
 
+/**
+ * Motion compensate the rows of one slice. Every job walks all the blocks
+ * in the same order but only accumulates into the pixels of its own rows,
+ * so each pixel sees the same contributions as with a single thread.
+ */
+static int mci_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *avf_out = td->avf_out;
+    const int height = avf_out->height;
+    const int align = (1 << mi_ctx->log2_chroma_h) - 1;
+    const int slice_start = ((height *  jobnr   ) / nb_jobs) & ~align;
+    const int slice_end   = jobnr == nb_jobs - 1 ? height : ((height * (jobnr+1)) / nb_jobs) & ~align;
+    int x, y;
+
+    if (mi_ctx->me_mode == ME_MODE_BIDIR) {
+        bidirectional_obmc(mi_ctx, td->alpha, slice_start, slice_end);
+        emms_c();
+        set_frame_data(mi_ctx, td->alpha, avf_out, slice_start, slice_end);
+
+    } else if (mi_ctx->me_mode == ME_MODE_BILAT) {
+        int mb_x, mb_y;
+        Block *block;
+
+        for (y = slice_start; y < slice_end; y++)
+            for (x = 0; x < mi_ctx->frames[0].avf->width; x++)
+                mi_ctx->pixels[x + y * mi_ctx->frames[0].avf->width].nb = 0;
+
+        for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
+            for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
+                block = &mi_ctx->int_blocks[mb_x + mb_y * mi_ctx->b_width];
+
+                if (block->sb)
+                    var_size_bmc(mi_ctx, block, mb_x << mi_ctx->log2_mb_size, mb_y << mi_ctx->log2_mb_size, mi_ctx->log2_mb_size, td->alpha,
+                                 slice_start, slice_end);
+
+                bilateral_obmc(mi_ctx, block, mb_x, mb_y, td->alpha, slice_start, slice_end);
+
+            }
+
+        emms_c();
+        set_frame_data(mi_ctx, td->alpha, avf_out, slice_start, slice_end);
+    }
+
+    return 0;
+}
+
 static void interpolate(AVFilterLink *inlink, AVFrame *avf_out)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -1102,34 +1239,14 @@ static void interpolate(AVFilterLink *inlink, AVFrame *avf_out)
             }
 
             break;
-        case MI_MODE_MCI:
-            if (mi_ctx->me_mode == ME_MODE_BIDIR) {
-                bidirectional_obmc(mi_ctx, alpha);
-                set_frame_data(mi_ctx, alpha, avf_out);
-
-            } else if (mi_ctx->me_mode == ME_MODE_BILAT) {
-                int mb_x, mb_y;
-                Block *block;
-
-                for (y = 0; y < mi_ctx->frames[0].avf->height; y++)
-                    for (x = 0; x < mi_ctx->frames[0].avf->width; x++)
-                        mi_ctx->pixels[x + y * mi_ctx->frames[0].avf->width].nb = 0;
-
-                for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-                    for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
-                        block = &mi_ctx->int_blocks[mb_x + mb_y * mi_ctx->b_width];
-
-                        if (block->sb)
-                            var_size_bmc(mi_ctx, block, mb_x << mi_ctx->log2_mb_size, mb_y << mi_ctx->log2_mb_size, mi_ctx->log2_mb_size, alpha);
-
-                        bilateral_obmc(mi_ctx, block, mb_x, mb_y, alpha);
-
-                    }
-
-                set_frame_data(mi_ctx, alpha, avf_out);
-            }
+        case MI_MODE_MCI: {
+            ThreadData td = { .alpha = alpha, .avf_out = avf_out };
 
+            ctx->internal->execute(ctx, mci_slice, &td, NULL,
+                                   FFMIN(avf_out->height >> mi_ctx->log2_chroma_h,
+                                         ff_filter_get_nb_threads(ctx)));
             break;
+        }
     }
 }
 
@@ -1240,4 +1357,5 @@ AVFilter ff_vf_minterpolate = {
     .query_formats = query_formats,
     .inputs        = minterpolate_inputs,
     .outputs       = minterpolate_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
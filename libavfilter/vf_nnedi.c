@@ -43,8 +43,9 @@ typedef struct FrameData {
     int field[3];
 
     int32_t *lcount[3];
-    float *input;
-    float *temp;
+    float *input;      ///< nb_threads blocks of 512 floats
+    float *temp;       ///< nb_threads blocks of temp_stride floats
+    int temp_stride;
 } FrameData;
 
 typedef struct NNEDIContext {
@@ -59,6 +60,7 @@ typedef struct NNEDIContext {
     int64_t cur_pts;
 
     AVFloatDSPContext *fdsp;
+    int nb_threads;
     int nb_planes;
     int linesize[4];
     int planeheight[4];
@@ -84,8 +86,8 @@ typedef struct NNEDIContext {
     int max_value;
 
     void (*copy_pad)(const AVFrame *, FrameData *, struct NNEDIContext *, int);
-    void (*evalfunc_0)(struct NNEDIContext *, FrameData *);
-    void (*evalfunc_1)(struct NNEDIContext *, FrameData *);
+    void (*evalfunc_0)(struct NNEDIContext *, FrameData *, int, int);
+    void (*evalfunc_1)(struct NNEDIContext *, FrameData *, int, int);
 
     // Functions used in evalfunc_0
     void (*readpixels)(const uint8_t *, const int, float *);
@@ -154,6 +156,7 @@ static int config_input(AVFilterLink *inlink)
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
     int ret;
 
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
     s->nb_planes = av_pix_fmt_count_planes(inlink->format);
     if ((ret = av_image_fill_linesizes(s->linesize, inlink->format, inlink->w)) < 0)
         return ret;
@@ -415,11 +418,11 @@ static void compute_network0new(NNEDIContext *s, const float *datai, const float
     ((int *)d)[0] = mask;
 }
 
-static void evalfunc_0(NNEDIContext *s, FrameData *frame_data)
+static void evalfunc_0(NNEDIContext *s, FrameData *frame_data, int jobnr, int nb_jobs)
 {
-    float *input = frame_data->input;
+    float *input = frame_data->input + jobnr * 512;
     const float *weights0 = s->weights0;
-    float *temp = frame_data->temp;
+    float *temp = frame_data->temp + jobnr * frame_data->temp_stride;
     uint8_t *tempu = (uint8_t *)temp;
     int plane, x, y;
 
@@ -433,6 +436,8 @@ static void evalfunc_0(NNEDIContext *s, FrameData *frame_data)
 
         uint8_t *dstp = (uint8_t *)frame_data->dstp[plane];
         const int dst_stride = frame_data->dst_stride[plane] / sizeof(uint8_t);
+        const int slice_start = (height - 12) * jobnr / nb_jobs;
+        const int slice_end = (height - 12) * (jobnr + 1) / nb_jobs;
         const uint8_t *src3p;
         int ystart, ystop;
         int32_t *lcount;
@@ -440,15 +445,16 @@ static void evalfunc_0(NNEDIContext *s, FrameData *frame_data)
         if (!(s->process_plane & (1 << plane)))
             continue;
 
-        for (y = 1 - frame_data->field[plane]; y < height - 12; y += 2) {
+        // Lines of the kept field are copied, the others are interpolated.
+        for (y = slice_start + ((slice_start + frame_data->field[plane] + 1) & 1); y < slice_end; y += 2) {
             memcpy(dstp + y * dst_stride,
                    srcp + 32 + (6 + y) * src_stride,
                    (width - 64) * sizeof(uint8_t));
 
         }
 
-        ystart = 6 + frame_data->field[plane];
-        ystop = height - 6;
+        ystart = 6 + slice_start + ((slice_start + frame_data->field[plane]) & 1);
+        ystop = 6 + slice_end;
         srcp += ystart * src_stride;
         dstp += (ystart - 6) * dst_stride - 32;
         src3p = srcp - src_stride * 3;
@@ -575,10 +581,10 @@ static void weighted_avg_elliott_mul5_m16(const float *w, const int n, float *ms
 }
 
 
-static void evalfunc_1(NNEDIContext *s, FrameData *frame_data)
+static void evalfunc_1(NNEDIContext *s, FrameData *frame_data, int jobnr, int nb_jobs)
 {
-    float *input = frame_data->input;
-    float *temp = frame_data->temp;
+    float *input = frame_data->input + jobnr * 512;
+    float *temp = frame_data->temp + jobnr * frame_data->temp_stride;
     float **weights1 = s->weights1;
     const int qual = s->qual;
     const int asize = s->asize;
@@ -599,8 +605,9 @@ static void evalfunc_1(NNEDIContext *s, FrameData *frame_data)
         uint8_t *dstp = (uint8_t *)frame_data->dstp[plane];
         const int dst_stride = frame_data->dst_stride[plane] / sizeof(uint8_t);
 
-        const int ystart = frame_data->field[plane];
-        const int ystop = height - 12;
+        const int slice_start = (height - 12) * jobnr / nb_jobs;
+        const int ystart = slice_start + ((slice_start + frame_data->field[plane]) & 1);
+        const int ystop = (height - 12) * (jobnr + 1) / nb_jobs;
         const uint8_t *srcpp;
 
         if (!(s->process_plane & (1 << plane)))
@@ -686,6 +693,20 @@ static int modnpf(const int m, const int n)
     return m + n - (m % n);
 }
 
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    NNEDIContext *s = ctx->priv;
+    FrameData *frame_data = arg;
+
+    // Handles prescreening and the cubic interpolation.
+    s->evalfunc_0(s, frame_data, jobnr, nb_jobs);
+
+    // The rest.
+    s->evalfunc_1(s, frame_data, jobnr, nb_jobs);
+
+    return 0;
+}
+
 static int get_frame(AVFilterContext *ctx, int is_second)
 {
     NNEDIContext *s = ctx->priv;
@@ -766,7 +787,7 @@ static int get_frame(AVFilterContext *ctx, int is_second)
     }
 
     if (!frame_data->input) {
-        frame_data->input = av_malloc(512 * sizeof(float));
+        frame_data->input = av_malloc_array(s->nb_threads, 512 * sizeof(float));
         if (!frame_data->input)
             return AVERROR(ENOMEM);
     }
@@ -774,7 +795,8 @@ static int get_frame(AVFilterContext *ctx, int is_second)
     // evalfunc_1 requires at least 512 floats.
     if (!frame_data->temp) {
         temp_size = FFMAX(frame_data->padded_width[0], 512 * sizeof(float));
-        frame_data->temp = av_malloc(temp_size);
+        frame_data->temp_stride = FFALIGN(temp_size, 64) / sizeof(float);
+        frame_data->temp = av_malloc_array(s->nb_threads, frame_data->temp_stride * sizeof(float));
         if (!frame_data->temp)
             return AVERROR(ENOMEM);
     }
@@ -782,11 +804,8 @@ static int get_frame(AVFilterContext *ctx, int is_second)
     // Copy src to a padded "frame" in frame_data and mirror the edges.
     s->copy_pad(src, frame_data, s, field_n);
 
-    // Handles prescreening and the cubic interpolation.
-    s->evalfunc_0(s, frame_data);
-
-    // The rest.
-    s->evalfunc_1(s, frame_data);
+    ctx->internal->execute(ctx, filter_slice, frame_data, NULL,
+                           FFMIN(s->planeheight[1], s->nb_threads));
 
     return 0;
 }
@@ -1207,5 +1226,5 @@ AVFilter ff_vf_nnedi = {
     .query_formats = query_formats,
     .inputs        = inputs,
     .outputs       = outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_SLICE_THREADS,
 };
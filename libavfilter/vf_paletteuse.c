@@ -29,6 +29,7 @@
 #include "libavutil/qsort.h"
 #include "dualinput.h"
 #include "avfilter.h"
+#include "internal.h"
 
 enum dithering_mode {
     DITHERING_NONE,
@@ -44,6 +45,7 @@ enum color_search_method {
     COLOR_SEARCH_NNS_ITERATIVE,
     COLOR_SEARCH_NNS_RECURSIVE,
     COLOR_SEARCH_BRUTEFORCE,
+    COLOR_SEARCH_LUT,           ///< internal, selected by lut_bits
     NB_COLOR_SEARCHES
 };
 
@@ -76,12 +78,18 @@ struct cache_node {
 struct PaletteUseContext;
 
 typedef int (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
-                              int x_start, int y_start, int width, int height);
+                              int x_start, int y_start, int width, int height,
+                              struct cache_node *cache);
 
 typedef struct PaletteUseContext {
     const AVClass *class;
     FFDualInputContext dinput;
     struct cache_node cache[CACHE_SIZE];    /* lookup cache */
+    struct cache_node *thread_caches;       /* lookup caches of the slice threads beyond the first one */
+    int nb_threads;
+    int *jobs_ret;
+    int lut_bits;
+    uint8_t *lut;                           /* 3D lookup table of lut_bits per component */
     struct color_node map[AVPALETTE_COUNT]; /* 3D-Tree (KD-Tree with K=3) for reverse colormap */
     uint32_t palette[AVPALETTE_COUNT];
     int palette_loaded;
@@ -117,13 +125,14 @@ static const AVOption paletteuse_options[] = {
 
     /* following are the debug options, not part of the official API */
     { "debug_kdtree", "save Graphviz graph of the kdtree in specified file", OFFSET(dot_filename), AV_OPT_TYPE_STRING, {.str=NULL}, CHAR_MIN, CHAR_MAX, FLAGS },
-    { "color_search", "set reverse colormap color search method", OFFSET(color_search_method), AV_OPT_TYPE_INT, {.i64=COLOR_SEARCH_NNS_ITERATIVE}, 0, NB_COLOR_SEARCHES-1, FLAGS, "search" },
+    { "color_search", "set reverse colormap color search method", OFFSET(color_search_method), AV_OPT_TYPE_INT, {.i64=COLOR_SEARCH_NNS_ITERATIVE}, 0, COLOR_SEARCH_BRUTEFORCE, FLAGS, "search" },
         { "nns_iterative", "iterative search",             0, AV_OPT_TYPE_CONST, {.i64=COLOR_SEARCH_NNS_ITERATIVE}, INT_MIN, INT_MAX, FLAGS, "search" },
         { "nns_recursive", "recursive search",             0, AV_OPT_TYPE_CONST, {.i64=COLOR_SEARCH_NNS_RECURSIVE}, INT_MIN, INT_MAX, FLAGS, "search" },
         { "bruteforce",    "brute-force into the palette", 0, AV_OPT_TYPE_CONST, {.i64=COLOR_SEARCH_BRUTEFORCE},    INT_MIN, INT_MAX, FLAGS, "search" },
     { "mean_err", "compute and print mean error", OFFSET(calc_mean_err), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS },
     { "debug_accuracy", "test color search accuracy", OFFSET(debug_accuracy), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS },
     { "new", "take new palette for each output frame", OFFSET(new), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS },
+    { "lut_bits", "use a lookup table with the given number of bits per component (approximate)", OFFSET(lut_bits), AV_OPT_TYPE_INT, {.i64=0}, 0, 6, FLAGS },
     { NULL }
 };
 
@@ -183,6 +192,8 @@ static av_always_inline uint8_t colormap_nearest_bruteforce(const uint32_t *pale
             const int d = diff(palrgb, rgb);
             if (d < min_dist) {
                 pal_id = i;
+                if (!d)
+                    break; // exact match, nothing later can be closer
                 min_dist = d;
             }
         }
@@ -321,13 +332,14 @@ end:
  * Note: r, g, and b are the component of c but are passed as well to avoid
  * recomputing them (they are generally computed by the caller for other uses).
  */
-static av_always_inline int color_get(struct cache_node *cache, uint32_t color,
+static av_always_inline int color_get(const PaletteUseContext *s,
+                                      struct cache_node *cache, uint32_t color,
                                       uint8_t r, uint8_t g, uint8_t b,
-                                      const struct color_node *map,
-                                      const uint32_t *palette,
                                       const enum color_search_method search_method)
 {
     int i;
+    const struct color_node *map = s->map;
+    const uint32_t *palette = s->palette;
     const uint8_t rgb[] = {r, g, b};
     const uint8_t rhash = r & ((1<<NBITS)-1);
     const uint8_t ghash = g & ((1<<NBITS)-1);
@@ -336,6 +348,12 @@ static av_always_inline int color_get(struct cache_node *cache, uint32_t color,
     struct cache_node *node = &cache[hash];
     struct cached_color *e;
 
+    if (search_method == COLOR_SEARCH_LUT) {
+        const int bits  = s->lut_bits;
+        const int shift = 8 - bits;
+        return s->lut[(r >> shift) << (2*bits) | (g >> shift) << bits | b >> shift];
+    }
+
     for (i = 0; i < node->nb_entries; i++) {
         e = &node->entries[i];
         if (e->color == color)
@@ -351,17 +369,16 @@ static av_always_inline int color_get(struct cache_node *cache, uint32_t color,
     return e->pal_entry;
 }
 
-static av_always_inline int get_dst_color_err(struct cache_node *cache,
-                                              uint32_t c, const struct color_node *map,
-                                              const uint32_t *palette,
+static av_always_inline int get_dst_color_err(const PaletteUseContext *s,
+                                              struct cache_node *cache, uint32_t c,
                                               int *er, int *eg, int *eb,
                                               const enum color_search_method search_method)
 {
     const uint8_t r = c >> 16 & 0xff;
     const uint8_t g = c >>  8 & 0xff;
     const uint8_t b = c       & 0xff;
-    const int dstx = color_get(cache, c, r, g, b, map, palette, search_method);
-    const uint32_t dstc = palette[dstx];
+    const int dstx = color_get(s, cache, c, r, g, b, search_method);
+    const uint32_t dstc = s->palette[dstx];
     *er = r - (dstc >> 16 & 0xff);
     *eg = g - (dstc >>  8 & 0xff);
     *eb = b - (dstc       & 0xff);
@@ -370,13 +387,11 @@ static av_always_inline int get_dst_color_err(struct cache_node *cache,
 
 static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
                                       int x_start, int y_start, int w, int h,
+                                      struct cache_node *cache,
                                       enum dithering_mode dither,
                                       const enum color_search_method search_method)
 {
     int x, y;
-    const struct color_node *map = s->map;
-    struct cache_node *cache = s->cache;
-    const uint32_t *palette = s->palette;
     const int src_linesize = in ->linesize[0] >> 2;
     const int dst_linesize = out->linesize[0];
     uint32_t *src = ((uint32_t *)in ->data[0]) + y_start*src_linesize;
@@ -398,7 +413,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t g = av_clip_uint8(g8 + d);
                 const uint8_t b = av_clip_uint8(b8 + d);
                 const uint32_t c = r<<16 | g<<8 | b;
-                const int color = color_get(cache, c, r, g, b, map, palette, search_method);
+                const int color = color_get(s, cache, c, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
@@ -406,7 +421,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_HECKBERT) {
                 const int right = x < w - 1, down = y < h - 1;
-                const int color = get_dst_color_err(cache, src[x], map, palette, &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -418,7 +433,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_FLOYD_STEINBERG) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(cache, src[x], map, palette, &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -432,7 +447,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA2) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(cache, src[x], map, palette, &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -451,7 +466,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_SIERRA2_4A) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(cache, src[x], map, palette, &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -465,7 +480,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t r = src[x] >> 16 & 0xff;
                 const uint8_t g = src[x] >>  8 & 0xff;
                 const uint8_t b = src[x]       & 0xff;
-                const int color = color_get(cache, src[x] & 0xffffff, r, g, b, map, palette, search_method);
+                const int color = color_get(s, cache, src[x] & 0xffffff, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
@@ -853,12 +868,31 @@ static void set_processing_window(enum diff_mode diff_mode,
     *hp = height;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int x, y, w, h;
+} ThreadData;
+
+static int set_frame_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int slice_start = td->y + (td->h *  jobnr     ) / nb_jobs;
+    const int slice_end   = td->y + (td->h * (jobnr + 1)) / nb_jobs;
+    struct cache_node *cache = jobnr ? s->thread_caches + (jobnr - 1) * CACHE_SIZE
+                                     : s->cache;
+
+    return s->set_frame(s, td->out, td->in, td->x, slice_start,
+                        td->w, slice_end - slice_start, cache);
+}
+
 static AVFrame *apply_palette(AVFilterLink *inlink, AVFrame *in)
 {
-    int x, y, w, h;
+    int i, x, y, w, h, nb_jobs = 1;
     AVFilterContext *ctx = inlink->dst;
     PaletteUseContext *s = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
+    ThreadData td;
 
     AVFrame *out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
     if (!out) {
@@ -883,9 +917,22 @@ static AVFrame *apply_palette(AVFilterLink *inlink, AVFrame *in)
     ff_dlog(ctx, "%dx%d rect: (%d;%d) -> (%d,%d) [area:%dx%d]\n",
             w, h, x, y, x+w, y+h, in->width, in->height);
 
-    if (s->set_frame(s, out, in, x, y, w, h) < 0) {
-        av_frame_free(&out);
-        return NULL;
+    /* error diffusion carries state from one line to the next */
+    if (s->dither == DITHERING_NONE || s->dither == DITHERING_BAYER)
+        nb_jobs = FFMAX(1, FFMIN(h, s->nb_threads));
+
+    td.in  = in;
+    td.out = out;
+    td.x   = x;
+    td.y   = y;
+    td.w   = w;
+    td.h   = h;
+    ctx->internal->execute(ctx, set_frame_slice, &td, s->jobs_ret, nb_jobs);
+    for (i = 0; i < nb_jobs; i++) {
+        if (s->jobs_ret[i] < 0) {
+            av_frame_free(&out);
+            return NULL;
+        }
     }
     memcpy(out->data[1], s->palette, AVPALETTE_SIZE);
     if (s->calc_mean_err)
@@ -894,6 +941,20 @@ static AVFrame *apply_palette(AVFilterLink *inlink, AVFrame *in)
     return out;
 }
 
+static void free_caches(PaletteUseContext *s)
+{
+    int i;
+
+    for (i = 0; i < CACHE_SIZE; i++)
+        av_freep(&s->cache[i].entries);
+    memset(s->cache, 0, sizeof(s->cache));
+    if (s->thread_caches) {
+        for (i = 0; i < (s->nb_threads - 1) * CACHE_SIZE; i++)
+            av_freep(&s->thread_caches[i].entries);
+        memset(s->thread_caches, 0, (s->nb_threads - 1) * CACHE_SIZE * sizeof(*s->thread_caches));
+    }
+}
+
 static int config_output(AVFilterLink *outlink)
 {
     int ret;
@@ -906,6 +967,22 @@ static int config_output(AVFilterLink *outlink)
     outlink->time_base = ctx->inputs[0]->time_base;
     if ((ret = ff_dualinput_init(ctx, &s->dinput)) < 0)
         return ret;
+
+    /* the link may be reconfigured, with a different number of threads */
+    free_caches(s);
+    av_freep(&s->thread_caches);
+    av_freep(&s->jobs_ret);
+
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    s->jobs_ret = av_malloc_array(s->nb_threads, sizeof(*s->jobs_ret));
+    if (!s->jobs_ret)
+        return AVERROR(ENOMEM);
+    if (s->nb_threads > 1) {
+        s->thread_caches = av_mallocz_array((s->nb_threads - 1) * CACHE_SIZE,
+                                            sizeof(*s->thread_caches));
+        if (!s->thread_caches)
+            return AVERROR(ENOMEM);
+    }
     return 0;
 }
 
@@ -924,6 +1001,29 @@ static int config_input_palette(AVFilterLink *inlink)
     return 0;
 }
 
+/* Every LUT entry maps the center of its bin to the nearest palette color. */
+static int build_lut_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    const int bits  = s->lut_bits;
+    const int shift = 8 - bits;
+    const int bias  = 1 << shift >> 1;
+    const int slice_start = ((1 << bits) *  jobnr     ) / nb_jobs;
+    const int slice_end   = ((1 << bits) * (jobnr + 1)) / nb_jobs;
+    int r, g, b;
+
+    for (r = slice_start; r < slice_end; r++) {
+        for (g = 0; g < 1 << bits; g++) {
+            for (b = 0; b < 1 << bits; b++) {
+                const uint8_t rgb[] = { r << shift | bias, g << shift | bias, b << shift | bias };
+                s->lut[r << (2*bits) | g << bits | b] =
+                    COLORMAP_NEAREST(s->color_search_method, s->palette, s->map, rgb);
+            }
+        }
+    }
+    return 0;
+}
+
 static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
 {
     int i, x, y;
@@ -933,9 +1033,7 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
     if (s->new) {
         memset(s->palette, 0, sizeof(s->palette));
         memset(s->map, 0, sizeof(s->map));
-        for (i = 0; i < CACHE_SIZE; i++)
-            av_freep(&s->cache[i].entries);
-        memset(s->cache, 0, sizeof(s->cache));
+        free_caches(s);
     }
 
     i = 0;
@@ -958,6 +1056,9 @@ static AVFrame *load_apply_palette(AVFilterContext *ctx, AVFrame *main,
     PaletteUseContext *s = ctx->priv;
     if (!s->palette_loaded) {
         load_palette(s, second);
+        if (s->lut)
+            ctx->internal->execute(ctx, build_lut_slice, NULL, NULL,
+                                   FFMIN(1 << s->lut_bits, s->nb_threads));
     }
     return apply_palette(inlink, main);
 }
@@ -970,9 +1071,11 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 
 #define DEFINE_SET_FRAME(color_search, name, value)                             \
 static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,    \
-                            int x_start, int y_start, int w, int h)             \
+                            int x_start, int y_start, int w, int h,             \
+                            struct cache_node *cache)                           \
 {                                                                               \
-    return set_frame(s, out, in, x_start, y_start, w, h, value, color_search);  \
+    return set_frame(s, out, in, x_start, y_start, w, h, cache,                 \
+                     value, color_search);                                      \
 }
 
 #define DEFINE_SET_FRAME_COLOR_SEARCH(color_search, color_search_macro)                                 \
@@ -986,6 +1089,7 @@ static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,
 DEFINE_SET_FRAME_COLOR_SEARCH(nns_iterative, COLOR_SEARCH_NNS_ITERATIVE)
 DEFINE_SET_FRAME_COLOR_SEARCH(nns_recursive, COLOR_SEARCH_NNS_RECURSIVE)
 DEFINE_SET_FRAME_COLOR_SEARCH(bruteforce,    COLOR_SEARCH_BRUTEFORCE)
+DEFINE_SET_FRAME_COLOR_SEARCH(lut,           COLOR_SEARCH_LUT)
 
 #define DITHERING_ENTRIES(color_search) {       \
     set_frame_##color_search##_none,            \
@@ -1000,6 +1104,7 @@ static const set_frame_func set_frame_lut[NB_COLOR_SEARCHES][NB_DITHERING] = {
     DITHERING_ENTRIES(nns_iterative),
     DITHERING_ENTRIES(nns_recursive),
     DITHERING_ENTRIES(bruteforce),
+    DITHERING_ENTRIES(lut),
 };
 
 static int dither_value(int p)
@@ -1017,7 +1122,13 @@ static av_cold int init(AVFilterContext *ctx)
     s->dinput.skip_initial_unpaired = 1;
     s->dinput.process    = load_apply_palette;
 
-    s->set_frame = set_frame_lut[s->color_search_method][s->dither];
+    s->set_frame = set_frame_lut[s->lut_bits ? COLOR_SEARCH_LUT : s->color_search_method][s->dither];
+
+    if (s->lut_bits) {
+        s->lut = av_malloc(1 << (3 * s->lut_bits));
+        if (!s->lut)
+            return AVERROR(ENOMEM);
+    }
 
     if (s->dither == DITHERING_BAYER) {
         int i;
@@ -1038,12 +1149,13 @@ static int request_frame(AVFilterLink *outlink)
 
 static av_cold void uninit(AVFilterContext *ctx)
 {
-    int i;
     PaletteUseContext *s = ctx->priv;
 
     ff_dualinput_uninit(&s->dinput);
-    for (i = 0; i < CACHE_SIZE; i++)
-        av_freep(&s->cache[i].entries);
+    free_caches(s);
+    av_freep(&s->thread_caches);
+    av_freep(&s->jobs_ret);
+    av_freep(&s->lut);
     av_frame_free(&s->last_in);
     av_frame_free(&s->last_out);
 }
@@ -1083,4 +1195,5 @@ AVFilter ff_vf_paletteuse = {
     .inputs        = paletteuse_inputs,
     .outputs       = paletteuse_outputs,
     .priv_class    = &paletteuse_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
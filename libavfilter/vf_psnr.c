@@ -25,12 +25,9 @@
  * Caculate the PSNR between two input videos.
  */
 
-#include "libavutil/avstring.h"
 #include "libavutil/opt.h"
-#include "libavutil/pixdesc.h"
 #include "avfilter.h"
 #include "dualinput.h"
-#include "drawutils.h"
 #include "formats.h"
 #include "internal.h"
 #include "psnr.h"
@@ -39,22 +36,14 @@
 typedef struct PSNRContext {
     const AVClass *class;
     FFDualInputContext dinput;
-    double mse, min_mse, max_mse, mse_comp[4];
-    uint64_t nb_frames;
+    PSNRMetrics m;
     FILE *stats_file;
     char *stats_file_str;
     int stats_version;
     int stats_header_written;
     int stats_add_max;
-    int max[4], average_max;
-    int is_rgb;
-    uint8_t rgba_map[4];
-    char comps[4];
-    int nb_components;
-    int planewidth[4];
-    int planeheight[4];
-    double planeweight[4];
-    PSNRDSPContext dsp;
+    uint64_t **score;
+    int nb_threads;
 } PSNRContext;
 
 #define OFFSET(x) offsetof(PSNRContext, x)
@@ -70,145 +59,83 @@ static const AVOption psnr_options[] = {
 
 AVFILTER_DEFINE_CLASS(psnr);
 
-static inline unsigned pow2(unsigned base)
-{
-    return base*base;
-}
-
-static inline double get_psnr(double mse, uint64_t nb_frames, int max)
-{
-    return 10.0 * log10(pow2(max) / (mse / nb_frames));
-}
-
-static uint64_t sse_line_8bit(const uint8_t *main_line,  const uint8_t *ref_line, int outw)
-{
-    int j;
-    unsigned m2 = 0;
-
-    for (j = 0; j < outw; j++)
-        m2 += pow2(main_line[j] - ref_line[j]);
+typedef struct ThreadData {
+    const AVFrame *main, *ref;
+    uint64_t **score;
+    PSNRMetrics *m;
+} ThreadData;
 
-    return m2;
-}
-
-static uint64_t sse_line_16bit(const uint8_t *_main_line, const uint8_t *_ref_line, int outw)
+static int compute_images_mse(AVFilterContext *ctx, void *arg,
+                              int jobnr, int nb_jobs)
 {
-    int j;
-    uint64_t m2 = 0;
-    const uint16_t *main_line = (const uint16_t *) _main_line;
-    const uint16_t *ref_line = (const uint16_t *) _ref_line;
-
-    for (j = 0; j < outw; j++)
-        m2 += pow2(main_line[j] - ref_line[j]);
-
-    return m2;
-}
-
-static inline
-void compute_images_mse(PSNRContext *s,
-                        const uint8_t *main_data[4], const int main_linesizes[4],
-                        const uint8_t *ref_data[4], const int ref_linesizes[4],
-                        int w, int h, double mse[4])
-{
-    int i, c;
-
-    for (c = 0; c < s->nb_components; c++) {
-        const int outw = s->planewidth[c];
-        const int outh = s->planeheight[c];
-        const uint8_t *main_line = main_data[c];
-        const uint8_t *ref_line = ref_data[c];
-        const int ref_linesize = ref_linesizes[c];
-        const int main_linesize = main_linesizes[c];
-        uint64_t m = 0;
-        for (i = 0; i < outh; i++) {
-            m += s->dsp.sse_line(main_line, ref_line, outw);
-            ref_line += ref_linesize;
-            main_line += main_linesize;
-        }
-        mse[c] = m / (double)(outw * outh);
+    ThreadData *td = arg;
+    PSNRMetrics *m = td->m;
+    uint64_t *score = td->score[jobnr];
+    int c;
+
+    for (c = 0; c < m->nb_components; c++) {
+        const int outh = m->planeheight[c];
+        const int slice_start = (outh * jobnr) / nb_jobs;
+        const int slice_end = (outh * (jobnr+1)) / nb_jobs;
+
+        score[c] = ff_psnr_metrics_sse(m, td->main, td->ref, c,
+                                       slice_start, slice_end);
     }
-}
 
-static void set_meta(AVDictionary **metadata, const char *key, char comp, float d)
-{
-    char value[128];
-    snprintf(value, sizeof(value), "%0.2f", d);
-    if (comp) {
-        char key2[128];
-        snprintf(key2, sizeof(key2), "%s%c", key, comp);
-        av_dict_set(metadata, key2, value, 0);
-    } else {
-        av_dict_set(metadata, key, value, 0);
-    }
+    return 0;
 }
 
 static AVFrame *do_psnr(AVFilterContext *ctx, AVFrame *main,
                         const AVFrame *ref)
 {
     PSNRContext *s = ctx->priv;
-    double comp_mse[4], mse = 0;
-    int j, c;
+    PSNRMetrics *m = &s->m;
+    uint64_t sse[4] = { 0 };
+    int i, j, c, nb_jobs;
     AVDictionary **metadata = avpriv_frame_get_metadatap(main);
+    ThreadData td;
 
-    compute_images_mse(s, (const uint8_t **)main->data, main->linesize,
-                          (const uint8_t **)ref->data, ref->linesize,
-                          main->width, main->height, comp_mse);
+    td.main = main;
+    td.ref = ref;
+    td.score = s->score;
+    td.m = m;
 
-    for (j = 0; j < s->nb_components; j++)
-        mse += comp_mse[j] * s->planeweight[j];
+    nb_jobs = FFMIN(m->planeheight[1], s->nb_threads);
+    ctx->internal->execute(ctx, compute_images_mse, &td, NULL, nb_jobs);
 
-    s->min_mse = FFMIN(s->min_mse, mse);
-    s->max_mse = FFMAX(s->max_mse, mse);
+    for (c = 0; c < m->nb_components; c++)
+        for (i = 0; i < nb_jobs; i++)
+            sse[c] += s->score[i][c];
 
-    s->mse += mse;
-    for (j = 0; j < s->nb_components; j++)
-        s->mse_comp[j] += comp_mse[j];
-    s->nb_frames++;
-
-    for (j = 0; j < s->nb_components; j++) {
-        c = s->is_rgb ? s->rgba_map[j] : j;
-        set_meta(metadata, "lavfi.psnr.mse.", s->comps[j], comp_mse[c]);
-        set_meta(metadata, "lavfi.psnr.psnr.", s->comps[j], get_psnr(comp_mse[c], 1, s->max[c]));
-    }
-    set_meta(metadata, "lavfi.psnr.mse_avg", 0, mse);
-    set_meta(metadata, "lavfi.psnr.psnr_avg", 0, get_psnr(mse, 1, s->average_max));
+    ff_psnr_metrics_frame(m, sse, metadata);
 
     if (s->stats_file) {
         if (s->stats_version == 2 && !s->stats_header_written) {
             fprintf(s->stats_file, "psnr_log_version:2 fields:n");
             fprintf(s->stats_file, ",mse_avg");
-            for (j = 0; j < s->nb_components; j++) {
-                fprintf(s->stats_file, ",mse_%c", s->comps[j]);
+            for (j = 0; j < m->nb_components; j++) {
+                fprintf(s->stats_file, ",mse_%c", m->comps[j]);
             }
             fprintf(s->stats_file, ",psnr_avg");
-            for (j = 0; j < s->nb_components; j++) {
-                fprintf(s->stats_file, ",psnr_%c", s->comps[j]);
+            for (j = 0; j < m->nb_components; j++) {
+                fprintf(s->stats_file, ",psnr_%c", m->comps[j]);
             }
             if (s->stats_add_max) {
                 fprintf(s->stats_file, ",max_avg");
-                for (j = 0; j < s->nb_components; j++) {
-                    fprintf(s->stats_file, ",max_%c", s->comps[j]);
+                for (j = 0; j < m->nb_components; j++) {
+                    fprintf(s->stats_file, ",max_%c", m->comps[j]);
                 }
             }
             fprintf(s->stats_file, "\n");
             s->stats_header_written = 1;
         }
-        fprintf(s->stats_file, "n:%"PRId64" mse_avg:%0.2f ", s->nb_frames, mse);
-        for (j = 0; j < s->nb_components; j++) {
-            c = s->is_rgb ? s->rgba_map[j] : j;
-            fprintf(s->stats_file, "mse_%c:%0.2f ", s->comps[j], comp_mse[c]);
-        }
-        fprintf(s->stats_file, "psnr_avg:%0.2f ", get_psnr(mse, 1, s->average_max));
-        for (j = 0; j < s->nb_components; j++) {
-            c = s->is_rgb ? s->rgba_map[j] : j;
-            fprintf(s->stats_file, "psnr_%c:%0.2f ", s->comps[j],
-                    get_psnr(comp_mse[c], 1, s->max[c]));
-        }
+        fprintf(s->stats_file, "n:%"PRId64" ", m->nb_frames);
+        ff_psnr_metrics_print(m, s->stats_file);
         if (s->stats_version == 2 && s->stats_add_max) {
-            fprintf(s->stats_file, "max_avg:%d ", s->average_max);
-            for (j = 0; j < s->nb_components; j++) {
-                c = s->is_rgb ? s->rgba_map[j] : j;
-                fprintf(s->stats_file, "max_%c:%d ", s->comps[j], s->max[c]);
+            fprintf(s->stats_file, "max_avg:%d ", m->average_max);
+            for (j = 0; j < m->nb_components; j++) {
+                c = m->is_rgb ? m->rgba_map[j] : j;
+                fprintf(s->stats_file, "max_%c:%d ", m->comps[j], m->max[c]);
             }
         }
         fprintf(s->stats_file, "\n");
@@ -221,9 +148,6 @@ static av_cold int init(AVFilterContext *ctx)
 {
     PSNRContext *s = ctx->priv;
 
-    s->min_mse = +INFINITY;
-    s->max_mse = -INFINITY;
-
     if (s->stats_file_str) {
         if (s->stats_version < 2 && s->stats_add_max) {
             av_log(ctx, AV_LOG_ERROR,
@@ -274,14 +198,10 @@ static int query_formats(AVFilterContext *ctx)
 
 static int config_input_ref(AVFilterLink *inlink)
 {
-    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
     AVFilterContext *ctx  = inlink->dst;
     PSNRContext *s = ctx->priv;
-    double average_max;
-    unsigned sum;
     int j;
 
-    s->nb_components = desc->nb_components;
     if (ctx->inputs[0]->w != ctx->inputs[1]->w ||
         ctx->inputs[0]->h != ctx->inputs[1]->h) {
         av_log(ctx, AV_LOG_ERROR, "Width and height of input videos must be same.\n");
@@ -292,34 +212,18 @@ static int config_input_ref(AVFilterLink *inlink)
         return AVERROR(EINVAL);
     }
 
-    s->max[0] = (1 << desc->comp[0].depth) - 1;
-    s->max[1] = (1 << desc->comp[1].depth) - 1;
-    s->max[2] = (1 << desc->comp[2].depth) - 1;
-    s->max[3] = (1 << desc->comp[3].depth) - 1;
-
-    s->is_rgb = ff_fill_rgba_map(s->rgba_map, inlink->format) >= 0;
-    s->comps[0] = s->is_rgb ? 'r' : 'y' ;
-    s->comps[1] = s->is_rgb ? 'g' : 'u' ;
-    s->comps[2] = s->is_rgb ? 'b' : 'v' ;
-    s->comps[3] = 'a';
-
-    s->planeheight[1] = s->planeheight[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
-    s->planeheight[0] = s->planeheight[3] = inlink->h;
-    s->planewidth[1]  = s->planewidth[2]  = AV_CEIL_RSHIFT(inlink->w, desc->log2_chroma_w);
-    s->planewidth[0]  = s->planewidth[3]  = inlink->w;
-    sum = 0;
-    for (j = 0; j < s->nb_components; j++)
-        sum += s->planeheight[j] * s->planewidth[j];
-    average_max = 0;
-    for (j = 0; j < s->nb_components; j++) {
-        s->planeweight[j] = (double) s->planeheight[j] * s->planewidth[j] / sum;
-        average_max += s->max[j] * s->planeweight[j];
-    }
-    s->average_max = lrint(average_max);
+    ff_psnr_metrics_config(&s->m, inlink);
 
-    s->dsp.sse_line = desc->comp[0].depth > 8 ? sse_line_16bit : sse_line_8bit;
-    if (ARCH_X86)
-        ff_psnr_init_x86(&s->dsp, desc->comp[0].depth);
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    s->score = av_calloc(s->nb_threads, sizeof(*s->score));
+    if (!s->score)
+        return AVERROR(ENOMEM);
+
+    for (j = 0; j < s->nb_threads; j++) {
+        s->score[j] = av_calloc(s->m.nb_components, sizeof(**s->score));
+        if (!s->score[j])
+            return AVERROR(ENOMEM);
+    }
 
     return 0;
 }
@@ -357,28 +261,18 @@ static int request_frame(AVFilterLink *outlink)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     PSNRContext *s = ctx->priv;
+    int j;
 
-    if (s->nb_frames > 0) {
-        int j;
-        char buf[256];
-
-        buf[0] = 0;
-        for (j = 0; j < s->nb_components; j++) {
-            int c = s->is_rgb ? s->rgba_map[j] : j;
-            av_strlcatf(buf, sizeof(buf), " %c:%f", s->comps[j],
-                        get_psnr(s->mse_comp[c], s->nb_frames, s->max[c]));
-        }
-        av_log(ctx, AV_LOG_INFO, "PSNR%s average:%f min:%f max:%f\n",
-               buf,
-               get_psnr(s->mse, s->nb_frames, s->average_max),
-               get_psnr(s->max_mse, 1, s->average_max),
-               get_psnr(s->min_mse, 1, s->average_max));
-    }
+    ff_psnr_metrics_log(ctx, &s->m);
 
     ff_dualinput_uninit(&s->dinput);
 
     if (s->stats_file && s->stats_file != stdout)
         fclose(s->stats_file);
+
+    for (j = 0; j < s->nb_threads && s->score; j++)
+        av_freep(&s->score[j]);
+    av_freep(&s->score);
 }
 
 static const AVFilterPad psnr_inputs[] = {
@@ -415,4 +309,5 @@ AVFilter ff_vf_psnr = {
     .priv_class    = &psnr_class,
     .inputs        = psnr_inputs,
     .outputs       = psnr_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,288 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Calculate the PSNR, SSIM and optionally MS-SSIM between two input videos
+ * in a single pass.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "avfilter.h"
+#include "dualinput.h"
+#include "formats.h"
+#include "internal.h"
+#include "psnr.h"
+#include "ssim.h"
+#include "video.h"
+
+/* number of SSIM block rows (of 4 lines) processed at once, so that the
+ * lines read for the PSNR are still in cache when the SSIM reads them */
+#define BAND_ROWS 8
+
+typedef struct PSNRSSIMContext {
+    const AVClass *class;
+    FFDualInputContext dinput;
+    PSNRMetrics psnr;
+    SSIMMetrics ssim;
+    FILE *stats_file;
+    char *stats_file_str;
+    uint64_t (*sse)[4];
+    int nb_threads;
+} PSNRSSIMContext;
+
+#define OFFSET(x) offsetof(PSNRSSIMContext, x)
+#define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
+
+static const AVOption psnrssim_options[] = {
+    {"stats_file", "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    {"f",          "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    {"ms_ssim",    "Also calculate the MS-SSIM",                                OFFSET(ssim.ms_ssim),   AV_OPT_TYPE_BOOL,   {.i64=0},    0, 1, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(psnrssim);
+
+typedef struct ThreadData {
+    const AVFrame *main, *ref;
+} ThreadData;
+
+static int compute_metrics(AVFilterContext *ctx, void *arg,
+                           int jobnr, int nb_jobs)
+{
+    PSNRSSIMContext *s = ctx->priv;
+    ThreadData *td = arg;
+    uint64_t *sse = s->sse[jobnr];
+    int c;
+
+    for (c = 0; c < s->psnr.nb_components; c++) {
+        const int height = ff_ssim_metrics_rows(&s->ssim, c);
+        const int slice_start = 1 + ((height - 1) * jobnr) / nb_jobs;
+        const int slice_end = 1 + ((height - 1) * (jobnr+1)) / nb_jobs;
+        int y, band_end;
+
+        sse[c] = 0;
+        for (y = slice_start; ; y = band_end) {
+            /* the slice holding the first (last) block row also covers
+             * the lines above (below) the block rows */
+            int line_start, line_end;
+
+            band_end = FFMIN(y + BAND_ROWS, slice_end);
+            line_start = y == 1 ? 0 : 4 * y;
+            line_end = band_end == height ? s->psnr.planeheight[c] : 4 * band_end;
+
+            sse[c] += ff_psnr_metrics_sse(&s->psnr, td->main, td->ref, c,
+                                          line_start, line_end);
+            if (band_end > y)
+                ff_ssim_metrics_slice(&s->ssim, td->main, td->ref, c,
+                                      y, band_end, jobnr);
+            if (band_end >= slice_end)
+                break;
+        }
+    }
+
+    return 0;
+}
+
+static AVFrame *do_psnrssim(AVFilterContext *ctx, AVFrame *main,
+                            const AVFrame *ref)
+{
+    PSNRSSIMContext *s = ctx->priv;
+    AVDictionary **metadata = avpriv_frame_get_metadatap(main);
+    uint64_t sse[4] = { 0 };
+    ThreadData td;
+    int i, c, nb_jobs;
+
+    td.main = main;
+    td.ref = ref;
+
+    nb_jobs = FFMAX(1, FFMIN((s->ssim.planeheight[1] >> 2) - 1, s->nb_threads));
+    ctx->internal->execute(ctx, compute_metrics, &td, NULL, nb_jobs);
+
+    for (c = 0; c < s->psnr.nb_components; c++)
+        for (i = 0; i < nb_jobs; i++)
+            sse[c] += s->sse[i][c];
+
+    ff_psnr_metrics_frame(&s->psnr, sse, metadata);
+    ff_ssim_metrics_frame(&s->ssim, metadata);
+
+    if (s->stats_file) {
+        fprintf(s->stats_file, "n:%"PRId64" ", s->psnr.nb_frames);
+        ff_psnr_metrics_print(&s->psnr, s->stats_file);
+        ff_ssim_metrics_print(&s->ssim, s->stats_file);
+        fprintf(s->stats_file, "\n");
+    }
+
+    return main;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    PSNRSSIMContext *s = ctx->priv;
+
+    if (s->stats_file_str) {
+        if (!strcmp(s->stats_file_str, "-")) {
+            s->stats_file = stdout;
+        } else {
+            s->stats_file = fopen(s->stats_file_str, "w");
+            if (!s->stats_file) {
+                int err = AVERROR(errno);
+                char buf[128];
+                av_strerror(err, buf, sizeof(buf));
+                av_log(ctx, AV_LOG_ERROR, "Could not open stats file %s: %s\n",
+                       s->stats_file_str, buf);
+                return err;
+            }
+        }
+    }
+
+    s->dinput.process = do_psnrssim;
+    s->dinput.shortest = 1;
+    s->dinput.repeatlast = 0;
+    return 0;
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    /* the SSIM is only implemented for 8 bit samples */
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_GRAY8,
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P,
+        AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUV411P, AV_PIX_FMT_YUV410P,
+        AV_PIX_FMT_YUVJ411P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P,
+        AV_PIX_FMT_YUVJ440P, AV_PIX_FMT_YUVJ444P,
+        AV_PIX_FMT_GBRP,
+        AV_PIX_FMT_NONE
+    };
+
+    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static int config_input_ref(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx  = inlink->dst;
+    PSNRSSIMContext *s = ctx->priv;
+
+    if (ctx->inputs[0]->w != ctx->inputs[1]->w ||
+        ctx->inputs[0]->h != ctx->inputs[1]->h) {
+        av_log(ctx, AV_LOG_ERROR, "Width and height of input videos must be same.\n");
+        return AVERROR(EINVAL);
+    }
+    if (ctx->inputs[0]->format != ctx->inputs[1]->format) {
+        av_log(ctx, AV_LOG_ERROR, "Inputs must be of same pixel format.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    s->sse = av_calloc(s->nb_threads, sizeof(*s->sse));
+    if (!s->sse)
+        return AVERROR(ENOMEM);
+
+    ff_psnr_metrics_config(&s->psnr, inlink);
+
+    return ff_ssim_metrics_config(&s->ssim, ctx, inlink, s->nb_threads);
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    PSNRSSIMContext *s = ctx->priv;
+    AVFilterLink *mainlink = ctx->inputs[0];
+    int ret;
+
+    outlink->w = mainlink->w;
+    outlink->h = mainlink->h;
+    outlink->time_base = mainlink->time_base;
+    outlink->sample_aspect_ratio = mainlink->sample_aspect_ratio;
+    outlink->frame_rate = mainlink->frame_rate;
+
+    if ((ret = ff_dualinput_init(ctx, &s->dinput)) < 0)
+        return ret;
+
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
+{
+    PSNRSSIMContext *s = inlink->dst->priv;
+    return ff_dualinput_filter_frame(&s->dinput, inlink, buf);
+}
+
+static int request_frame(AVFilterLink *outlink)
+{
+    PSNRSSIMContext *s = outlink->src->priv;
+    return ff_dualinput_request_frame(&s->dinput, outlink);
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    PSNRSSIMContext *s = ctx->priv;
+
+    ff_psnr_metrics_log(ctx, &s->psnr);
+    ff_ssim_metrics_log(ctx, &s->ssim);
+
+    ff_dualinput_uninit(&s->dinput);
+
+    if (s->stats_file && s->stats_file != stdout)
+        fclose(s->stats_file);
+
+    ff_ssim_metrics_uninit(&s->ssim);
+    av_freep(&s->sse);
+}
+
+static const AVFilterPad psnrssim_inputs[] = {
+    {
+        .name         = "main",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = filter_frame,
+    },{
+        .name         = "reference",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = filter_frame,
+        .config_props = config_input_ref,
+    },
+    { NULL }
+};
+
+static const AVFilterPad psnrssim_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = config_output,
+        .request_frame = request_frame,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_psnrssim = {
+    .name          = "psnrssim",
+    .description   = NULL_IF_CONFIG_SMALL("Calculate the PSNR and SSIM between two video streams in a single pass."),
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .priv_size     = sizeof(PSNRSSIMContext),
+    .priv_class    = &psnrssim_class,
+    .inputs        = psnrssim_inputs,
+    .outputs       = psnrssim_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+};
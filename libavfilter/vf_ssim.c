@@ -34,12 +34,9 @@
  * Caculate the SSIM between two input videos.
  */
 
-#include "libavutil/avstring.h"
 #include "libavutil/opt.h"
-#include "libavutil/pixdesc.h"
 #include "avfilter.h"
 #include "dualinput.h"
-#include "drawutils.h"
 #include "formats.h"
 #include "internal.h"
 #include "ssim.h"
@@ -48,19 +45,10 @@
 typedef struct SSIMContext {
     const AVClass *class;
     FFDualInputContext dinput;
+    SSIMMetrics m;
     FILE *stats_file;
     char *stats_file_str;
-    int nb_components;
-    uint64_t nb_frames;
-    double ssim[4], ssim_total;
-    char comps[4];
-    float coefs[4];
-    uint8_t rgba_map[4];
-    int planewidth[4];
-    int planeheight[4];
-    int *temp;
-    int is_rgb;
-    SSIMDSPContext dsp;
+    int nb_threads;
 } SSIMContext;
 
 #define OFFSET(x) offsetof(SSIMContext, x)
@@ -74,109 +62,30 @@ static const AVOption ssim_options[] = {
 
 AVFILTER_DEFINE_CLASS(ssim);
 
-static void set_meta(AVDictionary **metadata, const char *key, char comp, float d)
-{
-    char value[128];
-    snprintf(value, sizeof(value), "%0.2f", d);
-    if (comp) {
-        char key2[128];
-        snprintf(key2, sizeof(key2), "%s%c", key, comp);
-        av_dict_set(metadata, key2, value, 0);
-    } else {
-        av_dict_set(metadata, key, value, 0);
-    }
-}
-
-static void ssim_4x4xn(const uint8_t *main, ptrdiff_t main_stride,
-                       const uint8_t *ref, ptrdiff_t ref_stride,
-                       int (*sums)[4], int width)
-{
-    int x, y, z;
-
-    for (z = 0; z < width; z++) {
-        uint32_t s1 = 0, s2 = 0, ss = 0, s12 = 0;
-
-        for (y = 0; y < 4; y++) {
-            for (x = 0; x < 4; x++) {
-                int a = main[x + y * main_stride];
-                int b = ref[x + y * ref_stride];
-
-                s1  += a;
-                s2  += b;
-                ss  += a*a;
-                ss  += b*b;
-                s12 += a*b;
-            }
-        }
-
-        sums[z][0] = s1;
-        sums[z][1] = s2;
-        sums[z][2] = ss;
-        sums[z][3] = s12;
-        main += 4;
-        ref += 4;
-    }
-}
-
-static float ssim_end1(int s1, int s2, int ss, int s12)
-{
-    static const int ssim_c1 = (int)(.01*.01*255*255*64 + .5);
-    static const int ssim_c2 = (int)(.03*.03*255*255*64*63 + .5);
-
-    int fs1 = s1;
-    int fs2 = s2;
-    int fss = ss;
-    int fs12 = s12;
-    int vars = fss * 64 - fs1 * fs1 - fs2 * fs2;
-    int covar = fs12 * 64 - fs1 * fs2;
-
-    return (float)(2 * fs1 * fs2 + ssim_c1) * (float)(2 * covar + ssim_c2)
-         / ((float)(fs1 * fs1 + fs2 * fs2 + ssim_c1) * (float)(vars + ssim_c2));
-}
-
-static float ssim_endn(const int (*sum0)[4], const int (*sum1)[4], int width)
-{
-    float ssim = 0.0;
-    int i;
-
-    for (i = 0; i < width; i++)
-        ssim += ssim_end1(sum0[i][0] + sum0[i + 1][0] + sum1[i][0] + sum1[i + 1][0],
-                          sum0[i][1] + sum0[i + 1][1] + sum1[i][1] + sum1[i + 1][1],
-                          sum0[i][2] + sum0[i + 1][2] + sum1[i][2] + sum1[i + 1][2],
-                          sum0[i][3] + sum0[i + 1][3] + sum1[i][3] + sum1[i + 1][3]);
-    return ssim;
-}
+typedef struct ThreadData {
+    const AVFrame *main, *ref;
+    SSIMMetrics *m;
+} ThreadData;
 
-static float ssim_plane(SSIMDSPContext *dsp,
-                        uint8_t *main, int main_stride,
-                        uint8_t *ref, int ref_stride,
-                        int width, int height, void *temp)
+static int ssim_plane(AVFilterContext *ctx, void *arg,
+                      int jobnr, int nb_jobs)
 {
-    int z = 0, y;
-    float ssim = 0.0;
-    int (*sum0)[4] = temp;
-    int (*sum1)[4] = sum0 + (width >> 2) + 3;
-
-    width >>= 2;
-    height >>= 2;
-
-    for (y = 1; y < height; y++) {
-        for (; z <= y; z++) {
-            FFSWAP(void*, sum0, sum1);
-            dsp->ssim_4x4_line(&main[4 * z * main_stride], main_stride,
-                               &ref[4 * z * ref_stride], ref_stride,
-                               sum0, width);
-        }
-
-        ssim += dsp->ssim_end_line((const int (*)[4])sum0, (const int (*)[4])sum1, width - 1);
+    ThreadData *td = arg;
+    SSIMMetrics *m = td->m;
+    int c;
+
+    for (c = 0; c < m->nb_components; c++) {
+        const int height = ff_ssim_metrics_rows(m, c);
+        /* block row y combines the 4x4 sums of rows y - 1 and y, so each
+         * slice recomputes the sums of the row above its first one */
+        const int slice_start = 1 + ((height - 1) * jobnr) / nb_jobs;
+        const int slice_end = 1 + ((height - 1) * (jobnr+1)) / nb_jobs;
+
+        ff_ssim_metrics_slice(m, td->main, td->ref, c,
+                              slice_start, slice_end, jobnr);
     }
 
-    return ssim / ((height - 1) * (width - 1));
-}
-
-static double ssim_db(double ssim, double weight)
-{
-    return 10 * log10(weight / (weight - ssim));
+    return 0;
 }
 
 static AVFrame *do_ssim(AVFilterContext *ctx, AVFrame *main,
@@ -184,36 +93,22 @@ static AVFrame *do_ssim(AVFilterContext *ctx, AVFrame *main,
 {
     AVDictionary **metadata = avpriv_frame_get_metadatap(main);
     SSIMContext *s = ctx->priv;
-    float c[4], ssimv = 0.0;
-    int i;
+    SSIMMetrics *m = &s->m;
+    ThreadData td;
 
-    s->nb_frames++;
+    td.main = main;
+    td.ref = ref;
+    td.m = m;
 
-    for (i = 0; i < s->nb_components; i++) {
-        c[i] = ssim_plane(&s->dsp, main->data[i], main->linesize[i],
-                          ref->data[i], ref->linesize[i],
-                          s->planewidth[i], s->planeheight[i], s->temp);
-        ssimv += s->coefs[i] * c[i];
-        s->ssim[i] += c[i];
-    }
-    for (i = 0; i < s->nb_components; i++) {
-        int cidx = s->is_rgb ? s->rgba_map[i] : i;
-        set_meta(metadata, "lavfi.ssim.", s->comps[i], c[cidx]);
-    }
-    s->ssim_total += ssimv;
+    ctx->internal->execute(ctx, ssim_plane, &td, NULL,
+                           FFMAX(1, FFMIN((m->planeheight[1] >> 2) - 1, s->nb_threads)));
 
-    set_meta(metadata, "lavfi.ssim.All", 0, ssimv);
-    set_meta(metadata, "lavfi.ssim.dB", 0, ssim_db(ssimv, 1.0));
+    ff_ssim_metrics_frame(m, metadata);
 
     if (s->stats_file) {
-        fprintf(s->stats_file, "n:%"PRId64" ", s->nb_frames);
-
-        for (i = 0; i < s->nb_components; i++) {
-            int cidx = s->is_rgb ? s->rgba_map[i] : i;
-            fprintf(s->stats_file, "%c:%f ", s->comps[i], c[cidx]);
-        }
-
-        fprintf(s->stats_file, "All:%f (%f)\n", ssimv, ssim_db(ssimv, 1.0));
+        fprintf(s->stats_file, "n:%"PRId64" ", m->nb_frames);
+        ff_ssim_metrics_print(m, s->stats_file);
+        fprintf(s->stats_file, "\n");
     }
 
     return main;
@@ -265,12 +160,8 @@ static int query_formats(AVFilterContext *ctx)
 
 static int config_input_ref(AVFilterLink *inlink)
 {
-    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
     AVFilterContext *ctx  = inlink->dst;
     SSIMContext *s = ctx->priv;
-    int sum = 0, i;
-
-    s->nb_components = desc->nb_components;
 
     if (ctx->inputs[0]->w != ctx->inputs[1]->w ||
         ctx->inputs[0]->h != ctx->inputs[1]->h) {
@@ -282,31 +173,9 @@ static int config_input_ref(AVFilterLink *inlink)
         return AVERROR(EINVAL);
     }
 
-    s->is_rgb = ff_fill_rgba_map(s->rgba_map, inlink->format) >= 0;
-    s->comps[0] = s->is_rgb ? 'R' : 'Y';
-    s->comps[1] = s->is_rgb ? 'G' : 'U';
-    s->comps[2] = s->is_rgb ? 'B' : 'V';
-    s->comps[3] = 'A';
-
-    s->planeheight[1] = s->planeheight[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
-    s->planeheight[0] = s->planeheight[3] = inlink->h;
-    s->planewidth[1]  = s->planewidth[2]  = AV_CEIL_RSHIFT(inlink->w, desc->log2_chroma_w);
-    s->planewidth[0]  = s->planewidth[3]  = inlink->w;
-    for (i = 0; i < s->nb_components; i++)
-        sum += s->planeheight[i] * s->planewidth[i];
-    for (i = 0; i < s->nb_components; i++)
-        s->coefs[i] = (double) s->planeheight[i] * s->planewidth[i] / sum;
-
-    s->temp = av_malloc((2 * inlink->w + 12) * sizeof(*s->temp));
-    if (!s->temp)
-        return AVERROR(ENOMEM);
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
 
-    s->dsp.ssim_4x4_line = ssim_4x4xn;
-    s->dsp.ssim_end_line = ssim_endn;
-    if (ARCH_X86)
-        ff_ssim_init_x86(&s->dsp);
-
-    return 0;
+    return ff_ssim_metrics_config(&s->m, ctx, inlink, s->nb_threads);
 }
 
 static int config_output(AVFilterLink *outlink)
@@ -344,25 +213,14 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     SSIMContext *s = ctx->priv;
 
-    if (s->nb_frames > 0) {
-        char buf[256];
-        int i;
-        buf[0] = 0;
-        for (i = 0; i < s->nb_components; i++) {
-            int c = s->is_rgb ? s->rgba_map[i] : i;
-            av_strlcatf(buf, sizeof(buf), " %c:%f (%f)", s->comps[i], s->ssim[c] / s->nb_frames,
-                        ssim_db(s->ssim[c], s->nb_frames));
-        }
-        av_log(ctx, AV_LOG_INFO, "SSIM%s All:%f (%f)\n", buf,
-               s->ssim_total / s->nb_frames, ssim_db(s->ssim_total, s->nb_frames));
-    }
+    ff_ssim_metrics_log(ctx, &s->m);
 
     ff_dualinput_uninit(&s->dinput);
 
     if (s->stats_file && s->stats_file != stdout)
         fclose(s->stats_file);
 
-    av_freep(&s->temp);
+    ff_ssim_metrics_uninit(&s->m);
 }
 
 static const AVFilterPad ssim_inputs[] = {
@@ -399,4 +257,5 @@ AVFilter ff_vf_ssim = {
     .priv_class    = &ssim_class,
     .inputs        = ssim_inputs,
     .outputs       = ssim_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
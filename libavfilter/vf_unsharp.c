@@ -48,66 +48,98 @@
 #include "unsharp.h"
 #include "unsharp_opencl.h"
 
-static void apply_unsharp(      uint8_t *dst, int dst_stride,
-                          const uint8_t *src, int src_stride,
-                          int width, int height, UnsharpFilterParam *fp)
-{
-    uint32_t **sc = fp->sc;
-    uint32_t sr[MAX_MATRIX_SIZE - 1], tmp1, tmp2;
-
-    int32_t res;
-    int x, y, z;
-    const uint8_t *src2 = NULL;  //silence a warning
-    const int amount = fp->amount;
-    const int steps_x = fp->steps_x;
-    const int steps_y = fp->steps_y;
-    const int scalebits = fp->scalebits;
-    const int32_t halfscale = fp->halfscale;
-
-    if (!amount) {
-        av_image_copy_plane(dst, dst_stride, src, src_stride, width, height);
-        return;
-    }
-
-    for (y = 0; y < 2 * steps_y; y++)
-        memset(sc[y], 0, sizeof(sc[y][0]) * (width + 2 * steps_x));
-
-    for (y = -steps_y; y < height + steps_y; y++) {
-        if (y < height)
-            src2 = src;
-
-        memset(sr, 0, sizeof(sr[0]) * (2 * steps_x - 1));
-        for (x = -steps_x; x < width + steps_x; x++) {
-            tmp1 = x <= 0 ? src2[0] : x >= width ? src2[width-1] : src2[x];
-            for (z = 0; z < steps_x * 2; z += 2) {
-                tmp2 = sr[z + 0] + tmp1; sr[z + 0] = tmp1;
-                tmp1 = sr[z + 1] + tmp2; sr[z + 1] = tmp2;
-            }
-            for (z = 0; z < steps_y * 2; z += 2) {
-                tmp2 = sc[z + 0][x + steps_x] + tmp1; sc[z + 0][x + steps_x] = tmp1;
-                tmp1 = sc[z + 1][x + steps_x] + tmp2; sc[z + 1][x + steps_x] = tmp2;
-            }
-            if (x >= steps_x && y >= steps_y) {
-                const uint8_t *srx = src - steps_y * src_stride + x - steps_x;
-                uint8_t *dsx       = dst - steps_y * dst_stride + x - steps_x;
-
-                res = (int32_t)*srx + ((((int32_t) * srx - (int32_t)((tmp1 + halfscale) >> scalebits)) * amount) >> 16);
-                *dsx = av_clip_uint8(res);
-            }
-        }
-        if (y >= 0) {
-            dst += dst_stride;
-            src += src_stride;
-        }
-    }
+typedef struct ThreadData {
+    UnsharpFilterParam *fp;
+    uint8_t       *dst;
+    const uint8_t *src;
+    int dst_stride;
+    int src_stride;
+    int width;
+    int height;
+} ThreadData;
+
+/* The blur is a binomial kernel of 2 * steps + 1 taps in each direction,
+ * with the image edges replicated. Each input line is first summed
+ * horizontally into hsum, then pushed through the vertical state machine
+ * in sc. A slice restarts the vertical state machine steps_y lines above
+ * its first output line, which is exact since the kernel has a finite
+ * support. */
+#define DEF_UNSHARP_SLICE_FUNC(name, nbits, acctype)                          \
+static int name##_##nbits(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs) \
+{                                                                             \
+    UnsharpContext *s = ctx->priv;                                            \
+    ThreadData *td = arg;                                                     \
+    UnsharpFilterParam *fp = td->fp;                                          \
+    const int amount = fp->amount;                                            \
+    const int steps_x = fp->steps_x;                                          \
+    const int steps_y = fp->steps_y;                                          \
+    const int scalebits = fp->scalebits;                                      \
+    const int32_t halfscale = fp->halfscale;                                  \
+    const int maxval = (1 << s->bitdepth) - 1;                                \
+    const int width  = td->width;                                             \
+    const int height = td->height;                                            \
+    const int slice_start = (height *  jobnr     ) / nb_jobs;                 \
+    const int slice_end   = (height * (jobnr + 1)) / nb_jobs;                 \
+    uint32_t **sc = fp->sc + jobnr * 2 * steps_y;                             \
+    uint32_t *hsum = fp->sr[jobnr];                                           \
+    uint32_t sr[MAX_MATRIX_SIZE - 1];                                         \
+    int x, y, z;                                                              \
+                                                                              \
+    for (z = 0; z < 2 * steps_y; z++)                                         \
+        memset(sc[z], 0, sizeof(sc[z][0]) * width);                           \
+                                                                              \
+    for (y = slice_start - steps_y; y < slice_end + steps_y; y++) {           \
+        const uint##nbits##_t *src2 = (const uint##nbits##_t *)               \
+            (td->src + av_clip(y, 0, height - 1) * td->src_stride);           \
+                                                                              \
+        memset(sr, 0, sizeof(sr[0]) * 2 * steps_x);                           \
+        for (x = -steps_x; x < width + steps_x; x++) {                        \
+            uint32_t tmp1 = src2[av_clip(x, 0, width - 1)], tmp2;             \
+            for (z = 0; z < 2 * steps_x; z += 2) {                            \
+                tmp2 = sr[z + 0] + tmp1; sr[z + 0] = tmp1;                    \
+                tmp1 = sr[z + 1] + tmp2; sr[z + 1] = tmp2;                    \
+            }                                                                 \
+            if (x >= steps_x)                                                 \
+                hsum[x - steps_x] = tmp1;                                     \
+        }                                                                     \
+                                                                              \
+        for (x = 0; x < width; x++) {                                         \
+            uint32_t tmp1 = hsum[x], tmp2;                                    \
+            for (z = 0; z < 2 * steps_y; z += 2) {                            \
+                tmp2 = sc[z + 0][x] + tmp1; sc[z + 0][x] = tmp1;              \
+                tmp1 = sc[z + 1][x] + tmp2; sc[z + 1][x] = tmp2;              \
+            }                                                                 \
+            hsum[x] = tmp1;                                                   \
+        }                                                                     \
+                                                                              \
+        if (y >= slice_start + steps_y) {                                     \
+            const uint##nbits##_t *srx = (const uint##nbits##_t *)            \
+                (td->src + (y - steps_y) * td->src_stride);                   \
+            uint##nbits##_t *dsx = (uint##nbits##_t *)                        \
+                (td->dst + (y - steps_y) * td->dst_stride);                   \
+                                                                              \
+            for (x = 0; x < width; x++) {                                     \
+                const int32_t blur = (hsum[x] + halfscale) >> scalebits;      \
+                const int32_t res  = srx[x] +                                 \
+                    (int32_t)(((acctype)(srx[x] - blur) * amount) >> 16);     \
+                dsx[x] = av_clip(res, 0, maxval);                             \
+            }                                                                 \
+        }                                                                     \
+    }                                                                         \
+    return 0;                                                                 \
 }
 
+DEF_UNSHARP_SLICE_FUNC(unsharp_slice,  8, int32_t)
+DEF_UNSHARP_SLICE_FUNC(unsharp_slice, 16, int64_t)
+
 static int apply_unsharp_c(AVFilterContext *ctx, AVFrame *in, AVFrame *out)
 {
     AVFilterLink *inlink = ctx->inputs[0];
     UnsharpContext *s = ctx->priv;
     int i, plane_w[3], plane_h[3];
     UnsharpFilterParam *fp[3];
+    ThreadData td;
+
     plane_w[0] = inlink->w;
     plane_w[1] = plane_w[2] = AV_CEIL_RSHIFT(inlink->w, s->hsub);
     plane_h[0] = inlink->h;
@@ -115,7 +147,21 @@ static int apply_unsharp_c(AVFilterContext *ctx, AVFrame *in, AVFrame *out)
     fp[0] = &s->luma;
     fp[1] = fp[2] = &s->chroma;
     for (i = 0; i < 3; i++) {
-        apply_unsharp(out->data[i], out->linesize[i], in->data[i], in->linesize[i], plane_w[i], plane_h[i], fp[i]);
+        if (!fp[i]->amount) {
+            av_image_copy_plane(out->data[i], out->linesize[i],
+                                in->data[i], in->linesize[i],
+                                plane_w[i] * s->bps, plane_h[i]);
+            continue;
+        }
+        td.fp         = fp[i];
+        td.dst        = out->data[i];
+        td.src        = in->data[i];
+        td.dst_stride = out->linesize[i];
+        td.src_stride = in->linesize[i];
+        td.width      = plane_w[i];
+        td.height     = plane_h[i];
+        ctx->internal->execute(ctx, s->bps == 1 ? unsharp_slice_8 : unsharp_slice_16,
+                               &td, NULL, FFMIN(plane_h[i], s->nb_threads));
     }
     return 0;
 }
@@ -161,13 +207,32 @@ static av_cold int init(AVFilterContext *ctx)
 
 static int query_formats(AVFilterContext *ctx)
 {
+    UnsharpContext *s = ctx->priv;
     static const enum AVPixelFormat pix_fmts[] = {
         AV_PIX_FMT_YUV420P,  AV_PIX_FMT_YUV422P,  AV_PIX_FMT_YUV444P,  AV_PIX_FMT_YUV410P,
         AV_PIX_FMT_YUV411P,  AV_PIX_FMT_YUV440P,  AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P,
-        AV_PIX_FMT_YUVJ444P, AV_PIX_FMT_YUVJ440P, AV_PIX_FMT_NONE
+        AV_PIX_FMT_YUVJ444P, AV_PIX_FMT_YUVJ440P,
+        AV_PIX_FMT_YUV420P9,  AV_PIX_FMT_YUV422P9,  AV_PIX_FMT_YUV444P9,
+        AV_PIX_FMT_YUV420P10, AV_PIX_FMT_YUV422P10, AV_PIX_FMT_YUV440P10, AV_PIX_FMT_YUV444P10,
+        AV_PIX_FMT_YUV420P12, AV_PIX_FMT_YUV422P12, AV_PIX_FMT_YUV440P12, AV_PIX_FMT_YUV444P12,
+        AV_PIX_FMT_YUV420P14, AV_PIX_FMT_YUV422P14, AV_PIX_FMT_YUV444P14,
+        AV_PIX_FMT_YUV420P16, AV_PIX_FMT_YUV422P16, AV_PIX_FMT_YUV444P16,
+        AV_PIX_FMT_NONE
     };
-
-    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    AVFilterFormats *fmts_list;
+
+    /* the OpenCL kernels only handle 8-bit planes */
+    if (s->opencl) {
+        enum AVPixelFormat pix_fmts_8bit[FF_ARRAY_ELEMS(pix_fmts)];
+        int i;
+
+        for (i = 0; av_pix_fmt_desc_get(pix_fmts[i])->comp[0].depth == 8; i++)
+            pix_fmts_8bit[i] = pix_fmts[i];
+        pix_fmts_8bit[i] = AV_PIX_FMT_NONE;
+        fmts_list = ff_make_format_list(pix_fmts_8bit);
+    } else {
+        fmts_list = ff_make_format_list(pix_fmts);
+    }
     if (!fmts_list)
         return AVERROR(ENOMEM);
     return ff_set_common_formats(ctx, fmts_list);
@@ -175,6 +240,7 @@ static int query_formats(AVFilterContext *ctx)
 
 static int init_filter_param(AVFilterContext *ctx, UnsharpFilterParam *fp, const char *effect_type, int width)
 {
+    UnsharpContext *s = ctx->priv;
     int z;
     const char *effect = fp->amount == 0 ? "none" : fp->amount < 0 ? "blur" : "sharpen";
 
@@ -188,9 +254,24 @@ static int init_filter_param(AVFilterContext *ctx, UnsharpFilterParam *fp, const
     av_log(ctx, AV_LOG_VERBOSE, "effect:%s type:%s msize_x:%d msize_y:%d amount:%0.2f\n",
            effect, effect_type, fp->msize_x, fp->msize_y, fp->amount / 65535.0);
 
-    for (z = 0; z < 2 * fp->steps_y; z++)
-        if (!(fp->sc[z] = av_malloc_array(width + 2 * fp->steps_x,
-                                          sizeof(*(fp->sc[z])))))
+    if (fp->scalebits + s->bitdepth > 32) {
+        av_log(ctx, AV_LOG_ERROR,
+               "%s matrix size %dx%d too big for %d-bit input\n",
+               effect_type, fp->msize_x, fp->msize_y, s->bitdepth);
+        return AVERROR(EINVAL);
+    }
+
+    fp->sc = av_mallocz_array(2 * fp->steps_y * s->nb_threads, sizeof(*fp->sc));
+    fp->sr = av_mallocz_array(s->nb_threads, sizeof(*fp->sr));
+    if (!fp->sc || !fp->sr)
+        return AVERROR(ENOMEM);
+
+    for (z = 0; z < 2 * fp->steps_y * s->nb_threads; z++)
+        if (!(fp->sc[z] = av_malloc_array(width, sizeof(*(fp->sc[z])))))
+            return AVERROR(ENOMEM);
+    for (z = 0; z < s->nb_threads; z++)
+        if (!(fp->sr[z] = av_malloc_array(width + 2 * fp->steps_x,
+                                          sizeof(*(fp->sr[z])))))
             return AVERROR(ENOMEM);
 
     return 0;
@@ -204,6 +285,9 @@ static int config_props(AVFilterLink *link)
 
     s->hsub = desc->log2_chroma_w;
     s->vsub = desc->log2_chroma_h;
+    s->bitdepth = desc->comp[0].depth;
+    s->bps = s->bitdepth > 8 ? 2 : 1;
+    s->nb_threads = ff_filter_get_nb_threads(link->dst);
 
     ret = init_filter_param(link->dst, &s->luma,   "luma",   link->w);
     if (ret < 0)
@@ -215,12 +299,20 @@ static int config_props(AVFilterLink *link)
     return 0;
 }
 
-static void free_filter_param(UnsharpFilterParam *fp)
+static void free_filter_param(UnsharpFilterParam *fp, int nb_threads)
 {
     int z;
 
-    for (z = 0; z < 2 * fp->steps_y; z++)
-        av_freep(&fp->sc[z]);
+    if (fp->sc) {
+        for (z = 0; z < 2 * fp->steps_y * nb_threads; z++)
+            av_freep(&fp->sc[z]);
+        av_freep(&fp->sc);
+    }
+    if (fp->sr) {
+        for (z = 0; z < nb_threads; z++)
+            av_freep(&fp->sr[z]);
+        av_freep(&fp->sr);
+    }
 }
 
 static av_cold void uninit(AVFilterContext *ctx)
@@ -231,8 +323,8 @@ static av_cold void uninit(AVFilterContext *ctx)
         ff_opencl_unsharp_uninit(ctx);
     }
 
-    free_filter_param(&s->luma);
-    free_filter_param(&s->chroma);
+    free_filter_param(&s->luma,   s->nb_threads);
+    free_filter_param(&s->chroma, s->nb_threads);
 }
 
 static int filter_frame(AVFilterLink *link, AVFrame *in)
@@ -314,5 +406,5 @@ AVFilter ff_vf_unsharp = {
     .query_formats = query_formats,
     .inputs        = avfilter_vf_unsharp_inputs,
     .outputs       = avfilter_vf_unsharp_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
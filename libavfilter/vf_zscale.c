@@ -42,6 +42,12 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/avassert.h"
 
+#define MAX_THREADS 32
+
+/* zimg can restrict a graph to a subregion of the source image since
+ * API 2.1, which is what slice threading relies on */
+#define HAVE_ZIMG_ACTIVE_REGION (ZIMG_API_VERSION >= ZIMG_MAKE_API_VERSION(2, 1))
+
 static const char *const var_names[] = {
     "in_w",   "iw",
     "in_h",   "ih",
@@ -106,13 +112,16 @@ typedef struct ZScaleContext {
 
     int force_original_aspect_ratio;
 
-    void *tmp;
-    size_t tmp_size;
+    int nb_jobs;
+    int out_slice_start[MAX_THREADS];
+    int out_slice_end[MAX_THREADS];
+    void *tmp[MAX_THREADS];
+    size_t tmp_size[MAX_THREADS];
 
     zimg_image_format src_format, dst_format;
     zimg_image_format alpha_src_format, alpha_dst_format;
     zimg_graph_builder_params alpha_params, params;
-    zimg_filter_graph *alpha_graph, *graph;
+    zimg_filter_graph *alpha_graph[MAX_THREADS], *graph[MAX_THREADS];
 
     enum AVColorSpace in_colorspace, out_colorspace;
     enum AVColorTransferCharacteristic in_trc, out_trc;
@@ -410,17 +419,155 @@ static int convert_range(enum AVColorRange color_range)
     return ZIMG_RANGE_LIMITED;
 }
 
+static void free_graphs(ZScaleContext *s)
+{
+    int i;
+
+    for (i = 0; i < MAX_THREADS; i++) {
+        zimg_filter_graph_free(s->graph[i]);
+        zimg_filter_graph_free(s->alpha_graph[i]);
+        s->graph[i] = s->alpha_graph[i] = NULL;
+    }
+}
+
+/**
+ * Build the graphs of one slice. Each slice produces a band of output lines
+ * from the matching region of the full source image, so that zimg still
+ * sees the source lines around the band for the filter support.
+ */
+static int build_slice_graphs(AVFilterContext *ctx, int job, int alpha,
+                              int in_h, int out_h)
+{
+    ZScaleContext *s = ctx->priv;
+    zimg_image_format src_format = s->src_format;
+    zimg_image_format dst_format = s->dst_format;
+    size_t tmp_size;
+    int ret;
+
+#if HAVE_ZIMG_ACTIVE_REGION
+    if (s->nb_jobs > 1) {
+        const double scale = in_h / (double)out_h;
+        const int slice_h  = s->out_slice_end[job] - s->out_slice_start[job];
+
+        src_format.active_region.left   = 0;
+        src_format.active_region.top    = s->out_slice_start[job] * scale;
+        src_format.active_region.width  = src_format.width;
+        src_format.active_region.height = slice_h * scale;
+        dst_format.height = slice_h;
+    }
+#endif
+
+    s->graph[job] = zimg_filter_graph_build(&src_format, &dst_format, &s->params);
+    if (!s->graph[job])
+        return print_zimg_error(ctx);
+
+    if ((ret = zimg_filter_graph_get_tmp_size(s->graph[job], &tmp_size)))
+        return print_zimg_error(ctx);
+
+    if (tmp_size > s->tmp_size[job]) {
+        av_freep(&s->tmp[job]);
+        s->tmp[job] = av_malloc(tmp_size);
+        if (!s->tmp[job])
+            return AVERROR(ENOMEM);
+        s->tmp_size[job] = tmp_size;
+    }
+
+    if (alpha) {
+        zimg_image_format alpha_src_format = s->alpha_src_format;
+        zimg_image_format alpha_dst_format = s->alpha_dst_format;
+
+#if HAVE_ZIMG_ACTIVE_REGION
+        alpha_src_format.active_region = src_format.active_region;
+        alpha_dst_format.height        = dst_format.height;
+#endif
+
+        s->alpha_graph[job] = zimg_filter_graph_build(&alpha_src_format, &alpha_dst_format, &s->alpha_params);
+        if (!s->alpha_graph[job])
+            return print_zimg_error(ctx);
+
+        if ((ret = zimg_filter_graph_get_tmp_size(s->alpha_graph[job], &tmp_size)))
+            return print_zimg_error(ctx);
+
+        if (tmp_size > s->tmp_size[job]) {
+            av_freep(&s->tmp[job]);
+            s->tmp[job] = av_malloc(tmp_size);
+            if (!s->tmp[job])
+                return AVERROR(ENOMEM);
+            s->tmp_size[job] = tmp_size;
+        }
+    }
+
+    return 0;
+}
+
+typedef struct ThreadData {
+    const AVPixFmtDescriptor *desc, *odesc;
+    AVFrame *in, *out;
+} ThreadData;
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ZScaleContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const AVPixFmtDescriptor *desc  = td->desc;
+    const AVPixFmtDescriptor *odesc = td->odesc;
+    AVFrame *in  = td->in;
+    AVFrame *out = td->out;
+    const int slice_start = s->out_slice_start[jobnr];
+    const int slice_end   = s->out_slice_end[jobnr];
+    zimg_image_buffer_const src_buf = { ZIMG_API_VERSION };
+    zimg_image_buffer dst_buf = { ZIMG_API_VERSION };
+    int ret, plane;
+
+    for (plane = 0; plane < 3; plane++) {
+        const int vsub = plane ? odesc->log2_chroma_h : 0;
+        int p = desc->comp[plane].plane;
+        src_buf.plane[plane].data   = in->data[p];
+        src_buf.plane[plane].stride = in->linesize[p];
+        src_buf.plane[plane].mask   = -1;
+
+        p = odesc->comp[plane].plane;
+        dst_buf.plane[plane].data   = out->data[p] + (slice_start >> vsub) * out->linesize[p];
+        dst_buf.plane[plane].stride = out->linesize[p];
+        dst_buf.plane[plane].mask   = -1;
+    }
+
+    ret = zimg_filter_graph_process(s->graph[jobnr], &src_buf, &dst_buf, s->tmp[jobnr], 0, 0, 0, 0);
+    if (ret)
+        return print_zimg_error(ctx);
+
+    if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
+        src_buf.plane[0].data   = in->data[3];
+        src_buf.plane[0].stride = in->linesize[3];
+        src_buf.plane[0].mask   = -1;
+
+        dst_buf.plane[0].data   = out->data[3] + slice_start * out->linesize[3];
+        dst_buf.plane[0].stride = out->linesize[3];
+        dst_buf.plane[0].mask   = -1;
+
+        ret = zimg_filter_graph_process(s->alpha_graph[jobnr], &src_buf, &dst_buf, s->tmp[jobnr], 0, 0, 0, 0);
+        if (ret)
+            return print_zimg_error(ctx);
+    } else if (odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
+        int y;
+
+        for (y = slice_start; y < slice_end; y++)
+            memset(out->data[3] + y * out->linesize[3], 0xff, out->width);
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
     ZScaleContext *s = link->dst->priv;
     AVFilterLink *outlink = link->dst->outputs[0];
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(link->format);
     const AVPixFmtDescriptor *odesc = av_pix_fmt_desc_get(outlink->format);
-    zimg_image_buffer_const src_buf = { ZIMG_API_VERSION };
-    zimg_image_buffer dst_buf = { ZIMG_API_VERSION };
     char buf[32];
-    size_t tmp_size;
-    int ret = 0, plane;
+    int ret = 0, i;
+    int jobs_ret[MAX_THREADS];
+    ThreadData td;
     AVFrame *out;
 
     out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
@@ -511,28 +658,6 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         if (s->chromal != -1)
             out->chroma_location = (int)s->dst_format.chroma_location - 1;
 
-        zimg_filter_graph_free(s->graph);
-        s->graph = zimg_filter_graph_build(&s->src_format, &s->dst_format, &s->params);
-        if (!s->graph) {
-            ret = print_zimg_error(link->dst);
-            goto fail;
-        }
-
-        if ((ret = zimg_filter_graph_get_tmp_size(s->graph, &tmp_size))) {
-            ret = print_zimg_error(link->dst);
-            goto fail;
-        }
-
-        if (tmp_size > s->tmp_size) {
-            av_freep(&s->tmp);
-            s->tmp = av_malloc(tmp_size);
-            if (!s->tmp) {
-                ret = AVERROR(ENOMEM);
-                goto fail;
-            }
-            s->tmp_size = tmp_size;
-        }
-
         s->in_colorspace  = in->colorspace;
         s->in_trc         = in->color_trc;
         s->in_primaries   = in->color_primaries;
@@ -562,13 +687,31 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
             s->alpha_dst_format.depth = odesc->comp[0].depth;
             s->alpha_dst_format.pixel_type = odesc->comp[0].depth > 8 ? ZIMG_PIXEL_WORD : ZIMG_PIXEL_BYTE;
             s->alpha_dst_format.color_family = ZIMG_COLOR_GREY;
+        }
 
-            zimg_filter_graph_free(s->alpha_graph);
-            s->alpha_graph = zimg_filter_graph_build(&s->alpha_src_format, &s->alpha_dst_format, &s->alpha_params);
-            if (!s->alpha_graph) {
-                ret = print_zimg_error(link->dst);
+        /* split the output into bands of whole chroma lines; the dither
+         * state of zimg (error diffusion, or the position in the ordered
+         * and random patterns) restarts with every band, so a dithered
+         * output is produced in one band to keep it free of seams */
+        s->nb_jobs = 1;
+#if HAVE_ZIMG_ACTIVE_REGION
+        if (s->dither == ZIMG_DITHER_NONE)
+            s->nb_jobs = av_clip(FFMIN(ff_filter_get_nb_threads(link->dst), MAX_THREADS),
+                                 1, out->height >> odesc->log2_chroma_h);
+#endif
+        for (i = 0; i < s->nb_jobs; i++) {
+            s->out_slice_start[i] = ((out->height *  i     ) / s->nb_jobs) & ~((1 << odesc->log2_chroma_h) - 1);
+            s->out_slice_end[i]   = ((out->height * (i + 1)) / s->nb_jobs) & ~((1 << odesc->log2_chroma_h) - 1);
+        }
+        s->out_slice_end[s->nb_jobs - 1] = out->height;
+
+        free_graphs(s);
+        for (i = 0; i < s->nb_jobs; i++) {
+            ret = build_slice_graphs(link->dst, i,
+                                     desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA,
+                                     in->height, out->height);
+            if (ret)
                 goto fail;
-            }
         }
     }
 
@@ -589,43 +732,16 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
               (int64_t)in->sample_aspect_ratio.den * outlink->w * link->h,
               INT_MAX);
 
-    for (plane = 0; plane < 3; plane++) {
-        int p = desc->comp[plane].plane;
-        src_buf.plane[plane].data   = in->data[p];
-        src_buf.plane[plane].stride = in->linesize[p];
-        src_buf.plane[plane].mask   = -1;
-
-        p = odesc->comp[plane].plane;
-        dst_buf.plane[plane].data   = out->data[p];
-        dst_buf.plane[plane].stride = out->linesize[p];
-        dst_buf.plane[plane].mask   = -1;
-    }
-
-    ret = zimg_filter_graph_process(s->graph, &src_buf, &dst_buf, s->tmp, 0, 0, 0, 0);
-    if (ret) {
-        print_zimg_error(link->dst);
-        goto fail;
-    }
-
-    if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
-        src_buf.plane[0].data   = in->data[3];
-        src_buf.plane[0].stride = in->linesize[3];
-        src_buf.plane[0].mask   = -1;
-
-        dst_buf.plane[0].data   = out->data[3];
-        dst_buf.plane[0].stride = out->linesize[3];
-        dst_buf.plane[0].mask   = -1;
-
-        ret = zimg_filter_graph_process(s->alpha_graph, &src_buf, &dst_buf, s->tmp, 0, 0, 0, 0);
-        if (ret) {
-            print_zimg_error(link->dst);
-            goto fail;
+    td.desc  = desc;
+    td.odesc = odesc;
+    td.in    = in;
+    td.out   = out;
+    link->dst->internal->execute(link->dst, filter_slice, &td, jobs_ret, s->nb_jobs);
+    for (i = 0; i < s->nb_jobs; i++) {
+        if (jobs_ret[i]) {
+            ret = jobs_ret[i];
+            break;
         }
-    } else if (odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
-        int y;
-
-        for (y = 0; y < outlink->h; y++)
-            memset(out->data[3] + y * out->linesize[3], 0xff, outlink->w);
     }
 
 fail:
@@ -642,9 +758,13 @@ static void uninit(AVFilterContext *ctx)
 {
     ZScaleContext *s = ctx->priv;
 
-    zimg_filter_graph_free(s->graph);
-    av_freep(&s->tmp);
-    s->tmp_size = 0;
+    int i;
+
+    free_graphs(s);
+    for (i = 0; i < MAX_THREADS; i++) {
+        av_freep(&s->tmp[i]);
+        s->tmp_size[i] = 0;
+    }
 }
 
 static int process_command(AVFilterContext *ctx, const char *cmd, const char *args,
@@ -786,4 +906,5 @@ AVFilter ff_vf_zscale = {
     .inputs          = avfilter_vf_zscale_inputs,
     .outputs         = avfilter_vf_zscale_outputs,
     .process_command = process_command,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -46,9 +46,12 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
     int pool_height = 0;
     int pool_align = 0;
     enum AVPixelFormat pool_format = AV_PIX_FMT_NONE;
+    AVBufferRef *(*alloc)(int size) = link->graph && link->graph->hugepages ?
+                                      av_buffer_alloc_hugepages : av_buffer_allocz;
+    AVBufferRef *shared = link->graph ? link->graph->frame_pools : NULL;
 
     if (!link->video_frame_pool) {
-        link->video_frame_pool = ff_video_frame_pool_init(av_buffer_allocz, w, h,
+        link->video_frame_pool = ff_video_frame_pool_init(shared, alloc, w, h,
                                                           link->format, BUFFER_ALIGN);
         if (!link->video_frame_pool)
             return NULL;
@@ -63,7 +66,7 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
             pool_format != link->format || pool_align != BUFFER_ALIGN) {
 
             ff_video_frame_pool_uninit((FFVideoFramePool **)&link->video_frame_pool);
-            link->video_frame_pool = ff_video_frame_pool_init(av_buffer_allocz, w, h,
+            link->video_frame_pool = ff_video_frame_pool_init(shared, alloc, w, h,
                                                               link->format, BUFFER_ALIGN);
             if (!link->video_frame_pool)
                 return NULL;
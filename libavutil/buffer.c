@@ -16,8 +16,22 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
+#define _DEFAULT_SOURCE
+#define _SVID_SOURCE // needed for MAP_ANONYMOUS
+#define _DARWIN_C_SOURCE // needed for MAP_ANON
 #include <stdint.h>
 #include <string.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+#if HAVE_SYSCONF
+#include <unistd.h>
+#endif
 
 #include "atomic.h"
 #include "buffer_internal.h"
@@ -89,6 +103,104 @@ AVBufferRef *av_buffer_allocz(int size)
     return ret;
 }
 
+#if HAVE_MMAP && defined(MAP_ANONYMOUS)
+/*
+ * Size of the huge pages used. Reserved huge pages are requested with this
+ * size explicitly, as the default size of the system may differ (e.g. 1 GiB).
+ */
+#define HUGEPAGE_SIZE (2 << 20)
+
+static void hugepages_free(void *opaque, uint8_t *data)
+{
+    munmap(data, (size_t)(uintptr_t)opaque);
+}
+
+static size_t get_page_size(void)
+{
+#if HAVE_SYSCONF && defined(_SC_PAGESIZE)
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size > 0)
+        return page_size;
+#endif
+    return 4096;
+}
+
+/* map size bytes, a multiple of the huge page size, from reserved pages */
+static uint8_t *map_hugetlb(size_t size)
+{
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_2MB)
+    uint8_t *data = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB,
+                         -1, 0);
+    if (data != MAP_FAILED)
+        return data;
+#endif
+    return NULL;
+}
+
+/* map size bytes, a multiple of the page size, from transparent huge pages */
+static uint8_t *map_thp(size_t size)
+{
+    uint8_t *data, *aligned;
+    size_t head;
+
+    /* transparent huge pages need huge page aligned addresses, so map one
+     * huge page more than needed and trim the excess on both ends */
+    data = mmap(NULL, size + HUGEPAGE_SIZE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    aligned = (uint8_t *)FFALIGN((uintptr_t)data, HUGEPAGE_SIZE);
+    head    = aligned - data;
+    if (head)
+        munmap(data, head);
+    munmap(aligned + size, HUGEPAGE_SIZE - head);
+
+#if HAVE_MADVISE && defined(MADV_HUGEPAGE)
+    madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+
+    return aligned;
+}
+#endif
+
+AVBufferRef *av_buffer_alloc_hugepages(int size)
+{
+#if HAVE_MMAP && defined(MAP_ANONYMOUS)
+    AVBufferRef *ret;
+    uint8_t *data = NULL;
+    size_t map_size;
+
+    /* smaller buffers cannot fill a single huge page */
+    if (size < HUGEPAGE_SIZE)
+        return av_buffer_allocz(size);
+
+    /* reserved huge pages are only used when rounding up to whole huge
+     * pages wastes at most an eighth of the mapping */
+    map_size = FFALIGN((size_t)size, HUGEPAGE_SIZE);
+    if (map_size - size <= map_size / 8)
+        data = map_hugetlb(map_size);
+
+    /* otherwise, the tail that does not fill a huge page uses normal pages */
+    if (!data) {
+        map_size = FFALIGN((size_t)size, get_page_size());
+        data     = map_thp(map_size);
+    }
+    if (!data)
+        return av_buffer_allocz(size);
+
+    ret = av_buffer_create(data, size, hugepages_free,
+                           (void *)(uintptr_t)map_size, 0);
+    if (!ret)
+        munmap(data, map_size);
+
+    return ret;
+#else
+    return av_buffer_allocz(size);
+#endif
+}
+
 AVBufferRef *av_buffer_ref(AVBufferRef *buf)
 {
     AVBufferRef *ret = av_mallocz(sizeof(*ret));
@@ -214,16 +326,39 @@ int av_buffer_realloc(AVBufferRef **pbuf, int size)
     return 0;
 }
 
+static AVBufferPool *buffer_pool_alloc(void)
+{
+    AVBufferPool *pool;
+#if USE_ATOMICS
+    pool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        return NULL;
+#else
+    /* av_malloc() does not guarantee cache line alignment */
+    uint8_t *mem = av_mallocz(sizeof(*pool) + BUFFER_POOL_CACHE_LINE - 1);
+    int i;
+
+    if (!mem)
+        return NULL;
+    pool = (AVBufferPool *)FFALIGN((uintptr_t)mem, BUFFER_POOL_CACHE_LINE);
+    pool->mem = mem;
+
+    for (i = 0; i < BUFFER_POOL_SHARDS; i++)
+        ff_mutex_init(&pool->shards[i].s.mutex, NULL);
+#endif
+    ff_mutex_init(&pool->mutex, NULL);
+
+    return pool;
+}
+
 AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
                                    AVBufferRef* (*alloc)(void *opaque, int size),
                                    void (*pool_free)(void *opaque))
 {
-    AVBufferPool *pool = av_mallocz(sizeof(*pool));
+    AVBufferPool *pool = buffer_pool_alloc();
     if (!pool)
         return NULL;
 
-    ff_mutex_init(&pool->mutex, NULL);
-
     pool->size      = size;
     pool->opaque    = opaque;
     pool->alloc2    = alloc;
@@ -236,12 +371,10 @@ AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
 
 AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
 {
-    AVBufferPool *pool = av_mallocz(sizeof(*pool));
+    AVBufferPool *pool = buffer_pool_alloc();
     if (!pool)
         return NULL;
 
-    ff_mutex_init(&pool->mutex, NULL);
-
     pool->size     = size;
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
@@ -254,21 +387,39 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
  * This function gets called when the pool has been uninited and
  * all the buffers returned to it.
  */
-static void buffer_pool_free(AVBufferPool *pool)
+static void buffer_pool_free_list(BufferPoolEntry *buf)
 {
-    while (pool->pool) {
-        BufferPoolEntry *buf = pool->pool;
-        pool->pool = buf->next;
+    while (buf) {
+        BufferPoolEntry *next = buf->next;
 
         buf->free(buf->opaque, buf->data);
-        av_freep(&buf);
+        av_free(buf);
+        buf = next;
     }
+}
+
+static void buffer_pool_free(AVBufferPool *pool)
+{
+#if USE_ATOMICS
+    buffer_pool_free_list(pool->pool);
+#else
+    int i;
+
+    for (i = 0; i < BUFFER_POOL_SHARDS; i++) {
+        buffer_pool_free_list(pool->shards[i].s.pool);
+        ff_mutex_destroy(&pool->shards[i].s.mutex);
+    }
+#endif
     ff_mutex_destroy(&pool->mutex);
 
     if (pool->pool_free)
         pool->pool_free(pool->opaque);
 
+#if USE_ATOMICS
     av_freep(&pool);
+#else
+    av_free(pool->mem);
+#endif
 }
 
 void av_buffer_pool_uninit(AVBufferPool **ppool)
@@ -320,6 +471,67 @@ static void add_to_pool(BufferPoolEntry *buf)
             end = end->next;
     }
 }
+#else
+#if HAVE_THREAD_LOCAL
+/*
+ * Every thread is given the next shard index the first time it touches any
+ * pool, so up to BUFFER_POOL_SHARDS threads never share a shard.
+ */
+static volatile int next_shard_idx;
+static __thread int shard_idx = -1;
+
+static BufferPoolShard *get_shard(AVBufferPool *pool)
+{
+    if (shard_idx < 0)
+        shard_idx = avpriv_atomic_int_add_and_fetch(&next_shard_idx, 1) &
+                    (BUFFER_POOL_SHARDS - 1);
+
+    return &pool->shards[shard_idx];
+}
+#else
+/*
+ * Without thread local storage, fall back to the address of a local
+ * variable: thread stacks lie far apart, so it tells the calling threads
+ * apart, though two threads may still end up on the same shard.
+ */
+static BufferPoolShard *get_shard(AVBufferPool *pool)
+{
+    int anchor;
+    uint32_t h = (uint32_t)((uintptr_t)&anchor >> 16) * 2654435761U;
+
+    return &pool->shards[h >> 29 & (BUFFER_POOL_SHARDS - 1)];
+}
+#endif
+
+/* prepend the list starting at buf and ending at last to the shard */
+static void add_to_shard(BufferPoolShard *shard, BufferPoolEntry *buf,
+                         BufferPoolEntry *last)
+{
+    ff_mutex_lock(&shard->s.mutex);
+    last->next    = shard->s.pool;
+    shard->s.pool = buf;
+    ff_mutex_unlock(&shard->s.mutex);
+}
+
+/* remove up to max entries from the shard, the list is NULL terminated */
+static BufferPoolEntry *get_from_shard(BufferPoolShard *shard, int max,
+                                       BufferPoolEntry **last)
+{
+    BufferPoolEntry *buf, *end;
+
+    ff_mutex_lock(&shard->s.mutex);
+    buf = end = shard->s.pool;
+    if (buf) {
+        while (--max && end->next)
+            end = end->next;
+        shard->s.pool = end->next;
+        end->next     = NULL;
+    }
+    ff_mutex_unlock(&shard->s.mutex);
+
+    *last = end;
+    return buf;
+}
 #endif
 
 static void pool_release_buffer(void *opaque, uint8_t *data)
@@ -333,10 +545,7 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
 #if USE_ATOMICS
     add_to_pool(buf);
 #else
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    add_to_shard(get_shard(pool), buf, buf);
 #endif
 
     if (!avpriv_atomic_int_add_and_fetch(&pool->refcount, -1))
@@ -405,19 +614,32 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
         return NULL;
     }
 #else
-    ff_mutex_lock(&pool->mutex);
-    buf = pool->pool;
+    BufferPoolShard *shard = get_shard(pool);
+    BufferPoolEntry *last;
+    int i;
+
+    buf = get_from_shard(shard, 1, &last);
+    /* steal a few buffers from the other shards before allocating */
+    for (i = 1; !buf && i < BUFFER_POOL_SHARDS; i++) {
+        int idx = (shard - pool->shards + i) & (BUFFER_POOL_SHARDS - 1);
+        buf = get_from_shard(&pool->shards[idx], BUFFER_POOL_BATCH, &last);
+    }
+
     if (buf) {
+        /* keep the first entry, the rest goes to our shard */
+        if (buf->next)
+            add_to_shard(shard, buf->next, last);
+        buf->next = NULL;
+
         ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
                                buf, 0);
-        if (ret) {
-            pool->pool = buf->next;
-            buf->next = NULL;
-        }
+        if (!ret)
+            add_to_shard(shard, buf, buf);
     } else {
+        ff_mutex_lock(&pool->mutex);
         ret = pool_alloc_buffer(pool);
+        ff_mutex_unlock(&pool->mutex);
     }
-    ff_mutex_unlock(&pool->mutex);
 #endif
 
     if (ret)
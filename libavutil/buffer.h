@@ -106,6 +106,18 @@ AVBufferRef *av_buffer_alloc(int size);
  */
 AVBufferRef *av_buffer_allocz(int size);
 
+/**
+ * Same as av_buffer_allocz(), except that buffers of at least 2 MiB are
+ * backed by 2 MiB huge pages where the system supports them, which reduces
+ * TLB misses when accessing e.g. large video frames. Explicitly reserved
+ * huge pages are used when the buffer nearly fills a whole number of them,
+ * transparent huge pages otherwise.
+ *
+ * This function is intended as the alloc callback of an AVBufferPool, as
+ * mapping and unmapping memory is slower than av_buffer_allocz().
+ */
+AVBufferRef *av_buffer_alloc_hugepages(int size);
+
 /**
  * Always treat the buffer as read-only, even when it has only one
  * reference.
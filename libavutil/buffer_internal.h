@@ -22,6 +22,7 @@
 #include <stdint.h>
 
 #include "buffer.h"
+#include "mem.h"
 #include "thread.h"
 
 /**
@@ -72,9 +73,53 @@ typedef struct BufferPoolEntry {
     struct BufferPoolEntry *next;
 } BufferPoolEntry;
 
-struct AVBufferPool {
+#if !USE_ATOMICS
+/**
+ * Number of independently locked free lists in a pool, must be a power of 2.
+ */
+#define BUFFER_POOL_SHARDS 8
+
+/**
+ * Maximum number of entries moved at once from another shard when the
+ * shard of the calling thread runs empty.
+ */
+#define BUFFER_POOL_BATCH  4
+
+/**
+ * Assumed size of a cache line, shards are aligned and padded to it.
+ */
+#define BUFFER_POOL_CACHE_LINE 64
+
+typedef struct BufferPoolShardData {
     AVMutex mutex;
     BufferPoolEntry *pool;
+} BufferPoolShardData;
+
+typedef union BufferPoolShard {
+    BufferPoolShardData s;
+    /* keep every shard on its own cache line(s) */
+    uint8_t pad[(sizeof(BufferPoolShardData) + BUFFER_POOL_CACHE_LINE - 1) &
+                ~(BUFFER_POOL_CACHE_LINE - 1)];
+} BufferPoolShard;
+#endif
+
+struct AVBufferPool {
+#if USE_ATOMICS
+    BufferPoolEntry *pool;
+#else
+    /*
+     * Free buffers, spread over several lists so that threads taking and
+     * returning buffers concurrently mostly work on different locks.
+     */
+    DECLARE_ALIGNED(BUFFER_POOL_CACHE_LINE, BufferPoolShard, shards)[BUFFER_POOL_SHARDS];
+
+    /*
+     * Start of the memory block holding the pool, which is allocated with
+     * extra room to align the shards.
+     */
+    void *mem;
+#endif
+    AVMutex mutex;  ///< serializes the calls to the allocator
 
     /*
      * This is used to track when the pool is to be freed.
@@ -0,0 +1,198 @@
+/*
+ * This file is part of libswresample
+ *
+ * libswresample is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libswresample is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libswresample; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Libswresample multithreading support
+ */
+
+#include "config.h"
+
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "swresample_internal.h"
+
+typedef struct SwriThreadContext {
+    int nb_threads;
+    pthread_t *workers;
+    swri_thread_func *func;
+
+    /* per-execute parameters */
+    void *arg;
+    int nb_jobs;
+
+    pthread_cond_t last_job_cond;
+    pthread_cond_t current_job_cond;
+    pthread_mutex_t current_job_lock;
+    int current_job;
+    unsigned int current_execute;
+    int done;
+} SwriThreadContext;
+
+static void* attribute_align_arg worker(void *v)
+{
+    SwriThreadContext *c = v;
+    int our_job      = c->nb_jobs;
+    int nb_threads   = c->nb_threads;
+    unsigned int last_execute = 0;
+    int self_id;
+
+    pthread_mutex_lock(&c->current_job_lock);
+    self_id = c->current_job++;
+    for (;;) {
+        while (our_job >= c->nb_jobs) {
+            if (c->current_job == nb_threads + c->nb_jobs)
+                pthread_cond_signal(&c->last_job_cond);
+
+            while (last_execute == c->current_execute && !c->done)
+                pthread_cond_wait(&c->current_job_cond, &c->current_job_lock);
+            last_execute = c->current_execute;
+            our_job = self_id;
+
+            if (c->done) {
+                pthread_mutex_unlock(&c->current_job_lock);
+                return NULL;
+            }
+        }
+        pthread_mutex_unlock(&c->current_job_lock);
+
+        c->func(c->arg, our_job, c->nb_jobs);
+
+        pthread_mutex_lock(&c->current_job_lock);
+        our_job = c->current_job++;
+    }
+}
+
+static void thread_uninit(SwriThreadContext *c)
+{
+    int i;
+
+    pthread_mutex_lock(&c->current_job_lock);
+    c->done = 1;
+    pthread_cond_broadcast(&c->current_job_cond);
+    pthread_mutex_unlock(&c->current_job_lock);
+
+    for (i = 0; i < c->nb_threads; i++)
+         pthread_join(c->workers[i], NULL);
+
+    pthread_mutex_destroy(&c->current_job_lock);
+    pthread_cond_destroy(&c->current_job_cond);
+    pthread_cond_destroy(&c->last_job_cond);
+    av_freep(&c->workers);
+}
+
+static void thread_park_workers(SwriThreadContext *c)
+{
+    while (c->current_job != c->nb_threads + c->nb_jobs)
+        pthread_cond_wait(&c->last_job_cond, &c->current_job_lock);
+    pthread_mutex_unlock(&c->current_job_lock);
+}
+
+void swri_thread_execute(SwriThreadContext *c, swri_thread_func *func,
+                         void *arg, int nb_jobs)
+{
+    if (nb_jobs <= 0)
+        return;
+
+    pthread_mutex_lock(&c->current_job_lock);
+
+    c->current_job = c->nb_threads;
+    c->nb_jobs     = nb_jobs;
+    c->arg         = arg;
+    c->func        = func;
+    c->current_execute++;
+
+    pthread_cond_broadcast(&c->current_job_cond);
+
+    thread_park_workers(c);
+}
+
+static int thread_init_internal(SwriThreadContext *c, int nb_threads)
+{
+    int i, ret;
+
+    if (!nb_threads)
+        nb_threads = av_cpu_count();
+
+    if (nb_threads <= 1)
+        return 1;
+
+    c->nb_threads = nb_threads;
+    c->workers = av_mallocz_array(sizeof(*c->workers), nb_threads);
+    if (!c->workers)
+        return AVERROR(ENOMEM);
+
+    c->current_job = 0;
+    c->nb_jobs     = 0;
+    c->done        = 0;
+
+    pthread_cond_init(&c->current_job_cond, NULL);
+    pthread_cond_init(&c->last_job_cond,    NULL);
+
+    pthread_mutex_init(&c->current_job_lock, NULL);
+    pthread_mutex_lock(&c->current_job_lock);
+    for (i = 0; i < nb_threads; i++) {
+        ret = pthread_create(&c->workers[i], NULL, worker, c);
+        if (ret) {
+           pthread_mutex_unlock(&c->current_job_lock);
+           c->nb_threads = i;
+           thread_uninit(c);
+           return AVERROR(ret);
+        }
+    }
+
+    thread_park_workers(c);
+
+    return c->nb_threads;
+}
+
+int swri_thread_init(SwrContext *s)
+{
+    int ret;
+
+#if HAVE_W32THREADS
+    w32thread_init();
+#endif
+
+    if (s->nb_threads == 1)
+        return 0;
+
+    s->thread = av_mallocz(sizeof(SwriThreadContext));
+    if (!s->thread)
+        return AVERROR(ENOMEM);
+
+    ret = thread_init_internal(s->thread, s->nb_threads);
+    if (ret <= 1) {
+        av_freep(&s->thread);
+        return (ret < 0) ? ret : 0;
+    }
+
+    av_log(s, AV_LOG_DEBUG, "Using %d threads for resampling\n", ret);
+
+    return 0;
+}
+
+void swri_thread_free(SwrContext *s)
+{
+    if (s->thread)
+        thread_uninit(s->thread);
+    av_freep(&s->thread);
+}
@@ -22,6 +22,9 @@
 #include "libavutil/avassert.h"
 #include "libavutil/channel_layout.h"
 
+/* number of samples accumulated per block by the N input channel mixers */
+#define MIX_N_BLOCK 32
+
 #define TEMPLATE_REMATRIX_FLT
 #include "rematrix_template.c"
 #undef TEMPLATE_REMATRIX_FLT
@@ -391,10 +394,12 @@ av_cold int swri_rematrix_init(SwrContext *s){
         if (maxsum <= 32768) {
             s->mix_1_1_f = (mix_1_1_func_type*)copy_s16;
             s->mix_2_1_f = (mix_2_1_func_type*)sum2_s16;
+            s->mix_n_f   = (mix_n_func_type  *)sumN_s16;
             s->mix_any_f = (mix_any_func_type*)get_mix_any_func_s16(s);
         } else {
             s->mix_1_1_f = (mix_1_1_func_type*)copy_clip_s16;
             s->mix_2_1_f = (mix_2_1_func_type*)sum2_clip_s16;
+            s->mix_n_f   = (mix_n_func_type  *)sumN_clip_s16;
             s->mix_any_f = (mix_any_func_type*)get_mix_any_func_clip_s16(s);
         }
     }else if(s->midbuf.fmt == AV_SAMPLE_FMT_FLTP){
@@ -408,6 +413,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
         *((float*)s->native_one) = 1.0;
         s->mix_1_1_f = (mix_1_1_func_type*)copy_float;
         s->mix_2_1_f = (mix_2_1_func_type*)sum2_float;
+        s->mix_n_f   = (mix_n_func_type  *)sumN_float;
         s->mix_any_f = (mix_any_func_type*)get_mix_any_func_float(s);
     }else if(s->midbuf.fmt == AV_SAMPLE_FMT_DBLP){
         s->native_matrix = av_calloc(nb_in * nb_out, sizeof(double));
@@ -420,6 +426,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
         *((double*)s->native_one) = 1.0;
         s->mix_1_1_f = (mix_1_1_func_type*)copy_double;
         s->mix_2_1_f = (mix_2_1_func_type*)sum2_double;
+        s->mix_n_f   = (mix_n_func_type  *)sumN_double;
         s->mix_any_f = (mix_any_func_type*)get_mix_any_func_double(s);
     }else if(s->midbuf.fmt == AV_SAMPLE_FMT_S32P){
         // Only for dithering currently
@@ -433,6 +440,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
         *((int*)s->native_one) = 32768;
         s->mix_1_1_f = (mix_1_1_func_type*)copy_s32;
         s->mix_2_1_f = (mix_2_1_func_type*)sum2_s32;
+        s->mix_n_f   = (mix_n_func_type  *)sumN_s32;
         s->mix_any_f = (mix_any_func_type*)get_mix_any_func_s32(s);
     }else
         av_assert0(0);
@@ -461,7 +469,7 @@ av_cold void swri_rematrix_free(SwrContext *s){
 }
 
 int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy){
-    int out_i, in_i, i, j;
+    int out_i, in_i;
     int len1 = 0;
     int off = 0;
 
@@ -508,34 +516,10 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
                 s->mix_2_1_f   (out->ch[out_i]+off, in->ch[in_i1]+off, in->ch[in_i2]+off, s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len-len1);
             break;}
         default:
-            if(s->int_sample_fmt == AV_SAMPLE_FMT_FLTP){
-                for(i=0; i<len; i++){
-                    float v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((float*)in->ch[in_i])[i] * s->matrix[out_i][in_i];
-                    }
-                    ((float*)out->ch[out_i])[i]= v;
-                }
-            }else if(s->int_sample_fmt == AV_SAMPLE_FMT_DBLP){
-                for(i=0; i<len; i++){
-                    double v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((double*)in->ch[in_i])[i] * s->matrix[out_i][in_i];
-                    }
-                    ((double*)out->ch[out_i])[i]= v;
-                }
-            }else{
-                for(i=0; i<len; i++){
-                    int v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((int16_t*)in->ch[in_i])[i] * s->matrix32[out_i][in_i];
-                    }
-                    ((int16_t*)out->ch[out_i])[i]= (v + 16384)>>15;
-                }
-            }
+            if(s->int_sample_fmt == AV_SAMPLE_FMT_FLTP || s->int_sample_fmt == AV_SAMPLE_FMT_DBLP)
+                s->mix_n_f(out->ch[out_i], (const uint8_t **)in->ch, s->matrix_ch[out_i], s->matrix[out_i], len);
+            else
+                s->mix_n_f(out->ch[out_i], (const uint8_t **)in->ch, s->matrix_ch[out_i], s->matrix32[out_i], len);
         }
     }
     return 0;
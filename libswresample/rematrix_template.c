@@ -23,17 +23,20 @@
 #    define SAMPLE float
 #    define COEFF float
 #    define INTER float
+#    define ROW float
 #    define RENAME(x) x ## _float
 #elif defined(TEMPLATE_REMATRIX_DBL)
 #    define R(x) x
 #    define SAMPLE double
 #    define COEFF double
 #    define INTER double
+#    define ROW float
 #    define RENAME(x) x ## _double
 #elif defined(TEMPLATE_REMATRIX_S16)
 #    define SAMPLE int16_t
 #    define COEFF int
 #    define INTER int
+#    define ROW int32_t
 #  ifdef TEMPLATE_CLIP
 #    define R(x) av_clip_int16(((x) + 16384)>>15)
 #    define RENAME(x) x ## _clip_s16
@@ -46,6 +49,7 @@
 #    define SAMPLE int32_t
 #    define COEFF int
 #    define INTER int64_t
+#    define ROW int32_t
 #    define RENAME(x) x ## _s32
 #endif
 
@@ -67,6 +71,34 @@ static void RENAME(copy)(SAMPLE *out, const SAMPLE *in, COEFF *coeffp, integer i
         out[i] = R(coeff*in[i]);
 }
 
+static void RENAME(sumN)(SAMPLE *out, const SAMPLE **in, const uint8_t *ch, const ROW *row, integer len){
+    int nb_in = ch[0];
+    const SAMPLE *src[SWR_CH_MAX];
+    INTER coeff[SWR_CH_MAX];
+    int i, j, k;
+
+    for(j=0; j<nb_in; j++){
+        src[j]   = in[ch[1+j]];
+        coeff[j] = row[ch[1+j]];
+    }
+
+    for(i=0; i<len; i+=MIX_N_BLOCK){
+        INTER acc[MIX_N_BLOCK];
+        int n = FFMIN(len - i, MIX_N_BLOCK);
+
+        for(k=0; k<n; k++)
+            acc[k] = 0;
+        for(j=0; j<nb_in; j++){
+            const SAMPLE *p = src[j] + i;
+            INTER c = coeff[j];
+            for(k=0; k<n; k++)
+                acc[k] += p[k] * c;
+        }
+        for(k=0; k<n; k++)
+            out[i+k] = R(acc[k]);
+    }
+}
+
 static void RENAME(mix6to2)(SAMPLE **out, const SAMPLE **in, COEFF *coeffp, integer len){
     int i;
 
@@ -108,4 +140,5 @@ static RENAME(mix_any_func_type) *RENAME(get_mix_any_func)(SwrContext *s){
 #undef SAMPLE
 #undef COEFF
 #undef INTER
+#undef ROW
 #undef RENAME
@@ -27,6 +27,7 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/thread.h"
 #include "resample.h"
 
 static inline double eval_poly(const double *coeff, int size, double x) {
@@ -143,7 +144,7 @@ static double bessel(double x) {
  */
 static int build_filter(ResampleContext *c, void *filter, double factor, int tap_count, int alloc, int phase_count, int scale,
                         int filter_type, double kaiser_beta){
-    int ph, i;
+    int ph, i, ret = AVERROR(ENOMEM);
     int ph_nb = phase_count % 2 ? phase_count : phase_count / 2 + 1;
     double x, y, w, t, s;
     double *tab = av_malloc_array(tap_count+1,  sizeof(*tab));
@@ -292,12 +293,170 @@ static int build_filter(ResampleContext *c, void *filter, double factor, int tap
     }
 #endif
 
+    ret = 0;
 fail:
     av_free(tab);
     av_free(sin_lut);
+    return ret;
+}
+
+/* Filter banks only depend on a handful of parameters and are never
+ * modified once built, so contexts created with the same settings share
+ * them through a process wide cache. Up to FILTER_BANK_CACHE_MAX_IDLE
+ * banks no context refers to anymore are kept for later contexts. */
+#define FILTER_BANK_CACHE_MAX_IDLE 8
+
+typedef struct FilterBankKey {
+    enum AVSampleFormat format;
+    enum SwrFilterType filter_type;
+    int filter_length;
+    int phase_count;
+    double factor;
+    double kaiser_beta;
+} FilterBankKey;
+
+typedef struct FilterBankEntry {
+    FilterBankKey key;
+    AVBufferRef *buf;               ///< reference held by the cache itself
+    struct FilterBankEntry *next;
+} FilterBankEntry;
+
+static FilterBankEntry *filter_bank_cache;
+static AVMutex filter_bank_cache_mutex;
+static AVOnce filter_bank_cache_once = AV_ONCE_INIT;
+
+static av_cold void filter_bank_cache_init(void)
+{
+    ff_mutex_init(&filter_bank_cache_mutex, NULL);
+}
+
+/* Must be called with filter_bank_cache_mutex held. The list is ordered
+ * from the newest to the oldest entry, so the oldest idle banks go first. */
+static void filter_bank_cache_prune(void)
+{
+    FilterBankEntry **p = &filter_bank_cache;
+    int idle = 0;
+
+    while (*p) {
+        FilterBankEntry *e = *p;
+        if (av_buffer_get_ref_count(e->buf) == 1 &&
+            ++idle > FILTER_BANK_CACHE_MAX_IDLE) {
+            *p = e->next;
+            av_buffer_unref(&e->buf);
+            av_free(e);
+        } else {
+            p = &e->next;
+        }
+    }
+}
+
+static int build_filter_bank(ResampleContext *c, AVBufferRef **out, int phase_count)
+{
+    int size = c->filter_alloc * (phase_count + 1) * c->felem_size;
+    uint8_t *filter_bank = av_calloc(c->filter_alloc, (phase_count + 1) * c->felem_size);
+    int ret;
+
+    if (!filter_bank)
+        return AVERROR(ENOMEM);
+
+    ret = build_filter(c, filter_bank, c->factor, c->filter_length, c->filter_alloc,
+                       phase_count, 1 << c->filter_shift, c->filter_type, c->kaiser_beta);
+    if (ret < 0) {
+        av_free(filter_bank);
+        return ret;
+    }
+    memcpy(filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, filter_bank, (c->filter_alloc-1)*c->felem_size);
+    memcpy(filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
+
+    *out = av_buffer_create(filter_bank, size, av_buffer_default_free, NULL,
+                            AV_BUFFER_FLAG_READONLY);
+    if (!*out) {
+        av_free(filter_bank);
+        return AVERROR(ENOMEM);
+    }
     return 0;
 }
 
+static void release_filter_bank(ResampleContext *c)
+{
+    if (!c->filter_bank_buf)
+        return;
+
+    c->filter_bank = NULL;
+
+    ff_mutex_lock(&filter_bank_cache_mutex);
+    av_buffer_unref(&c->filter_bank_buf);
+    filter_bank_cache_prune();
+    ff_mutex_unlock(&filter_bank_cache_mutex);
+}
+
+/**
+ * Make c->filter_bank point to the bank for phase_count phases and the
+ * filter parameters of c, building it only if no other context did so.
+ * Any bank previously used by c is released on success.
+ */
+static int get_filter_bank(ResampleContext *c, int phase_count)
+{
+    FilterBankKey key;
+    FilterBankEntry *e;
+    AVBufferRef *buf = NULL;
+    int ret = 0;
+
+    memset(&key, 0, sizeof(key));
+    key.format        = c->format;
+    key.filter_type   = c->filter_type;
+    key.filter_length = c->filter_length;
+    key.phase_count   = phase_count;
+    key.factor        = c->factor;
+    key.kaiser_beta   = c->kaiser_beta;
+
+    if (ff_thread_once(&filter_bank_cache_once, filter_bank_cache_init))
+        return AVERROR_UNKNOWN;
+    ff_mutex_lock(&filter_bank_cache_mutex);
+
+    for (e = filter_bank_cache; e; e = e->next)
+        if (!memcmp(&e->key, &key, sizeof(key)))
+            break;
+
+    if (!e) {
+        e = av_mallocz(sizeof(*e));
+        if (!e) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = build_filter_bank(c, &e->buf, phase_count);
+        if (ret < 0) {
+            av_free(e);
+            goto end;
+        }
+        e->key            = key;
+        e->next           = filter_bank_cache;
+        filter_bank_cache = e;
+    }
+
+    buf = av_buffer_ref(e->buf);
+    if (!buf)
+        ret = AVERROR(ENOMEM);
+
+end:
+    filter_bank_cache_prune();
+    ff_mutex_unlock(&filter_bank_cache_mutex);
+    if (ret < 0)
+        return ret;
+
+    release_filter_bank(c);
+    c->filter_bank_buf = buf;
+    c->filter_bank     = buf->data;
+    return 0;
+}
+
+static void resample_free(ResampleContext **c){
+    if(!*c)
+        return;
+    release_filter_bank(*c);
+    av_freep(c);
+}
+
 static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff0, enum AVSampleFormat format, enum SwrFilterType filter_type, double kaiser_beta,
                                     double precision, int cheby, int exact_rational)
@@ -320,6 +479,7 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
     if (!c || c->phase_count != phase_count || c->linear!=linear || c->factor != factor
            || c->filter_length != FFMAX((int)ceil(filter_size/factor), 1) || c->format != format
            || c->filter_type != filter_type || c->kaiser_beta != kaiser_beta) {
+        resample_free(&c);
         c = av_mallocz(sizeof(*c));
         if (!c)
             return NULL;
@@ -354,16 +514,11 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
         c->factor        = factor;
         c->filter_length = FFMAX((int)ceil(filter_size/factor), 1);
         c->filter_alloc  = FFALIGN(c->filter_length, 8);
-        c->filter_bank   = av_calloc(c->filter_alloc, (phase_count+1)*c->felem_size);
         c->filter_type   = filter_type;
         c->kaiser_beta   = kaiser_beta;
         c->phase_count_compensation = phase_count_compensation;
-        if (!c->filter_bank)
-            goto error;
-        if (build_filter(c, (void*)c->filter_bank, factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, filter_type, kaiser_beta))
+        if (get_filter_bank(c, phase_count) < 0)
             goto error;
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_alloc-1)*c->felem_size);
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, c->filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
     }
 
     c->compensation_distance= 0;
@@ -384,21 +539,12 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
 
     return c;
 error:
-    av_freep(&c->filter_bank);
-    av_free(c);
+    resample_free(&c);
     return NULL;
 }
 
-static void resample_free(ResampleContext **c){
-    if(!*c)
-        return;
-    av_freep(&(*c)->filter_bank);
-    av_freep(c);
-}
-
 static int rebuild_filter_bank_with_compensation(ResampleContext *c)
 {
-    uint8_t *new_filter_bank;
     int new_src_incr, new_dst_incr;
     int phase_count = c->phase_count_compensation;
     int ret;
@@ -408,25 +554,13 @@ static int rebuild_filter_bank_with_compensation(ResampleContext *c)
 
     av_assert0(!c->frac && !c->dst_incr_mod && !c->compensation_distance);
 
-    new_filter_bank = av_calloc(c->filter_alloc, (phase_count + 1) * c->felem_size);
-    if (!new_filter_bank)
-        return AVERROR(ENOMEM);
-
-    ret = build_filter(c, new_filter_bank, c->factor, c->filter_length, c->filter_alloc,
-                       phase_count, 1 << c->filter_shift, c->filter_type, c->kaiser_beta);
-    if (ret < 0) {
-        av_freep(&new_filter_bank);
-        return ret;
-    }
-    memcpy(new_filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, new_filter_bank, (c->filter_alloc-1)*c->felem_size);
-    memcpy(new_filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, new_filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
-
     if (!av_reduce(&new_src_incr, &new_dst_incr, c->src_incr,
                    c->dst_incr * (int64_t)(phase_count/c->phase_count), INT32_MAX/2))
-    {
-        av_freep(&new_filter_bank);
         return AVERROR(EINVAL);
-    }
+
+    ret = get_filter_bank(c, phase_count);
+    if (ret < 0)
+        return ret;
 
     c->src_incr = new_src_incr;
     c->dst_incr = new_dst_incr;
@@ -439,8 +573,6 @@ static int rebuild_filter_bank_with_compensation(ResampleContext *c)
     c->dst_incr_mod   = c->dst_incr % c->src_incr;
     c->index         *= phase_count / c->phase_count;
     c->phase_count    = phase_count;
-    av_freep(&c->filter_bank);
-    c->filter_bank = new_filter_bank;
     return 0;
 }
 
@@ -503,7 +635,29 @@ static int swri_resample(ResampleContext *c,
     return dst_size;
 }
 
-static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
+typedef struct ResampleThreadData {
+    ResampleContext *c;
+    ResampleContext state;          ///< copy of *c taken before any channel is filtered
+    AudioData *dst, *src;
+    int dst_size, src_size;
+    int ret, consumed;
+} ResampleThreadData;
+
+static void resample_channel(void *arg, int jobnr, int nb_jobs)
+{
+    ResampleThreadData *td = arg;
+    int consumed;
+
+    if (jobnr + 1 == nb_jobs) {
+        td->ret = swri_resample(td->c, td->dst->ch[jobnr], td->src->ch[jobnr],
+                                &td->consumed, td->src_size, td->dst_size, 1);
+    } else {
+        swri_resample(&td->state, td->dst->ch[jobnr], td->src->ch[jobnr],
+                      &consumed, td->src_size, td->dst_size, 0);
+    }
+}
+
+static int multiple_resample(SwrContext *s, ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
     int i, ret= -1;
     int av_unused mm_flags = av_get_cpu_flags();
     int need_emms = c->format == AV_SAMPLE_FMT_S16P && ARCH_X86_32 &&
@@ -514,9 +668,19 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
         dst_size = FFMIN(dst_size, c->compensation_distance);
     src_size = FFMIN(src_size, max_src_size);
 
-    for(i=0; i<dst->ch_count; i++){
-        ret= swri_resample(c, dst->ch[i], src->ch[i],
-                           consumed, src_size, dst_size, i+1==dst->ch_count);
+    if (s->thread && dst->ch_count > 1 && !need_emms) {
+        /* Only the last channel updates the context, the others work on a
+         * snapshot of it so that all channels can be filtered concurrently. */
+        ResampleThreadData td = { c, *c, dst, src, dst_size, src_size };
+
+        swri_thread_execute(s->thread, resample_channel, &td, dst->ch_count);
+        ret       = td.ret;
+        *consumed = td.consumed;
+    } else {
+        for(i=0; i<dst->ch_count; i++){
+            ret= swri_resample(c, dst->ch[i], src->ch[i],
+                               consumed, src_size, dst_size, i+1==dst->ch_count);
+        }
     }
     if(need_emms)
         emms_c();
@@ -101,6 +101,22 @@ fail:
     return NULL;
 }
 
+#if !HAVE_THREADS
+int swri_thread_init(SwrContext *s)
+{
+    return 0;
+}
+
+void swri_thread_free(SwrContext *s)
+{
+}
+
+void swri_thread_execute(struct SwriThreadContext *c, swri_thread_func *func,
+                         void *arg, int nb_jobs)
+{
+}
+#endif
+
 static void set_audiodata_fmt(AudioData *a, enum AVSampleFormat fmt){
     a->fmt   = fmt;
     a->bps   = av_get_bytes_per_sample(fmt);
@@ -132,6 +148,7 @@ static void clear_context(SwrContext *s){
     swri_audio_convert_free(&s->out_convert);
     swri_audio_convert_free(&s->full_convert);
     swri_rematrix_free(s);
+    swri_thread_free(s);
 
     s->delayed_samples_fixup = 0;
     s->flushed = 0;
@@ -383,6 +400,12 @@ av_assert0(s->out.ch_count);
             goto fail;
     }
 
+    if (s->resample && s->resampler == &swri_resampler) {
+        ret = swri_thread_init(s);
+        if (ret < 0)
+            goto fail;
+    }
+
     return 0;
 fail:
     swr_close(s);
@@ -507,7 +530,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
         int ret, size, consumed;
         if(!s->resample_in_constraint && s->in_buffer_count){
             buf_set(&tmp, &s->in_buffer, s->in_buffer_index);
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &tmp, s->in_buffer_count, &consumed);
+            ret= s->resampler->multiple_resample(s, s->resample, &out, out_count, &tmp, s->in_buffer_count, &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -527,7 +550,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
 
         if((s->flushed || in_count > padless) && !s->in_buffer_count){
             s->in_buffer_index=0;
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
+            ret= s->resampler->multiple_resample(s, s->resample, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
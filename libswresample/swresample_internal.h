@@ -40,6 +40,8 @@ typedef int integer;
 typedef void (mix_1_1_func_type)(void *out, const void *in, void *coeffp, integer index, integer len);
 typedef void (mix_2_1_func_type)(void *out, const void *in1, const void *in2, void *coeffp, integer index1, integer index2, integer len);
 
+typedef void (mix_n_func_type)(void *out, const uint8_t **in, const uint8_t *ch, const void *coeffp, integer len);
+
 typedef void (mix_any_func_type)(uint8_t **out, const uint8_t **in1, void *coeffp, integer len);
 
 typedef struct AudioData{
@@ -71,7 +73,7 @@ struct DitherContext {
 typedef struct ResampleContext * (* resample_init_func)(struct ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff, enum AVSampleFormat format, enum SwrFilterType filter_type, double kaiser_beta, double precision, int cheby, int exact_rational);
 typedef void    (* resample_free_func)(struct ResampleContext **c);
-typedef int     (* multiple_resample_func)(struct ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
+typedef int     (* multiple_resample_func)(struct SwrContext *s, struct ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
 typedef int     (* resample_flush_func)(struct SwrContext *c);
 typedef int     (* set_compensation_func)(struct ResampleContext *c, int sample_delta, int compensation_distance);
 typedef int64_t (* get_delay_func)(struct SwrContext *s, int64_t base);
@@ -113,6 +115,7 @@ struct SwrContext {
     const int *channel_map;                         ///< channel index (or -1 if muted channel) map
     int used_ch_count;                              ///< number of used input channels (mapped channel count if channel_map, otherwise in.ch_count)
     int engine;
+    int nb_threads;                                 ///< number of threads used to resample channels in parallel, 0 for auto
 
     int user_in_ch_count;                           ///< User set input channel count
     int user_out_ch_count;                          ///< User set output channel count
@@ -167,6 +170,7 @@ struct SwrContext {
     struct AudioConvert *full_convert;              ///< full conversion context (single conversion for input and output)
     struct ResampleContext *resample;               ///< resampling context
     struct Resampler const *resampler;              ///< resampler virtual function table
+    struct SwriThreadContext *thread;               ///< worker threads used by the resampler
 
     float matrix[SWR_CH_MAX][SWR_CH_MAX];           ///< floating point rematrixing coefficients
     uint8_t *native_matrix;
@@ -181,6 +185,8 @@ struct SwrContext {
     mix_2_1_func_type *mix_2_1_f;
     mix_2_1_func_type *mix_2_1_simd;
 
+    mix_n_func_type *mix_n_f;                       ///< mixes the input channels listed in matrix_ch[] for one output channel
+
     mix_any_func_type *mix_any_f;
 
     /* TODO: callbacks for ASM optimizations */
@@ -194,6 +200,13 @@ void swri_noise_shaping_int32 (SwrContext *s, AudioData *dsts, const AudioData *
 void swri_noise_shaping_float (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
 void swri_noise_shaping_double(SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
 
+typedef void (swri_thread_func)(void *arg, int jobnr, int nb_jobs);
+
+int swri_thread_init(SwrContext *s);
+void swri_thread_free(SwrContext *s);
+void swri_thread_execute(struct SwriThreadContext *c, swri_thread_func *func,
+                         void *arg, int nb_jobs);
+
 av_warn_unused_result
 int swri_rematrix_init(SwrContext *s);
 void swri_rematrix_free(SwrContext *s);
@@ -63,9 +63,9 @@ static av_always_inline void fillPlane(uint8_t *plane, int stride, int width,
     }
 }
 
-static void hScale16To19_c(SwsContext *c, int16_t *_dst, int dstW,
-                           const uint8_t *_src, const int16_t *filter,
-                           const int32_t *filterPos, int filterSize)
+static av_always_inline void hScale16To19_template(SwsContext *c, int16_t *_dst, int dstW,
+                                                   const uint8_t *_src, const int16_t *filter,
+                                                   const int32_t *filterPos, int filterSize)
 {
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->srcFormat);
     int i;
@@ -90,9 +90,9 @@ static void hScale16To19_c(SwsContext *c, int16_t *_dst, int dstW,
     }
 }
 
-static void hScale16To15_c(SwsContext *c, int16_t *dst, int dstW,
-                           const uint8_t *_src, const int16_t *filter,
-                           const int32_t *filterPos, int filterSize)
+static av_always_inline void hScale16To15_template(SwsContext *c, int16_t *dst, int dstW,
+                                                   const uint8_t *_src, const int16_t *filter,
+                                                   const int32_t *filterPos, int filterSize)
 {
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->srcFormat);
     int i;
@@ -116,9 +116,9 @@ static void hScale16To15_c(SwsContext *c, int16_t *dst, int dstW,
 }
 
 // bilinear / bicubic scaling
-static void hScale8To15_c(SwsContext *c, int16_t *dst, int dstW,
-                          const uint8_t *src, const int16_t *filter,
-                          const int32_t *filterPos, int filterSize)
+static av_always_inline void hScale8To15_template(SwsContext *c, int16_t *dst, int dstW,
+                                                  const uint8_t *src, const int16_t *filter,
+                                                  const int32_t *filterPos, int filterSize)
 {
     int i;
     for (i = 0; i < dstW; i++) {
@@ -132,9 +132,9 @@ static void hScale8To15_c(SwsContext *c, int16_t *dst, int dstW,
     }
 }
 
-static void hScale8To19_c(SwsContext *c, int16_t *_dst, int dstW,
-                          const uint8_t *src, const int16_t *filter,
-                          const int32_t *filterPos, int filterSize)
+static av_always_inline void hScale8To19_template(SwsContext *c, int16_t *_dst, int dstW,
+                                                  const uint8_t *src, const int16_t *filter,
+                                                  const int32_t *filterPos, int filterSize)
 {
     int i;
     int32_t *dst = (int32_t *) _dst;
@@ -149,6 +149,45 @@ static void hScale8To19_c(SwsContext *c, int16_t *_dst, int dstW,
     }
 }
 
+/* Instantiate the horizontal scalers with a constant filter size for the
+ * common bilinear/bicubic cases, so the inner loop gets fully unrolled. */
+#define DEF_HSCALE(name)                                                        \
+static void name ## _c(SwsContext *c, int16_t *dst, int dstW,                   \
+                       const uint8_t *src, const int16_t *filter,               \
+                       const int32_t *filterPos, int filterSize)                \
+{                                                                               \
+    name ## _template(c, dst, dstW, src, filter, filterPos, filterSize);        \
+}                                                                               \
+                                                                                \
+static void name ## _4_c(SwsContext *c, int16_t *dst, int dstW,                 \
+                         const uint8_t *src, const int16_t *filter,             \
+                         const int32_t *filterPos, int filterSize)              \
+{                                                                               \
+    name ## _template(c, dst, dstW, src, filter, filterPos, 4);                 \
+}                                                                               \
+                                                                                \
+static void name ## _8_c(SwsContext *c, int16_t *dst, int dstW,                 \
+                         const uint8_t *src, const int16_t *filter,             \
+                         const int32_t *filterPos, int filterSize)              \
+{                                                                               \
+    name ## _template(c, dst, dstW, src, filter, filterPos, 8);                 \
+}
+
+DEF_HSCALE(hScale8To15)
+DEF_HSCALE(hScale8To19)
+DEF_HSCALE(hScale16To15)
+DEF_HSCALE(hScale16To19)
+
+#define ASSIGN_HSCALE(hscalefn, filtersize, name) \
+    hscalefn = filtersize == 4 ? name ## _4_c :   \
+               filtersize == 8 ? name ## _8_c :   \
+                                 name ## _c
+
+#define ASSIGN_HSCALE_FUNCS(name) do {                      \
+    ASSIGN_HSCALE(c->hyScale, c->hLumFilterSize, name);     \
+    ASSIGN_HSCALE(c->hcScale, c->hChrFilterSize, name);     \
+} while (0)
+
 // FIXME all pal and rgb srcFormats could do this conversion as well
 // FIXME all scalers more complex than bilinear could do half of this transform
 static void chrRangeToJpeg_c(int16_t *dstU, int16_t *dstV, int width)
@@ -569,17 +608,18 @@ static av_cold void sws_init_swscale(SwsContext *c)
 
     if (c->srcBpc == 8) {
         if (c->dstBpc <= 14) {
-            c->hyScale = c->hcScale = hScale8To15_c;
+            ASSIGN_HSCALE_FUNCS(hScale8To15);
             if (c->flags & SWS_FAST_BILINEAR) {
                 c->hyscale_fast = ff_hyscale_fast_c;
                 c->hcscale_fast = ff_hcscale_fast_c;
             }
         } else {
-            c->hyScale = c->hcScale = hScale8To19_c;
+            ASSIGN_HSCALE_FUNCS(hScale8To19);
         }
+    } else if (c->dstBpc > 14) {
+        ASSIGN_HSCALE_FUNCS(hScale16To19);
     } else {
-        c->hyScale = c->hcScale = c->dstBpc > 14 ? hScale16To19_c
-                                                 : hScale16To15_c;
+        ASSIGN_HSCALE_FUNCS(hScale16To15);
     }
 
     ff_sws_init_range_convert(c);
@@ -31,6 +31,7 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
+#include "libavutil/buffer.h"
 #include "libavutil/common.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/log.h"
@@ -385,6 +386,10 @@ typedef struct SwsContext {
     int hChrFilterSize;           ///< Horizontal filter size for chroma     pixels.
     int vLumFilterSize;           ///< Vertical   filter size for luma/alpha pixels.
     int vChrFilterSize;           ///< Vertical   filter size for chroma     pixels.
+    AVBufferRef *hLumFilterBuf;   ///< Shared filter cache entry owning hLumFilter/hLumFilterPos, if any.
+    AVBufferRef *hChrFilterBuf;   ///< Shared filter cache entry owning hChrFilter/hChrFilterPos, if any.
+    AVBufferRef *vLumFilterBuf;   ///< Shared filter cache entry owning vLumFilter/vLumFilterPos, if any.
+    AVBufferRef *vChrFilterBuf;   ///< Shared filter cache entry owning vChrFilter/vChrFilterPos, if any.
     //@}
 
     int lumMmxextFilterCodeSize;  ///< Runtime-generated MMXEXT horizontal fast bilinear scaler code size for luma/alpha planes.
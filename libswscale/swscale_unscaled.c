@@ -157,6 +157,40 @@ static void copyPlane(const uint8_t *src, int srcStride,
     }
 }
 
+#if HAVE_FAST_64BIT
+/* Widen the four bytes of v into the four 16-bit lanes of the result. */
+static av_always_inline uint64_t spread8to16(uint32_t v)
+{
+    uint64_t x = v;
+    x = (x | x << 16) & UINT64_C(0x0000ffff0000ffff);
+    return (x | x <<  8) & UINT64_C(0x00ff00ff00ff00ff);
+}
+
+/* Interleave two pairs of native 16-bit values read as 32-bit words. */
+static av_always_inline uint64_t interleave16(uint32_t a, uint32_t b)
+{
+    uint64_t x = a, y = b;
+    x = (x | x << 16) & UINT64_C(0x0000ffff0000ffff);
+    y = (y | y << 16) & UINT64_C(0x0000ffff0000ffff);
+    return HAVE_BIGENDIAN ? x << 16 | y : x | y << 16;
+}
+#endif
+
+/* Byteswap a line of 16-bit words, four at a time where possible. */
+static void bswap16_line(uint16_t *dst, const uint16_t *src, int length)
+{
+    int j = 0;
+#if HAVE_FAST_64BIT
+    for (; j < length - 3; j += 4) {
+        uint64_t v = AV_RN64(src + j);
+        AV_WN64(dst + j, (v >> 8 & UINT64_C(0x00ff00ff00ff00ff)) |
+                         (v & UINT64_C(0x00ff00ff00ff00ff)) << 8);
+    }
+#endif
+    for (; j < length; j++)
+        dst[j] = av_bswap16(src[j]);
+}
+
 static int planarToNv12Wrapper(SwsContext *c, const uint8_t *src[],
                                int srcStride[], int srcSliceY,
                                int srcSliceH, uint8_t *dstParam[],
@@ -214,7 +248,16 @@ static int planarToP010Wrapper(SwsContext *c, const uint8_t *src8[],
     for (y = 0; y < srcSliceH; y++) {
         uint16_t *tdstY = dstY;
         const uint16_t *tsrc0 = src[0];
-        for (x = c->srcW; x > 0; x--) {
+        x = c->srcW;
+#if HAVE_FAST_64BIT
+        for (; x > 3; x -= 4) {
+            uint64_t v = AV_RN64(tsrc0);
+            AV_WN64(tdstY, (v << 6) & UINT64_C(0xffc0ffc0ffc0ffc0));
+            tsrc0 += 4;
+            tdstY += 4;
+        }
+#endif
+        for (; x > 0; x--) {
             *tdstY++ = *tsrc0++ << 6;
         }
         src[0] += srcStride[0] / 2;
@@ -224,7 +267,17 @@ static int planarToP010Wrapper(SwsContext *c, const uint8_t *src8[],
             uint16_t *tdstUV = dstUV;
             const uint16_t *tsrc1 = src[1];
             const uint16_t *tsrc2 = src[2];
-            for (x = c->srcW / 2; x > 0; x--) {
+            x = c->srcW / 2;
+#if HAVE_FAST_64BIT
+            for (; x > 1; x -= 2) {
+                uint64_t v = interleave16(AV_RN32(tsrc1), AV_RN32(tsrc2));
+                AV_WN64(tdstUV, (v << 6) & UINT64_C(0xffc0ffc0ffc0ffc0));
+                tsrc1 += 2;
+                tsrc2 += 2;
+                tdstUV += 4;
+            }
+#endif
+            for (; x > 0; x--) {
                 *tdstUV++ = *tsrc1++ << 6;
                 *tdstUV++ = *tsrc2++ << 6;
             }
@@ -260,7 +313,16 @@ static int planar8ToP01xleWrapper(SwsContext *c, const uint8_t *src[],
     for (y = 0; y < srcSliceH; y++) {
         uint16_t *tdstY = dstY;
         const uint8_t *tsrc0 = src[0];
-        for (x = c->srcW; x > 0; x--) {
+        x = c->srcW;
+#if HAVE_FAST_64BIT
+        for (; x > 3; x -= 4) {
+            uint64_t v = spread8to16(AV_RL32(tsrc0));
+            AV_WL64(tdstY, v | v << 8);
+            tsrc0 += 4;
+            tdstY += 4;
+        }
+#endif
+        for (; x > 0; x--) {
             t = *tsrc0++;
             output_pixel(tdstY++, t | (t << 8));
         }
@@ -271,7 +333,20 @@ static int planar8ToP01xleWrapper(SwsContext *c, const uint8_t *src[],
             uint16_t *tdstUV = dstUV;
             const uint8_t *tsrc1 = src[1];
             const uint8_t *tsrc2 = src[2];
-            for (x = c->srcW / 2; x > 0; x--) {
+            x = c->srcW / 2;
+#if HAVE_FAST_64BIT
+            for (; x > 1; x -= 2) {
+                uint64_t u = AV_RL16(tsrc1), v = AV_RL16(tsrc2);
+                u = (u | u << 24) & UINT64_C(0x000000ff000000ff);
+                v = (v | v << 24) & UINT64_C(0x000000ff000000ff);
+                v = u | v << 16;
+                AV_WL64(tdstUV, v | v << 8);
+                tsrc1 += 2;
+                tsrc2 += 2;
+                tdstUV += 4;
+            }
+#endif
+            for (; x > 0; x--) {
                 t = *tsrc1++;
                 output_pixel(tdstUV++, t | (t << 8));
                 t = *tsrc2++;
@@ -433,7 +508,7 @@ static int packed_16bpc_bswap(SwsContext *c, const uint8_t *src[],
                               int srcStride[], int srcSliceY, int srcSliceH,
                               uint8_t *dst[], int dstStride[])
 {
-    int i, j, p;
+    int i, p;
 
     for (p = 0; p < 4; p++) {
         int srcstr = srcStride[p] / 2;
@@ -445,9 +520,7 @@ static int packed_16bpc_bswap(SwsContext *c, const uint8_t *src[],
             continue;
         dstPtr += (srcSliceY >> c->chrDstVSubSample) * dststr;
         for (i = 0; i < (srcSliceH >> c->chrDstVSubSample); i++) {
-            for (j = 0; j < min_stride; j++) {
-                dstPtr[j] = av_bswap16(srcPtr[j]);
-            }
+            bswap16_line(dstPtr, srcPtr, min_stride);
             srcPtr += srcstr;
             dstPtr += dststr;
         }
@@ -1550,12 +1623,26 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
                     }
                 } else if (src_depth == 8) {
                     for (i = 0; i < height; i++) {
+                        j = 0;
+#if HAVE_FAST_64BIT
+                        if (isBE(c->dstFormat) == HAVE_BIGENDIAN) {
+                            unsigned shift = dst_depth - 8;
+                            unsigned rshift = 2 * 8 - dst_depth;
+                            /* drop the bits shifted in from the next lane */
+                            uint64_t mask = shiftonly ? 0 :
+                                            (0xFFU >> rshift) * UINT64_C(0x0001000100010001);
+                            for (; j < length - 3; j += 4) {
+                                uint64_t v = spread8to16(AV_RN32(srcPtr + j));
+                                AV_WN64(dstPtr2 + j, v << shift | (v >> rshift & mask));
+                            }
+                        }
+#endif
                         #define COPY816(w)\
                         if (shiftonly) {\
-                            for (j = 0; j < length; j++)\
+                            for (; j < length; j++)\
                                 w(&dstPtr2[j], srcPtr[j]<<(dst_depth-8));\
                         } else {\
-                            for (j = 0; j < length; j++)\
+                            for (; j < length; j++)\
                                 w(&dstPtr2[j], (srcPtr[j]<<(dst_depth-8)) |\
                                                (srcPtr[j]>>(2*8-dst_depth)));\
                         }
@@ -1589,9 +1676,15 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
 #endif
                              switch (shift)
                              {
+                             case 2: FAST_COPY_UP(2); break;
+                             case 4: FAST_COPY_UP(4); break;
                              case 6: FAST_COPY_UP(6); break;
                              case 7: FAST_COPY_UP(7); break;
                              }
+                        } else if (src_depth == dst_depth && shiftonly &&
+                                   isBE(c->srcFormat) != isBE(c->dstFormat)) {
+                            bswap16_line(dstPtr2, srcPtr2, length);
+                            j = length;
                         }
 #define COPY_UP(r,w) \
     if(shiftonly){\
@@ -1641,8 +1734,7 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
                       isBE(c->srcFormat) != isBE(c->dstFormat)) {
 
                 for (i = 0; i < height; i++) {
-                    for (j = 0; j < length; j++)
-                        ((uint16_t *) dstPtr)[j] = av_bswap16(((const uint16_t *) srcPtr)[j]);
+                    bswap16_line((uint16_t *)dstPtr, (const uint16_t *)srcPtr, length);
                     srcPtr += srcStride[plane];
                     dstPtr += dstStride[plane];
                 }
@@ -49,6 +49,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "libavutil/aarch64/cpu.h"
 #include "libavutil/ppc/cpu.h"
 #include "libavutil/x86/asm.h"
@@ -715,6 +716,158 @@ fail:
     return ret;
 }
 
+/* Filters computed by initFilter() are immutable once built, so contexts
+ * with the same geometry share them through a process wide cache. Entries
+ * stay alive while a context references them; up to FILTER_CACHE_MAX_IDLE
+ * unreferenced ones are kept around for contexts created later. */
+#define FILTER_CACHE_MAX_IDLE 16
+
+typedef struct FilterCacheKey {
+    int xInc, srcW, dstW, filterAlign, one, flags, cpu_flags, srcPos, dstPos;
+    double param[2];
+} FilterCacheKey;
+
+typedef struct FilterCacheEntry {
+    FilterCacheKey key;
+    int16_t *filter;
+    int32_t *filterPos;
+    int filterSize;
+    AVBufferRef *buf;               ///< reference held by the cache itself
+    struct FilterCacheEntry *next;
+} FilterCacheEntry;
+
+static FilterCacheEntry *filter_cache;
+static AVMutex filter_cache_mutex;
+static AVOnce filter_cache_once = AV_ONCE_INIT;
+
+static av_cold void filter_cache_init(void)
+{
+    ff_mutex_init(&filter_cache_mutex, NULL);
+}
+
+static void filter_cache_entry_free(void *opaque, uint8_t *data)
+{
+    FilterCacheEntry *e = (FilterCacheEntry *)data;
+    av_free(e->filter);
+    av_free(e->filterPos);
+    av_free(e);
+}
+
+/* Must be called with filter_cache_mutex held. The list is ordered from
+ * the newest to the oldest entry, so the oldest idle entries go first. */
+static void filter_cache_prune(void)
+{
+    FilterCacheEntry **p = &filter_cache;
+    int idle = 0;
+
+    while (*p) {
+        FilterCacheEntry *e = *p;
+        if (av_buffer_get_ref_count(e->buf) == 1 &&
+            ++idle > FILTER_CACHE_MAX_IDLE) {
+            AVBufferRef *buf = e->buf;
+            *p = e->next;
+            av_buffer_unref(&buf);
+        } else {
+            p = &e->next;
+        }
+    }
+}
+
+static av_cold int initFilterCached(AVBufferRef **outBuf, int16_t **outFilter,
+                                    int32_t **filterPos, int *outFilterSize,
+                                    int xInc, int srcW, int dstW,
+                                    int filterAlign, int one,
+                                    int flags, int cpu_flags,
+                                    SwsVector *srcFilter, SwsVector *dstFilter,
+                                    double param[2], int srcPos, int dstPos)
+{
+    FilterCacheKey key;
+    FilterCacheEntry *e;
+    int ret = 0;
+
+    /* user supplied filter vectors are not part of the key */
+    if (srcFilter || dstFilter)
+        return initFilter(outFilter, filterPos, outFilterSize, xInc, srcW,
+                          dstW, filterAlign, one, flags, cpu_flags,
+                          srcFilter, dstFilter, param, srcPos, dstPos);
+
+    memset(&key, 0, sizeof(key));
+    key.xInc        = xInc;
+    key.srcW        = srcW;
+    key.dstW        = dstW;
+    key.filterAlign = filterAlign;
+    key.one         = one;
+    key.flags       = flags;
+    key.cpu_flags   = cpu_flags;
+    key.srcPos      = srcPos;
+    key.dstPos      = dstPos;
+    key.param[0]    = param[0];
+    key.param[1]    = param[1];
+
+    if (ff_thread_once(&filter_cache_once, filter_cache_init))
+        return AVERROR_UNKNOWN;
+    ff_mutex_lock(&filter_cache_mutex);
+
+    for (e = filter_cache; e; e = e->next)
+        if (!memcmp(&e->key, &key, sizeof(key)))
+            break;
+
+    if (!e) {
+        e = av_mallocz(sizeof(*e));
+        if (!e) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = initFilter(&e->filter, &e->filterPos, &e->filterSize, xInc,
+                         srcW, dstW, filterAlign, one, flags, cpu_flags,
+                         NULL, NULL, param, srcPos, dstPos);
+        if (ret >= 0) {
+            e->buf = av_buffer_create((uint8_t *)e, sizeof(*e),
+                                      filter_cache_entry_free, NULL,
+                                      AV_BUFFER_FLAG_READONLY);
+            if (!e->buf)
+                ret = AVERROR(ENOMEM);
+        }
+        if (ret < 0) {
+            filter_cache_entry_free(NULL, (uint8_t *)e);
+            goto end;
+        }
+        e->key       = key;
+        e->next      = filter_cache;
+        filter_cache = e;
+    }
+
+    *outBuf = av_buffer_ref(e->buf);
+    if (!*outBuf) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    *outFilter     = e->filter;
+    *filterPos     = e->filterPos;
+    *outFilterSize = e->filterSize;
+
+end:
+    filter_cache_prune();
+    ff_mutex_unlock(&filter_cache_mutex);
+    return ret;
+}
+
+static void releaseFilter(AVBufferRef **buf, int16_t **filter,
+                          int32_t **filterPos)
+{
+    if (!*buf)
+        return;
+
+    /* the arrays belong to the cache entry */
+    *filter    = NULL;
+    *filterPos = NULL;
+
+    ff_mutex_lock(&filter_cache_mutex);
+    av_buffer_unref(buf);
+    filter_cache_prune();
+    ff_mutex_unlock(&filter_cache_mutex);
+}
+
 static void fill_rgb2yuv_table(SwsContext *c, const int table[4], int dstRange)
 {
     int64_t W, V, Z, Cy, Cu, Cv;
@@ -1637,7 +1790,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                     PPC_ALTIVEC(cpu_flags) ? 8 :
                                     have_neon(cpu_flags)   ? 8 : 1;
 
-            if ((ret = initFilter(&c->hLumFilter, &c->hLumFilterPos,
+            if ((ret = initFilterCached(&c->hLumFilterBuf,
+                           &c->hLumFilter, &c->hLumFilterPos,
                            &c->hLumFilterSize, c->lumXInc,
                            srcW, dstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
@@ -1646,7 +1800,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                            get_local_pos(c, 0, 0, 0),
                            get_local_pos(c, 0, 0, 0))) < 0)
                 goto fail;
-            if ((ret = initFilter(&c->hChrFilter, &c->hChrFilterPos,
+            if ((ret = initFilterCached(&c->hChrFilterBuf,
+                           &c->hChrFilter, &c->hChrFilterPos,
                            &c->hChrFilterSize, c->chrXInc,
                            c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -1664,7 +1819,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                 PPC_ALTIVEC(cpu_flags) ? 8 :
                                 have_neon(cpu_flags)   ? 2 : 1;
 
-        if ((ret = initFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
+        if ((ret = initFilterCached(&c->vLumFilterBuf,
+                       &c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
                        c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                        cpu_flags, srcFilter->lumV, dstFilter->lumV,
@@ -1672,7 +1828,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                        get_local_pos(c, 0, 0, 1),
                        get_local_pos(c, 0, 0, 1))) < 0)
             goto fail;
-        if ((ret = initFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
+        if ((ret = initFilterCached(&c->vChrFilterBuf,
+                       &c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
                        c->chrYInc, c->chrSrcH, c->chrDstH,
                        filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -2280,6 +2437,11 @@ void sws_freeContext(SwsContext *c)
     for (i = 0; i < 4; i++)
         av_freep(&c->dither_error[i]);
 
+    releaseFilter(&c->hLumFilterBuf, &c->hLumFilter, &c->hLumFilterPos);
+    releaseFilter(&c->hChrFilterBuf, &c->hChrFilter, &c->hChrFilterPos);
+    releaseFilter(&c->vLumFilterBuf, &c->vLumFilter, &c->vLumFilterPos);
+    releaseFilter(&c->vChrFilterBuf, &c->vChrFilter, &c->vChrFilterPos);
+
     av_freep(&c->vLumFilter);
     av_freep(&c->vChrFilter);
     av_freep(&c->hLumFilter);
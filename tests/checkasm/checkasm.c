@@ -112,6 +112,9 @@ static const struct {
     #if CONFIG_COLORSPACE_FILTER
         { "vf_colorspace", checkasm_check_colorspace },
     #endif
+#endif
+#if CONFIG_SWSCALE
+    { "sw_scale", checkasm_check_sw_scale },
 #endif
     { NULL }
 };
@@ -42,6 +42,7 @@ void checkasm_check_h264qpel(void);
 void checkasm_check_jpeg2000dsp(void);
 void checkasm_check_pixblockdsp(void);
 void checkasm_check_synth_filter(void);
+void checkasm_check_sw_scale(void);
 void checkasm_check_v210enc(void);
 void checkasm_check_vp9dsp(void);
 void checkasm_check_videodsp(void);
@@ -0,0 +1,316 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#define W 512
+#define H 16
+#define MAX_FILTER_WIDTH 40
+/* room for the widest input pixel plus the reads past the end some kernels do */
+#define SRC_SIZE ((W + MAX_FILTER_WIDTH) * 8)
+
+#define randomize_buffer(buf, size, mask)                   \
+    do {                                                    \
+        int n;                                              \
+        for (n = 0; n < (size); n += 4)                     \
+            AV_WN32A((uint8_t *)(buf) + n, rnd() & (mask)); \
+    } while (0)
+
+static const int filter_sizes[] = { 4, 8, 12, 16, MAX_FILTER_WIDTH };
+
+static SwsContext *get_context(enum AVPixelFormat src_fmt,
+                               enum AVPixelFormat dst_fmt, int flags)
+{
+    SwsContext *c = sws_getContext(W, H, src_fmt, W, H, dst_fmt, flags,
+                                   NULL, NULL, NULL);
+    /* unscaled conversions skip the scaler setup, so force it */
+    if (c)
+        ff_getSwsFunc(c);
+    return c;
+}
+
+static void check_hscale(void)
+{
+    static const struct {
+        enum AVPixelFormat src, dst;
+        int src_bits, dst_bits;
+    } fmts[] = {
+        { AV_PIX_FMT_YUV420P,    AV_PIX_FMT_YUV420P,    8,  15 },
+        { AV_PIX_FMT_YUV420P,    AV_PIX_FMT_YUV420P16,  8,  19 },
+        { AV_PIX_FMT_YUV420P10,  AV_PIX_FMT_YUV420P10, 10,  15 },
+        { AV_PIX_FMT_YUV420P10,  AV_PIX_FMT_YUV420P16, 10,  19 },
+    };
+    LOCAL_ALIGNED_32(uint8_t,  src,       [SRC_SIZE]);
+    LOCAL_ALIGNED_32(int16_t,  filter,    [W * MAX_FILTER_WIDTH]);
+    LOCAL_ALIGNED_32(int32_t,  filter_pos,[W]);
+    LOCAL_ALIGNED_32(int32_t,  dst0,      [W]);
+    LOCAL_ALIGNED_32(int32_t,  dst1,      [W]);
+    int i, j, f, fs;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, SwsContext *c, int16_t *dst, int dstW,
+                      const uint8_t *src, const int16_t *filter,
+                      const int32_t *filterPos, int filterSize);
+
+    for (f = 0; f < FF_ARRAY_ELEMS(fmts); f++) {
+        int dst_size = W * (fmts[f].dst_bits > 15 ? 4 : 2);
+        unsigned mask = fmts[f].src_bits > 8 ? 0x03ff03ff : 0xffffffff;
+
+        for (fs = 0; fs < FF_ARRAY_ELEMS(filter_sizes); fs++) {
+            int size = filter_sizes[fs];
+            SwsContext *c = get_context(fmts[f].src, fmts[f].dst, SWS_BILINEAR);
+            if (!c)
+                return;
+
+            /* select the kernels for the filter size under test */
+            c->hLumFilterSize = c->hChrFilterSize = size;
+            ff_getSwsFunc(c);
+
+            if (check_func(c->hyScale, "hscale_%d_to_%d_width%d",
+                           fmts[f].src_bits, fmts[f].dst_bits, size)) {
+                randomize_buffer(src, SRC_SIZE, mask);
+                for (i = 0; i < W; i++) {
+                    filter_pos[i] = rnd() % (W - size + 1);
+                    for (j = 0; j < size; j++)
+                        filter[i * size + j] = (int)(rnd() % ((1 << 15) / size)) -
+                                               (1 << 14) / size;
+                }
+                memset(dst0, 0, W * sizeof(*dst0));
+                memset(dst1, 0, W * sizeof(*dst1));
+
+                call_ref(c, (int16_t *)dst0, W, src, filter, filter_pos, size);
+                call_new(c, (int16_t *)dst1, W, src, filter, filter_pos, size);
+                if (memcmp(dst0, dst1, dst_size))
+                    fail();
+                bench_new(c, (int16_t *)dst1, W, src, filter, filter_pos, size);
+            }
+            sws_freeContext(c);
+        }
+    }
+}
+
+static void check_yuv2planeX(void)
+{
+    static const enum AVPixelFormat fmts[] = {
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV420P9, AV_PIX_FMT_YUV420P10,
+    };
+    static const uint8_t dither[8] = { 64, 64, 64, 64, 64, 64, 64, 64 };
+    LOCAL_ALIGNED_32(int16_t, src_pixels, [16 * W]);
+    LOCAL_ALIGNED_32(int16_t, filter,     [16]);
+    LOCAL_ALIGNED_32(uint16_t, dst0,      [W]);
+    LOCAL_ALIGNED_32(uint16_t, dst1,      [W]);
+    const int16_t *src[16];
+    int i, f, size;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, const int16_t *filter, int filterSize,
+                      const int16_t **src, uint8_t *dest, int dstW,
+                      const uint8_t *dither, int offset);
+
+    for (i = 0; i < 16; i++)
+        src[i] = src_pixels + i * W;
+
+    for (f = 0; f < FF_ARRAY_ELEMS(fmts); f++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmts[f]);
+        int depth    = desc->comp[0].depth;
+        int dst_size = W * (depth > 8 ? 2 : 1);
+        /* the inexact vertical filter is only used without accurate rounding */
+        SwsContext *c = get_context(fmts[f], fmts[f],
+                                    SWS_BILINEAR | SWS_ACCURATE_RND | SWS_BITEXACT);
+        if (!c)
+            return;
+
+        if (check_func(c->yuv2planeX, "yuv2planeX_%d", depth)) {
+            for (size = 1; size <= 16; size++) {
+                int offset = rnd() & 7;
+                int sum = 0;
+
+                randomize_buffer(src_pixels, 16 * W * sizeof(*src_pixels), 0x7fff7fff);
+                /* keep the coefficients summing to about unity, like the scaler does */
+                for (i = 0; i < size; i++) {
+                    filter[i] = rnd() % (8192 / size + 1) - (4096 / size);
+                    sum += filter[i];
+                }
+                filter[0] += 4096 - sum;
+                memset(dst0, 0, sizeof(*dst0) * W);
+                memset(dst1, 0, sizeof(*dst1) * W);
+
+                call_ref(filter, size, src, (uint8_t *)dst0, W, dither, offset);
+                call_new(filter, size, src, (uint8_t *)dst1, W, dither, offset);
+                if (memcmp(dst0, dst1, dst_size))
+                    fail();
+                if (size == 8)
+                    bench_new(filter, size, src, (uint8_t *)dst1, W, dither, offset);
+            }
+        }
+        sws_freeContext(c);
+    }
+}
+
+static void check_input(void)
+{
+    static const enum AVPixelFormat fmts[] = {
+        AV_PIX_FMT_YUYV422, AV_PIX_FMT_UYVY422, AV_PIX_FMT_NV12, AV_PIX_FMT_NV21,
+        AV_PIX_FMT_RGB24,   AV_PIX_FMT_BGR24,   AV_PIX_FMT_RGBA, AV_PIX_FMT_BGRA,
+        AV_PIX_FMT_ARGB,    AV_PIX_FMT_ABGR,
+    };
+    LOCAL_ALIGNED_32(uint8_t, src,  [SRC_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src2, [SRC_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [W * 4]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [W * 4]);
+    LOCAL_ALIGNED_32(uint8_t, dst2, [W * 4]);
+    LOCAL_ALIGNED_32(uint8_t, dst3, [W * 4]);
+    int f;
+
+    for (f = 0; f < FF_ARRAY_ELEMS(fmts); f++) {
+        const char *name = av_get_pix_fmt_name(fmts[f]);
+        SwsContext *c = get_context(fmts[f], AV_PIX_FMT_YUV420P, SWS_BILINEAR);
+        uint32_t *pal;
+        if (!c)
+            return;
+        pal = (uint32_t *)c->input_rgb2yuv_table;
+
+        randomize_buffer(src,  SRC_SIZE, 0xffffffff);
+        randomize_buffer(src2, SRC_SIZE, 0xffffffff);
+
+        if (c->lumToYV12) {
+            declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, const uint8_t *src,
+                              const uint8_t *src2, const uint8_t *src3,
+                              int width, uint32_t *pal);
+
+            if (check_func(c->lumToYV12, "%s_to_y", name)) {
+                memset(dst0, 0, W * 4);
+                memset(dst1, 0, W * 4);
+                call_ref(dst0, src, src2, src2, W, pal);
+                call_new(dst1, src, src2, src2, W, pal);
+                if (memcmp(dst0, dst1, W * 2))
+                    fail();
+                bench_new(dst1, src, src2, src2, W, pal);
+            }
+        }
+
+        if (c->chrToYV12) {
+            int chr_w = AV_CEIL_RSHIFT(W, c->chrSrcHSubSample);
+            declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dstU, uint8_t *dstV,
+                              const uint8_t *src1, const uint8_t *src2,
+                              const uint8_t *src3, int width, uint32_t *pal);
+
+            if (check_func(c->chrToYV12, "%s_to_uv%s", name,
+                           c->chrSrcHSubSample ? "_half" : "")) {
+                memset(dst0, 0, W * 4);
+                memset(dst1, 0, W * 4);
+                memset(dst2, 0, W * 4);
+                memset(dst3, 0, W * 4);
+                call_ref(dst0, dst2, src, src, src, chr_w, pal);
+                call_new(dst1, dst3, src, src, src, chr_w, pal);
+                if (memcmp(dst0, dst1, chr_w * 2) || memcmp(dst2, dst3, chr_w * 2))
+                    fail();
+                bench_new(dst1, dst3, src, src, src, chr_w, pal);
+            }
+        }
+        sws_freeContext(c);
+    }
+}
+
+static void check_yuv2rgb(void)
+{
+    static const struct {
+        enum AVPixelFormat fmt;
+        int bpp;
+    } fmts[] = {
+        { AV_PIX_FMT_RGB24, 3 }, { AV_PIX_FMT_BGR24, 3 },
+        { AV_PIX_FMT_RGB32, 4 }, { AV_PIX_FMT_BGR32, 4 },
+    };
+    LOCAL_ALIGNED_32(uint8_t, src_y, [W * H]);
+    LOCAL_ALIGNED_32(uint8_t, src_u, [W * H / 4]);
+    LOCAL_ALIGNED_32(uint8_t, src_v, [W * H / 4]);
+    uint8_t *dst0, *dst1;
+    int log_level = av_log_get_level();
+    int f, i;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, int, SwsContext *c, const uint8_t *src[],
+                      int srcStride[], int srcSliceY, int srcSliceH,
+                      uint8_t *dst[], int dstStride[]);
+
+    /* the C reference is only picked after warning about the missing SIMD */
+    av_log_set_level(AV_LOG_ERROR);
+
+    dst0 = av_malloc(W * H * 4);
+    dst1 = av_malloc(W * H * 4);
+    if (!dst0 || !dst1)
+        goto end;
+
+    for (f = 0; f < FF_ARRAY_ELEMS(fmts); f++) {
+        const uint8_t *src[3] = { src_y, src_u, src_v };
+        int src_stride[3]     = { W, W / 2, W / 2 };
+        int dst_stride[1]     = { W * fmts[f].bpp };
+        SwsContext *c = get_context(AV_PIX_FMT_YUV420P, fmts[f].fmt, SWS_BILINEAR);
+        if (!c)
+            goto end;
+
+        if (check_func(ff_yuv2rgb_get_func_ptr(c), "yuv420p_to_%s",
+                       av_get_pix_fmt_name(fmts[f].fmt))) {
+            uint8_t *dst[1];
+
+            randomize_buffer(src_y, W * H,     0xffffffff);
+            randomize_buffer(src_u, W * H / 4, 0xffffffff);
+            randomize_buffer(src_v, W * H / 4, 0xffffffff);
+            memset(dst0, 0, W * H * 4);
+            memset(dst1, 0, W * H * 4);
+
+            dst[0] = dst0;
+            call_ref(c, src, src_stride, 0, H, dst, dst_stride);
+            dst[0] = dst1;
+            call_new(c, src, src_stride, 0, H, dst, dst_stride);
+            /* the SIMD versions use lower precision coefficients, so only
+             * require them to stay within a small distance of the C output */
+            for (i = 0; i < W * H * fmts[f].bpp; i++) {
+                if (FFABS(dst0[i] - dst1[i]) > 3) {
+                    fail();
+                    break;
+                }
+            }
+            bench_new(c, src, src_stride, 0, H, dst, dst_stride);
+        }
+        sws_freeContext(c);
+    }
+
+end:
+    av_free(dst0);
+    av_free(dst1);
+    av_log_set_level(log_level);
+}
+
+void checkasm_check_sw_scale(void)
+{
+    check_hscale();
+    report("hscale");
+    check_yuv2planeX();
+    report("yuv2planeX");
+    check_input();
+    report("input");
+    check_yuv2rgb();
+    report("yuv2rgb");
+}
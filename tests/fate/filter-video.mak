@@ -319,6 +319,9 @@ FATE_FILTER_VSYNTH-$(CONFIG_TRIM_FILTER) += $(FATE_TRIM)
 FATE_FILTER_VSYNTH-$(CONFIG_UNSHARP_FILTER) += fate-filter-unsharp
 fate-filter-unsharp: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf unsharp=11:11:-1.5:11:11:-1.5
 
+FATE_FILTER_VSYNTH-$(call ALLYES, FORMAT_FILTER UNSHARP_FILTER) += fate-filter-unsharp-yuv420p10
+fate-filter-unsharp-yuv420p10: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf format=yuv420p10le,unsharp=11:11:-1.5:11:11:-1.5 -pix_fmt yuv420p10le -flags +bitexact -sws_flags +accurate_rnd+bitexact
+
 FATE_FILTER_SAMPLES-$(call ALLYES, SMJPEG_DEMUXER MJPEG_DECODER PERMS_FILTER HQDN3D_FILTER) += fate-filter-hqdn3d-sample
 fate-filter-hqdn3d-sample: tests/data/filtergraphs/hqdn3d
 fate-filter-hqdn3d-sample: CMD = framecrc -idct simple -i $(TARGET_SAMPLES)/smjpeg/scenwin.mjpg -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/hqdn3d -an
@@ -352,6 +355,11 @@ FATE_FILTER-$(call ALLYES, TESTSRC_FILTER SINE_FILTER CONCAT_FILTER) += fate-fil
 fate-filter-concat: tests/data/filtergraphs/concat
 fate-filter-concat: CMD = framecrc -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/concat
 
+# the difference between the single-threaded and the threaded output must be zero
+FATE_FILTER-$(call ALLYES, LIBZIMG TESTSRC2_FILTER FORMAT_FILTER SPLIT_FILTER ZSCALE_FILTER BLEND_FILTER) += fate-filter-zscale-threads
+fate-filter-zscale-threads: tests/data/filtergraphs/zscale-threads
+fate-filter-zscale-threads: CMD = framecrc -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/zscale-threads
+
 FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER FPS_FILTER MPDECIMATE_FILTER) += fate-filter-mpdecimate
 fate-filter-mpdecimate: CMD = framecrc -lavfi testsrc2=r=2:d=10,fps=3,mpdecimate -r 3 -pix_fmt yuv420p
 
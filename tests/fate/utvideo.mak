@@ -70,3 +70,11 @@ $(FATE_UTVIDEOENC): $(VREF)
 
 FATE_AVCONV-$(call ENCMUX, UTVIDEO, AVI) += $(FATE_UTVIDEOENC)
 fate-utvideoenc: $(FATE_UTVIDEOENC)
+
+# corrupt some bytes of the encoded frames, including their Huffman tables
+fate-utvideodec-corrupt: CMD = transcode "image2 -vcodec pgmyuv" $(TARGET_PATH)/tests/vsynth1/%02d.pgm \
+                               avi "-c:v utvideo -pix_fmt yuv420p -pred left -slices 4 -bsf:v noise=amount=10000" \
+                               "-max_error_rate 1"
+fate-utvideodec-corrupt: $(VREF)
+
+FATE_AVCONV-$(call ALLYES, IMAGE2_DEMUXER PGMYUV_DECODER UTVIDEO_ENCODER NOISE_BSF AVI_MUXER AVI_DEMUXER UTVIDEO_DECODER FRAMECRC_MUXER) += fate-utvideodec-corrupt